@@ -0,0 +1,213 @@
+/*
+ * eez-framework
+ *
+ * MIT License
+ * Copyright 2024 Envox d.o.o.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// Pixel exact test of the simulator span kernels (platform/simulator/display-kernels.h):
+// every kernel is compared, pixel by pixel, with the scalar code it replaces.
+// It is built more than once, with different instruction sets and -ffp-contract options
+// (see CMakeLists.txt), because vector and scalar code must match with any flags.
+
+#define EEZ_OPTION_GUI_SIMD 1
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <eez/platform/simulator/display-kernels.h>
+
+using namespace eez::gui::display;
+
+// longer than any vector, not a multiple of the vector length, so the scalar tail is also used
+static const int ROW_LENGTH = 67;
+
+static uint32_t g_random = 1;
+
+static uint32_t random32() {
+    // xorshift32
+    g_random ^= g_random << 13;
+    g_random ^= g_random >> 17;
+    g_random ^= g_random << 5;
+    return g_random;
+}
+
+static int g_numErrors;
+
+static void check(const char *kernel, const uint32_t *actual, const uint32_t *expected, int n) {
+    for (int i = 0; i < n; i++) {
+        if (actual[i] != expected[i]) {
+            if (g_numErrors < 10) {
+                printf("%s: pixel %d is 0x%08X, expected 0x%08X\n", kernel, i, (unsigned)actual[i], (unsigned)expected[i]);
+            }
+            g_numErrors++;
+        }
+    }
+}
+
+static void randomRow(uint32_t *row, uint32_t alpha) {
+    for (int i = 0; i < ROW_LENGTH; i++) {
+        row[i] = (random32() & 0x00FFFFFF) | (alpha << 24);
+    }
+}
+
+// every pair of foreground and background alpha
+static void testBlendColorSpan() {
+    uint32_t dst[ROW_LENGTH];
+    uint32_t expected[ROW_LENGTH];
+    for (uint32_t fa = 0; fa < 256; fa++) {
+        for (uint32_t ba = 0; ba < 256; ba++) {
+            uint32_t color = (random32() & 0x00FFFFFF) | (fa << 24);
+            randomRow(dst, ba);
+            for (int i = 0; i < ROW_LENGTH; i++) {
+                expected[i] = blendColorScalar(color, dst[i]);
+            }
+            kernels::blendColorSpan(dst, ROW_LENGTH, color);
+            check("blendColorSpan", dst, expected, ROW_LENGTH);
+        }
+    }
+}
+
+static void testBlendSpanWithOpacity() {
+    uint32_t src[ROW_LENGTH];
+    uint32_t dst[ROW_LENGTH];
+    uint32_t expectedSrc[ROW_LENGTH];
+    uint32_t expected[ROW_LENGTH];
+    for (uint32_t opacity = 0; opacity < 256; opacity++) {
+        for (uint32_t ba = 0; ba < 256; ba++) {
+            randomRow(src, random32() & 0xFF);
+            randomRow(dst, ba);
+            for (int i = 0; i < ROW_LENGTH; i++) {
+                expectedSrc[i] = (src[i] & 0x00FFFFFF) | (opacity << 24);
+                expected[i] = blendColorScalar(expectedSrc[i], dst[i]);
+            }
+            kernels::blendSpanWithOpacity(dst, src, ROW_LENGTH, (uint8_t)opacity);
+            check("blendSpanWithOpacity (src)", src, expectedSrc, ROW_LENGTH);
+            check("blendSpanWithOpacity", dst, expected, ROW_LENGTH);
+        }
+    }
+}
+
+static void testBlendBitmapSpan() {
+    uint32_t src[ROW_LENGTH];
+    uint32_t dst[ROW_LENGTH];
+    uint32_t expected[ROW_LENGTH];
+    for (uint32_t opacity = 0; opacity < 256; opacity++) {
+        for (uint32_t ba = 0; ba < 256; ba++) {
+            for (int i = 0; i < ROW_LENGTH; i++) {
+                src[i] = random32();
+            }
+            randomRow(dst, ba);
+            for (int i = 0; i < ROW_LENGTH; i++) {
+                uint32_t a = (src[i] >> 24) * opacity / 255;
+                expected[i] = blendColorScalar((src[i] & 0x00FFFFFF) | (a << 24), dst[i]);
+            }
+            kernels::blendBitmapSpan(dst, src, ROW_LENGTH, (uint8_t)opacity);
+            check("blendBitmapSpan", dst, expected, ROW_LENGTH);
+        }
+    }
+}
+
+static void testBlendGlyphSpan() {
+    uint8_t coverage[ROW_LENGTH];
+    uint32_t dst[ROW_LENGTH];
+    uint32_t expected[ROW_LENGTH];
+    for (uint32_t opacity = 0; opacity < 256; opacity++) {
+        for (uint32_t ba = 0; ba < 256; ba++) {
+            uint32_t rgb = random32() & 0x00FFFFFF;
+            for (int i = 0; i < ROW_LENGTH; i++) {
+                coverage[i] = (uint8_t)random32();
+            }
+            randomRow(dst, ba);
+            for (int i = 0; i < ROW_LENGTH; i++) {
+                uint32_t a = coverage[i] * opacity / 255;
+                expected[i] = blendColorScalar(rgb | (a << 24), dst[i]);
+            }
+            kernels::blendGlyphSpan(dst, coverage, ROW_LENGTH, rgb, (uint8_t)opacity);
+            check("blendGlyphSpan", dst, expected, ROW_LENGTH);
+        }
+    }
+}
+
+// every RGB565 color
+static void testExpand565Span() {
+    static uint16_t src[65536];
+    static uint32_t dst[65536];
+    static uint32_t expected[65536];
+    for (uint32_t c = 0; c < 65536; c++) {
+        src[c] = (uint16_t)c;
+        uint8_t r = (uint8_t)((c >> 11) << 3);
+        uint8_t g = (uint8_t)((c >> 5) << 2);
+        uint8_t b = (uint8_t)(c << 3);
+        expected[c] = r | (g << 8) | (b << 16) | 0xFF000000;
+    }
+    kernels::expand565Span(dst, src, 65536);
+    check("expand565Span", dst, expected, 65536);
+}
+
+static void testQuantizeSpan() {
+    uint32_t src[ROW_LENGTH];
+    uint32_t dst[ROW_LENGTH];
+    uint32_t expected[ROW_LENGTH];
+    for (int j = 0; j < 1000; j++) {
+        for (int i = 0; i < ROW_LENGTH; i++) {
+            src[i] = random32();
+            uint8_t r = src[i] & 0xFF;
+            uint8_t g = (src[i] >> 8) & 0xFF;
+            uint8_t b = (src[i] >> 16) & 0xFF;
+            // RGB_TO_COLOR and back with color16to32
+            expected[i] = (r & 0xF8) | ((g & 0xFC) << 8) | ((b & 0xF8) << 16) | 0xFF000000;
+        }
+        kernels::quantizeSpan(dst, src, ROW_LENGTH);
+        check("quantizeSpan", dst, expected, ROW_LENGTH);
+    }
+}
+
+static void testFillAndCopySpan() {
+    uint32_t src[ROW_LENGTH];
+    uint32_t dst[ROW_LENGTH];
+    uint32_t expected[ROW_LENGTH];
+    uint32_t color = random32();
+    for (int i = 0; i < ROW_LENGTH; i++) {
+        expected[i] = color;
+    }
+    kernels::fillSpan(dst, ROW_LENGTH, color);
+    check("fillSpan", dst, expected, ROW_LENGTH);
+
+    randomRow(src, 0xFF);
+    kernels::copySpan(dst, src, ROW_LENGTH);
+    check("copySpan", dst, src, ROW_LENGTH);
+}
+
+int main() {
+#if EEZ_GUI_SIMD_AVX2
+    printf("backend: AVX2\n");
+#elif EEZ_GUI_SIMD_SSE2
+    printf("backend: SSE2\n");
+#elif EEZ_GUI_SIMD_NEON
+    printf("backend: NEON\n");
+#elif EEZ_GUI_SIMD_WASM
+    printf("backend: WASM SIMD128\n");
+#else
+    printf("backend: scalar\n");
+#endif
+
+    testBlendColorSpan();
+    testBlendSpanWithOpacity();
+    testBlendBitmapSpan();
+    testBlendGlyphSpan();
+    testExpand565Span();
+    testQuantizeSpan();
+    testFillAndCopySpan();
+
+    if (g_numErrors) {
+        printf("%d pixels differ\n", g_numErrors);
+        return 1;
+    }
+
+    printf("OK\n");
+    return 0;
+}
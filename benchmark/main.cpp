@@ -0,0 +1,361 @@
+/*
+ * eez-framework
+ *
+ * MIT License
+ * Copyright 2024 Envox d.o.o.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// Headless benchmark for the flow engine, allocator and value operations.
+//
+// Usage: eez-framework-benchmark [--time-ms N] [--assets path/to/assets.bin] [--output results.json]
+//
+// Results are written as JSON to stdout (or to the --output file), every result contains
+// the number of iterations, ns per iteration and iterations per second.
+
+#include <eez/conf-internal.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <eez/core/alloc.h>
+#include <eez/core/assets.h>
+#include <eez/core/memory.h>
+#include <eez/core/value.h>
+#include <eez/core/vars.h>
+#include <eez/core/action.h>
+#include <eez/fs/fs.h>
+
+#include <eez/flow/flow.h>
+#include <eez/flow/expression.h>
+#include <eez/flow/private.h>
+
+#include "synthetic_assets.h"
+
+// these are normally provided by the application
+namespace eez {
+
+ActionExecFunc g_actionExecFunctions[] = { 0 };
+
+char *getConfFilePath(const char *fileName) {
+    static char filePath[1024];
+    snprintf(filePath, sizeof(filePath), "%s", fileName);
+    return filePath;
+}
+
+} // namespace eez
+
+extern "C" {
+native_var_t native_vars[] = {
+    { NATIVE_VAR_TYPE_NONE, 0, 0 },
+};
+}
+
+using namespace eez;
+using namespace eez::flow;
+
+namespace {
+
+struct Result {
+    std::string name;
+    uint64_t iterations;
+    uint64_t durationNs;
+    std::string extra; // additional JSON members, already formatted
+};
+
+std::vector<Result> g_results;
+uint32_t g_timeMs = 500;
+
+typedef std::chrono::steady_clock Clock;
+
+uint64_t nsSince(Clock::time_point startTime) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - startTime).count();
+}
+
+template<typename T>
+inline void doNotOptimize(T const &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Runs fn in batches until g_timeMs elapsed, fn must return the number of iterations it did.
+template<typename Fn>
+void measure(const char *name, Fn fn, const std::string &extra = std::string()) {
+    uint64_t iterations = 0;
+    auto startTime = Clock::now();
+    uint64_t durationNs;
+    do {
+        iterations += fn();
+        durationNs = nsSince(startTime);
+    } while (durationNs < g_timeMs * 1000000ull);
+    g_results.push_back({ name, iterations, durationNs, extra });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void benchmarkSyntheticFlow() {
+    benchmark::SyntheticAssets syntheticAssets;
+    benchmark::buildSyntheticAssets(syntheticAssets);
+
+    loadMainAssets(syntheticAssets.image, syntheticAssets.imageSize);
+    if (!start(g_mainAssets)) {
+        fprintf(stderr, "failed to start synthetic flow\n");
+        exit(1);
+    }
+    auto flowState = getPageFlowState(g_mainAssets, 0);
+
+    // components/second through tick()
+    uint64_t numTicks = 0;
+    auto startTime = Clock::now();
+    uint64_t durationNs;
+    do {
+        tick();
+        numTicks++;
+        durationNs = nsSince(startTime);
+    } while (durationNs < g_timeMs * 1000000ull);
+
+    auto counter = getGlobalVariable(benchmark::SYNTHETIC_COUNTER_GLOBAL_VARIABLE).getInt();
+    uint64_t numComponents = 1 /* Start */ + (uint64_t)counter * benchmark::SYNTHETIC_COMPONENTS_PER_LOOP;
+
+    char extra[128];
+    snprintf(extra, sizeof(extra), "\"ticks\": %llu, \"ns_per_tick\": %.1f", (unsigned long long)numTicks, (double)durationNs / numTicks);
+    g_results.push_back({ "flow_tick_components", numComponents, durationNs, extra });
+
+    // ns per evalExpression
+    for (int compiled = 0; compiled <= EEZ_FLOW_EVAL_COMPILE_EXPRESSIONS; compiled++) {
+#if EEZ_FLOW_EVAL_COMPILE_EXPRESSIONS
+        enableCompiledExpressions(compiled);
+        resetCompiledExpressions();
+#endif
+        for (int i = 0; i < benchmark::NUM_SYNTHETIC_EXPRESSIONS; i++) {
+            auto instructions = syntheticAssets.expressions[i];
+            auto name = std::string("eval_expression_") + syntheticAssets.expressionNames[i] + (compiled ? "_compiled" : "");
+            bool ok = true;
+            measure(name.c_str(), [&]() {
+                for (int j = 0; j < 1000; j++) {
+                    Value result;
+                    ok = evalExpression(flowState, benchmark::SYNTHETIC_EXPRESSIONS_COMPONENT_INDEX, instructions, result, FlowError::Plain("benchmark")) && ok;
+                    doNotOptimize(result);
+                }
+                return 1000;
+            });
+            if (!ok) {
+                fprintf(stderr, "%s: evaluation failed\n", name.c_str());
+                exit(1);
+            }
+        }
+    }
+
+    stop();
+    tick();
+}
+
+void benchmarkRecordedFlow(const char *assetsFilePath) {
+    auto file = fopen(assetsFilePath, "rb");
+    if (!file) {
+        fprintf(stderr, "can't open %s\n", assetsFilePath);
+        exit(1);
+    }
+    fseek(file, 0, SEEK_END);
+    auto assetsSize = (uint32_t)ftell(file);
+    fseek(file, 0, SEEK_SET);
+    // kept until exit, assets are used in place if not compressed
+    auto assets = (uint8_t *)::malloc(assetsSize);
+    if (fread(assets, 1, assetsSize, file) != assetsSize) {
+        fprintf(stderr, "can't read %s\n", assetsFilePath);
+        exit(1);
+    }
+    fclose(file);
+
+    loadMainAssets(assets, assetsSize);
+    if (!start(g_mainAssets)) {
+        fprintf(stderr, "%s has no flows\n", assetsFilePath);
+        exit(1);
+    }
+    getPageFlowState(g_mainAssets, 0);
+
+    measure("flow_tick_recorded", []() {
+        tick();
+        return 1;
+    });
+
+    stop();
+    tick();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// xorshift, so the allocation pattern doesn't depend on the libc rand implementation
+uint32_t g_randomState = 2463534242u;
+
+inline uint32_t nextRandom() {
+    g_randomState ^= g_randomState << 13;
+    g_randomState ^= g_randomState >> 17;
+    g_randomState ^= g_randomState << 5;
+    return g_randomState;
+}
+
+void benchmarkAlloc() {
+    // same size, alloc immediately followed by free
+    measure("alloc_free_lifo", []() {
+        for (int i = 0; i < 1000; i++) {
+            auto ptr = eez::alloc(64, 0x8b4c1f3e);
+            doNotOptimize(ptr);
+            eez::free(ptr);
+        }
+        return 1000;
+    });
+
+    // random sizes with many live blocks, i.e. fragmented heap
+    static const int NUM_LIVE_BLOCKS = 4096;
+    static void *blocks[NUM_LIVE_BLOCKS];
+    for (int i = 0; i < NUM_LIVE_BLOCKS; i++) {
+        blocks[i] = eez::alloc(16 + nextRandom() % 1024, 0x8b4c1f3e);
+    }
+
+    measure("alloc_free_fragmented", []() {
+        for (int i = 0; i < 1000; i++) {
+            auto &block = blocks[nextRandom() % NUM_LIVE_BLOCKS];
+            eez::free(block);
+            block = eez::alloc(16 + nextRandom() % 1024, 0x8b4c1f3e);
+            doNotOptimize(block);
+        }
+        return 1000;
+    });
+
+    AllocInfo allocInfo;
+    getAllocInfo(allocInfo);
+    char extra[256];
+    snprintf(extra, sizeof(extra),
+        "\"free\": %u, \"alloc\": %u, \"largest_free_block\": %u, \"num_free_blocks\": %u, \"fragmentation\": %u",
+        (unsigned)allocInfo.free, (unsigned)allocInfo.alloc, (unsigned)allocInfo.largestFreeBlock,
+        (unsigned)allocInfo.numFreeBlocks, (unsigned)allocInfo.fragmentation);
+    g_results.back().extra = extra;
+
+    for (int i = 0; i < NUM_LIVE_BLOCKS; i++) {
+        eez::free(blocks[i]);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void measureValueCopy(const char *name, const Value &value) {
+    measure(name, [&]() {
+        for (int i = 0; i < 1000; i++) {
+            Value copy = value;
+            doNotOptimize(copy);
+        }
+        return 1000;
+    });
+}
+
+void benchmarkValue() {
+    measureValueCopy("value_copy_int", Value(42, VALUE_TYPE_INT32));
+    measureValueCopy("value_copy_double", Value(3.14, VALUE_TYPE_DOUBLE));
+    // ref counted values, copy is inc + dec of the ref counter
+    measureValueCopy("value_copy_string_ref", Value::makeStringRef("Hello, world!", -1, 0x5d1e2a7f));
+    auto arrayValue = Value::makeArrayRef(16, defs_v3::ARRAY_TYPE_INTEGER, 0x5d1e2a7f);
+    measureValueCopy("value_copy_array_ref", arrayValue);
+
+    struct ToTextCase {
+        const char *name;
+        Value value;
+    } toTextCases[] = {
+        { "value_to_text_int", Value(123456, VALUE_TYPE_INT32) },
+        { "value_to_text_float", Value(3.14159f, VALUE_TYPE_FLOAT) },
+        { "value_to_text_double", Value(-2.718281828, VALUE_TYPE_DOUBLE) },
+        { "value_to_text_bool", Value(true, VALUE_TYPE_BOOLEAN) },
+        { "value_to_text_string", Value("Hello, world!", VALUE_TYPE_STRING) },
+    };
+    for (auto &toTextCase : toTextCases) {
+        auto &value = toTextCase.value;
+        measure(toTextCase.name, [&]() {
+            char text[64];
+            for (int i = 0; i < 1000; i++) {
+                value.toText(text, sizeof(text));
+                doNotOptimize(text);
+            }
+            return 1000;
+        });
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void writeJson(FILE *file) {
+    fprintf(file, "{\n");
+    fprintf(file, "  \"framework\": \"eez-framework\",\n");
+    fprintf(file, "  \"config\": {\n");
+#if defined(EEZ_OPTION_ALLOC_TLSF) && EEZ_OPTION_ALLOC_TLSF
+    fprintf(file, "    \"allocator\": \"tlsf\",\n");
+#else
+    fprintf(file, "    \"allocator\": \"first-fit\",\n");
+#endif
+    fprintf(file, "    \"compiled_expressions\": %d,\n", (int)EEZ_FLOW_EVAL_COMPILE_EXPRESSIONS);
+    fprintf(file, "    \"scheduler\": %d,\n", (int)EEZ_FLOW_SCHEDULER);
+    fprintf(file, "    \"time_ms\": %u\n", (unsigned)g_timeMs);
+    fprintf(file, "  },\n");
+    fprintf(file, "  \"results\": [\n");
+    for (size_t i = 0; i < g_results.size(); i++) {
+        auto &result = g_results[i];
+        fprintf(file, "    { \"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.2f, \"ops_per_second\": %.0f%s%s }%s\n",
+            result.name.c_str(),
+            (unsigned long long)result.iterations,
+            result.iterations ? (double)result.durationNs / result.iterations : 0.0,
+            result.durationNs ? result.iterations * 1E9 / result.durationNs : 0.0,
+            result.extra.empty() ? "" : ", ",
+            result.extra.c_str(),
+            i + 1 < g_results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n");
+    fprintf(file, "}\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const char *assetsFilePath = nullptr;
+    const char *outputFilePath = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--time-ms") && i + 1 < argc) {
+            g_timeMs = (uint32_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--assets") && i + 1 < argc) {
+            assetsFilePath = argv[++i];
+        } else if (!strcmp(argv[i], "--output") && i + 1 < argc) {
+            outputFilePath = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--time-ms N] [--assets path] [--output path]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    initMemory();
+    initAllocHeap(ALLOC_BUFFER, ALLOC_BUFFER_SIZE);
+
+    benchmarkSyntheticFlow();
+    if (assetsFilePath) {
+        benchmarkRecordedFlow(assetsFilePath);
+    }
+    benchmarkAlloc();
+    benchmarkValue();
+
+    if (outputFilePath) {
+        auto file = fopen(outputFilePath, "w");
+        if (!file) {
+            fprintf(stderr, "can't create %s\n", outputFilePath);
+            return 1;
+        }
+        writeJson(file);
+        fclose(file);
+    } else {
+        writeJson(stdout);
+    }
+
+    return 0;
+}
@@ -0,0 +1,273 @@
+/*
+ * eez-framework
+ *
+ * MIT License
+ * Copyright 2024 Envox d.o.o.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <eez/conf-internal.h>
+
+#include <assert.h>
+#include <string.h>
+#include <initializer_list>
+#include <new>
+
+#include <eez/core/assets.h>
+#include <eez/flow/private.h>
+#include <eez/flow/components/set_variable.h>
+
+#include "synthetic_assets.h"
+
+namespace eez {
+namespace benchmark {
+
+using namespace eez::flow;
+
+static const size_t MAX_IMAGE_SIZE = 16 * 1024;
+
+alignas(8) static uint8_t g_image[MAX_IMAGE_SIZE];
+static uint32_t g_imageSize;
+
+// Memory layout of ListOfAssetsPtr and ListOfFundamentalType
+struct AssetsList {
+    uint32_t count;
+    int32_t items;
+};
+
+static_assert(sizeof(AssetsList) == sizeof(ListOfAssetsPtr<Value>), "unexpected ListOfAssetsPtr layout");
+static_assert(sizeof(AssetsList) == sizeof(ListOfFundamentalType<uint16_t>), "unexpected ListOfFundamentalType layout");
+
+template<typename T>
+static T *allocImage(uint32_t count = 1) {
+    g_imageSize = (g_imageSize + 7) & ~7;
+    auto ptr = g_image + g_imageSize;
+    g_imageSize += count * sizeof(T);
+    assert(g_imageSize <= MAX_IMAGE_SIZE);
+    memset(ptr, 0, count * sizeof(T));
+    return (T *)ptr;
+}
+
+static void setOffset(void *field, const void *target) {
+    *(int32_t *)field = (int32_t)((const uint8_t *)target - (const uint8_t *)field);
+}
+
+template<typename T>
+static T **setList(void *list, uint32_t count) {
+    auto assetsList = (AssetsList *)list;
+    assetsList->count = count;
+    auto offsets = allocImage<int32_t>(count);
+    setOffset(&assetsList->items, offsets);
+    return (T **)offsets;
+}
+
+template<typename T>
+static void setListItem(T **items, uint32_t i, const T *item) {
+    setOffset((int32_t *)items + i, item);
+}
+
+template<typename T>
+static T *setFundamentalList(void *list, uint32_t count) {
+    auto assetsList = (AssetsList *)list;
+    assetsList->count = count;
+    auto items = allocImage<T>(count);
+    setOffset(&assetsList->items, items);
+    return items;
+}
+
+static const uint8_t *addExpression(std::initializer_list<uint16_t> instructions) {
+    auto expression = allocImage<uint16_t>((uint32_t)instructions.size());
+    uint32_t i = 0;
+    for (auto instruction : instructions) {
+        expression[i++] = instruction;
+    }
+    return (const uint8_t *)expression;
+}
+
+static void addOutput(Component *component, uint16_t targetComponentIndex, uint16_t targetInputIndex) {
+    auto outputs = setList<ComponentOutput>(&component->outputs, 1);
+    auto output = allocImage<ComponentOutput>();
+    output->isSeqOut = 1;
+    setListItem(outputs, 0, output);
+
+    auto connections = setList<Connection>(&output->connections, 1);
+    auto connection = allocImage<Connection>();
+    connection->targetComponentIndex = targetComponentIndex;
+    connection->targetInputIndex = targetInputIndex;
+    setListItem(connections, 0, connection);
+}
+
+static void addSeqInput(Component *component, uint16_t inputIndex) {
+    auto inputs = setFundamentalList<uint16_t>(&component->inputs, 1);
+    inputs[0] = inputIndex;
+}
+
+enum {
+    CONSTANT_UNDEFINED = UNDEFINED_VALUE_INDEX,
+    CONSTANT_NULL = NULL_VALUE_INDEX,
+    CONSTANT_ONE,
+    CONSTANT_TWO,
+    CONSTANT_TEN,
+    CONSTANT_ONE_AND_HALF,
+    CONSTANT_STRING,
+    NUM_CONSTANTS
+};
+
+enum {
+    GLOBAL_VARIABLE_COUNTER = SYNTHETIC_COUNTER_GLOBAL_VARIABLE,
+    GLOBAL_VARIABLE_LIMIT,
+    NUM_GLOBAL_VARIABLES
+};
+
+enum {
+    COMPONENT_START,
+    COMPONENT_SET_VARIABLE,
+    COMPONENT_NOOP,
+    NUM_COMPONENTS
+};
+
+static_assert(COMPONENT_NOOP == SYNTHETIC_EXPRESSIONS_COMPONENT_INDEX, "expressions are owned by Noop component");
+
+static const uint16_t PUSH_CONSTANT = EXPR_EVAL_INSTRUCTION_TYPE_PUSH_CONSTANT;
+static const uint16_t PUSH_GLOBAL_VAR = EXPR_EVAL_INSTRUCTION_TYPE_PUSH_GLOBAL_VAR;
+static const uint16_t OPERATION = EXPR_EVAL_INSTRUCTION_TYPE_OPERATION;
+static const uint16_t END = EXPR_EVAL_INSTRUCTION_TYPE_END;
+
+void buildSyntheticAssets(SyntheticAssets &syntheticAssets) {
+    g_imageSize = 0;
+
+    // image starts with HEADER_TAG followed by Assets, see loadMainAssets
+    *(uint32_t *)g_image = HEADER_TAG;
+    auto assets = new (g_image + sizeof(uint32_t)) Assets;
+    g_imageSize = sizeof(uint32_t) + sizeof(Assets);
+    assets->projectMajorVersion = PROJECT_VERSION_V3;
+    assets->assetsType = ASSETS_TYPE_FIRMWARE;
+
+    auto settings = allocImage<Settings>();
+    assets->settings = settings;
+
+    auto flowDefinition = new (allocImage<FlowDefinition>()) FlowDefinition;
+    assets->flowDefinition = flowDefinition;
+
+    // constants
+    auto constants = setList<Value>(&flowDefinition->constants, NUM_CONSTANTS);
+    auto constantValues = allocImage<Value>(NUM_CONSTANTS);
+    for (uint32_t i = 0; i < NUM_CONSTANTS; i++) {
+        new (constantValues + i) Value();
+        setListItem(constants, i, constantValues + i);
+    }
+    constantValues[CONSTANT_NULL].type = VALUE_TYPE_NULL;
+    constantValues[CONSTANT_ONE] = Value(1, VALUE_TYPE_INT32);
+    constantValues[CONSTANT_TWO] = Value(2, VALUE_TYPE_INT32);
+    constantValues[CONSTANT_TEN] = Value(10, VALUE_TYPE_INT32);
+    constantValues[CONSTANT_ONE_AND_HALF] = Value(1.5f, VALUE_TYPE_FLOAT);
+    static const char VALUE_PREFIX[] = "value: ";
+    auto str = allocImage<char>(sizeof(VALUE_PREFIX));
+    memcpy(str, VALUE_PREFIX, sizeof(VALUE_PREFIX));
+    constantValues[CONSTANT_STRING].type = VALUE_TYPE_STRING_ASSET;
+    setOffset(&constantValues[CONSTANT_STRING].int32Value, str);
+
+    // global variables
+    auto globalVariables = setList<Value>(&flowDefinition->globalVariables, NUM_GLOBAL_VARIABLES);
+    auto globalVariableValues = allocImage<Value>(NUM_GLOBAL_VARIABLES);
+    new (globalVariableValues + GLOBAL_VARIABLE_COUNTER) Value(0, VALUE_TYPE_INT32);
+    new (globalVariableValues + GLOBAL_VARIABLE_LIMIT) Value(1000, VALUE_TYPE_INT32);
+    for (uint32_t i = 0; i < NUM_GLOBAL_VARIABLES; i++) {
+        setListItem(globalVariables, i, globalVariableValues + i);
+    }
+
+    // flow
+    auto flows = setList<Flow>(&flowDefinition->flows, 1);
+    auto flow = new (allocImage<Flow>()) Flow;
+    setListItem(flows, 0, flow);
+
+    auto componentInputs = setFundamentalList<ComponentInput>(&flow->componentInputs, 2);
+    componentInputs[0] = COMPONENT_INPUT_FLAG_IS_SEQ_INPUT; // SetVariable seq input
+    componentInputs[1] = COMPONENT_INPUT_FLAG_IS_SEQ_INPUT; // Noop seq input
+
+    auto components = setList<Component>(&flow->components, NUM_COMPONENTS);
+
+    auto start = new (allocImage<Component>()) Component;
+    start->type = defs_v3::COMPONENT_TYPE_START_ACTION;
+    start->errorCatchOutput = -1;
+    addOutput(start, COMPONENT_SET_VARIABLE, 0);
+    setListItem(components, COMPONENT_START, start);
+
+    auto setVariable = new (allocImage<SetVariableActionComponent>()) SetVariableActionComponent;
+    setVariable->type = defs_v3::COMPONENT_TYPE_SET_VARIABLE_ACTION;
+    setVariable->errorCatchOutput = -1;
+    addSeqInput(setVariable, 0);
+    addOutput(setVariable, COMPONENT_NOOP, 1);
+    auto entries = setList<SetVariableEntry>(&setVariable->entries, 1);
+    auto entry = allocImage<SetVariableEntry>();
+    setOffset(&entry->variable, addExpression({ PUSH_GLOBAL_VAR | GLOBAL_VARIABLE_COUNTER, END }));
+    setOffset(&entry->value, addExpression({
+        PUSH_GLOBAL_VAR | GLOBAL_VARIABLE_COUNTER,
+        PUSH_CONSTANT | CONSTANT_ONE,
+        OPERATION | defs_v3::OPERATION_TYPE_ADD,
+        END
+    }));
+    setListItem(entries, 0, entry);
+    setListItem(components, COMPONENT_SET_VARIABLE, (Component *)setVariable);
+
+    auto noop = new (allocImage<Component>()) Component;
+    noop->type = defs_v3::COMPONENT_TYPE_NOOP_ACTION;
+    noop->errorCatchOutput = -1;
+    addSeqInput(noop, 1);
+    addOutput(noop, COMPONENT_SET_VARIABLE, 0);
+    setListItem(components, COMPONENT_NOOP, noop);
+
+    // expressions evaluated by the benchmark, stored as Noop properties
+    auto expressions = syntheticAssets.expressions;
+    auto expressionNames = syntheticAssets.expressionNames;
+
+    expressionNames[SYNTHETIC_EXPRESSION_CONSTANT] = "constant";
+    expressions[SYNTHETIC_EXPRESSION_CONSTANT] = addExpression({ PUSH_CONSTANT | CONSTANT_TEN, END });
+
+    expressionNames[SYNTHETIC_EXPRESSION_GLOBAL_VARIABLE] = "global_variable";
+    expressions[SYNTHETIC_EXPRESSION_GLOBAL_VARIABLE] = addExpression({ PUSH_GLOBAL_VAR | GLOBAL_VARIABLE_COUNTER, END });
+
+    expressionNames[SYNTHETIC_EXPRESSION_ARITHMETIC] = "arithmetic";
+    expressions[SYNTHETIC_EXPRESSION_ARITHMETIC] = addExpression({
+        PUSH_GLOBAL_VAR | GLOBAL_VARIABLE_COUNTER,
+        PUSH_CONSTANT | CONSTANT_TWO,
+        OPERATION | defs_v3::OPERATION_TYPE_MUL,
+        PUSH_CONSTANT | CONSTANT_TEN,
+        OPERATION | defs_v3::OPERATION_TYPE_ADD,
+        PUSH_GLOBAL_VAR | GLOBAL_VARIABLE_LIMIT,
+        OPERATION | defs_v3::OPERATION_TYPE_GREATER,
+        END
+    });
+
+    expressionNames[SYNTHETIC_EXPRESSION_CONDITIONAL] = "conditional";
+    expressions[SYNTHETIC_EXPRESSION_CONDITIONAL] = addExpression({
+        PUSH_GLOBAL_VAR | GLOBAL_VARIABLE_COUNTER,
+        PUSH_CONSTANT | CONSTANT_TEN,
+        OPERATION | defs_v3::OPERATION_TYPE_GREATER,
+        PUSH_CONSTANT | CONSTANT_ONE_AND_HALF,
+        PUSH_CONSTANT | CONSTANT_TWO,
+        OPERATION | defs_v3::OPERATION_TYPE_CONDITIONAL,
+        END
+    });
+
+    expressionNames[SYNTHETIC_EXPRESSION_STRING_CONCAT] = "string_concat";
+    expressions[SYNTHETIC_EXPRESSION_STRING_CONCAT] = addExpression({
+        PUSH_CONSTANT | CONSTANT_STRING,
+        PUSH_GLOBAL_VAR | GLOBAL_VARIABLE_COUNTER,
+        OPERATION | defs_v3::OPERATION_TYPE_ADD,
+        END
+    });
+
+    auto properties = setList<Property>(&noop->properties, NUM_SYNTHETIC_EXPRESSIONS);
+    for (uint32_t i = 0; i < NUM_SYNTHETIC_EXPRESSIONS; i++) {
+        setListItem(properties, i, (const Property *)expressions[i]);
+    }
+
+    syntheticAssets.image = g_image;
+    syntheticAssets.imageSize = g_imageSize;
+}
+
+} // namespace benchmark
+} // namespace eez
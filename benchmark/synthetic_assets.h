@@ -0,0 +1,52 @@
+/*
+ * eez-framework
+ *
+ * MIT License
+ * Copyright 2024 Envox d.o.o.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace eez {
+namespace benchmark {
+
+// Global variable incremented by the synthetic flow on every loop iteration,
+// one iteration executes SYNTHETIC_COMPONENTS_PER_LOOP components.
+static const uint32_t SYNTHETIC_COUNTER_GLOBAL_VARIABLE = 0;
+static const uint32_t SYNTHETIC_COMPONENTS_PER_LOOP = 2;
+
+// Component which owns expression properties below (used as componentIndex in evalExpression)
+static const int SYNTHETIC_EXPRESSIONS_COMPONENT_INDEX = 2;
+
+enum SyntheticExpression {
+    SYNTHETIC_EXPRESSION_CONSTANT, // 10
+    SYNTHETIC_EXPRESSION_GLOBAL_VARIABLE, // counter
+    SYNTHETIC_EXPRESSION_ARITHMETIC, // counter * 2 + 10 > limit
+    SYNTHETIC_EXPRESSION_CONDITIONAL, // counter > 10 ? 1.5 : 2
+    SYNTHETIC_EXPRESSION_STRING_CONCAT, // "value: " + counter
+    NUM_SYNTHETIC_EXPRESSIONS
+};
+
+struct SyntheticAssets {
+    const uint8_t *image; // starts with HEADER_TAG, pass it to loadMainAssets
+    uint32_t imageSize;
+    const uint8_t *expressions[NUM_SYNTHETIC_EXPRESSIONS];
+    const char *expressionNames[NUM_SYNTHETIC_EXPRESSIONS];
+};
+
+// Builds uncompressed assets with a single flow:
+//
+//   Start -> SetVariable (counter = counter + 1) -> Noop -+
+//                 ^                                       |
+//                 +---------------------------------------+
+//
+// i.e. the flow never ends and every tick executes as many components as the tick budget allows.
+void buildSyntheticAssets(SyntheticAssets &syntheticAssets);
+
+} // namespace benchmark
+} // namespace eez
@@ -58,9 +58,37 @@
         #ifndef EEZ_OPTION_GUI_ANIMATIONS
             #define EEZ_OPTION_GUI_ANIMATIONS 1
         #endif
+        // Use SSE2/AVX2/NEON/WASM SIMD kernels in the simulator software renderer
+        #ifndef EEZ_OPTION_GUI_SIMD
+            #define EEZ_OPTION_GUI_SIMD 1
+        #endif
+        // Number of entries in the measured text width cache (0 to disable)
+        #ifndef EEZ_OPTION_GUI_TEXT_MEASURE_CACHE
+            #define EEZ_OPTION_GUI_TEXT_MEASURE_CACHE 16
+        #endif
+        // Max. number of widgets in the per-frame touch hit-testing index (0 to disable)
+        #ifndef EEZ_OPTION_GUI_TOUCH_INDEX
+            #define EEZ_OPTION_GUI_TOUCH_INDEX 256
+        #endif
+        // Skip enumeration of the container widgets whose subtree reads only flow data that hasn't changed
+        // (needs EEZ_FLOW_WATCH_CHANGE_TRACKING, otherwise all the flow data is considered changed).
+        // Focus and style overrides done by the hooks are not tracked, so when enabled the application
+        // must call refreshScreen() after changing those.
+        #ifndef EEZ_OPTION_GUI_SUBTREE_SKIPPING
+            #define EEZ_OPTION_GUI_SUBTREE_SKIPPING 0
+        #endif
+        // Number of worker threads the simulator software renderer uses for large pixel operations (0 to disable)
+        #ifndef EEZ_OPTION_GUI_RENDER_THREADS
+            #define EEZ_OPTION_GUI_RENDER_THREADS 0
+        #endif
     #endif
 #endif
 
+// Use O(1) TLSF allocator instead of the first-fit one (not used with LVGL, it has its own allocator)
+#ifndef EEZ_OPTION_ALLOC_TLSF
+#define EEZ_OPTION_ALLOC_TLSF 0
+#endif
+
 #ifndef EEZ_FOR_LVGL_LZ4_OPTION
 #define EEZ_FOR_LVGL_LZ4_OPTION 1
 #endif
@@ -14,6 +14,7 @@
 #include <math.h>
 #include <assert.h>
 #include <string.h>
+#include <stddef.h>
 
 #if defined(EEZ_FOR_LVGL)
 #ifdef LV_LVGL_H_INCLUDE_SIMPLE
@@ -68,6 +69,18 @@ void getAllocInfo(uint32_t &free, uint32_t &alloc) {
 	alloc = mon.total_size - mon.free_size;
 }
 
+void getAllocInfo(AllocInfo &allocInfo) {
+    lv_mem_monitor_t mon;
+    lv_mem_monitor(&mon);
+    allocInfo.free = mon.free_size;
+    allocInfo.alloc = mon.total_size - mon.free_size;
+    allocInfo.maxAlloc = mon.max_used;
+    allocInfo.largestFreeBlock = mon.free_biggest_size;
+    allocInfo.numFreeBlocks = mon.free_cnt;
+    allocInfo.numAllocBlocks = mon.used_cnt;
+    allocInfo.fragmentation = mon.frag_pct;
+}
+
 #elif defined(EEZ_DASHBOARD_API)
 
 #include <emscripten/heap.h>
@@ -93,6 +106,346 @@ void getAllocInfo(uint32_t &free, uint32_t &alloc) {
 	alloc = emscripten_get_heap_size();
 }
 
+void getAllocInfo(AllocInfo &allocInfo) {
+    memset(&allocInfo, 0, sizeof(AllocInfo));
+    getAllocInfo(allocInfo.free, allocInfo.alloc);
+    allocInfo.maxAlloc = allocInfo.alloc;
+}
+
+#elif EEZ_OPTION_ALLOC_TLSF
+
+// Two-Level Segregated Fit allocator (http://www.gii.upv.es/tlsf/).
+// Free blocks are kept in segregated lists indexed by two levels of bitmaps, so both
+// alloc and free are O(1). Requests smaller than SMALL_BLOCK_SIZE are served from exact
+// size classes (ALIGNMENT apart), which is where small Ref objects end up.
+
+static const size_t ALIGNMENT_LOG2 = 3;
+static const size_t ALIGNMENT = 1 << ALIGNMENT_LOG2;
+
+static const unsigned SL_INDEX_COUNT_LOG2 = 5;
+static const unsigned SL_INDEX_COUNT = 1 << SL_INDEX_COUNT_LOG2;
+static const unsigned FL_INDEX_SHIFT = SL_INDEX_COUNT_LOG2 + ALIGNMENT_LOG2;
+static const unsigned FL_INDEX_MAX = 30;
+static const unsigned FL_INDEX_COUNT = FL_INDEX_MAX - FL_INDEX_SHIFT + 1;
+static const size_t SMALL_BLOCK_SIZE = (size_t)1 << FL_INDEX_SHIFT;
+
+struct AllocBlock {
+    AllocBlock *prevPhysBlock;
+	size_t size;
+	uint32_t free;
+	uint32_t id;
+
+    // valid only for free blocks, these are stored inside block payload
+    AllocBlock *nextFree;
+    AllocBlock *prevFree;
+};
+
+static const size_t HEADER_SIZE = (offsetof(AllocBlock, nextFree) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+static const size_t MIN_BLOCK_SIZE = (sizeof(AllocBlock) - HEADER_SIZE + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
+static AllocBlock *g_firstBlock;
+
+static uint32_t g_flBitmap;
+static uint32_t g_slBitmap[FL_INDEX_COUNT];
+static AllocBlock *g_freeBlocks[FL_INDEX_COUNT][SL_INDEX_COUNT];
+
+static size_t g_freeSize;
+static size_t g_allocSize;
+static size_t g_maxAllocSize;
+
+#if defined(EEZ_PLATFORM_STM32)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wparentheses"
+#endif
+
+EEZ_MUTEX_DECLARE(alloc);
+
+#if defined(EEZ_PLATFORM_STM32)
+#pragma GCC diagnostic pop
+#endif
+
+// index of the least significant set bit, word must not be 0
+static inline unsigned ffsBit(uint32_t word) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, word);
+    return index;
+#else
+    return __builtin_ctz(word);
+#endif
+}
+
+// index of the most significant set bit, size must not be 0
+static inline unsigned flsBit(size_t size) {
+#if defined(_MSC_VER)
+    unsigned long index;
+#if defined(_WIN64)
+    _BitScanReverse64(&index, size);
+#else
+    _BitScanReverse(&index, size);
+#endif
+    return index;
+#else
+    if (sizeof(size_t) > sizeof(unsigned long)) {
+        return 63 - __builtin_clzll(size);
+    }
+    return sizeof(unsigned long) * 8 - 1 - __builtin_clzl(size);
+#endif
+}
+
+static inline void mappingInsert(size_t size, unsigned &fl, unsigned &sl) {
+    if (size < SMALL_BLOCK_SIZE) {
+        fl = 0;
+        sl = (unsigned)(size / (SMALL_BLOCK_SIZE / SL_INDEX_COUNT));
+    } else {
+        auto bit = flsBit(size);
+        sl = (unsigned)(size >> (bit - SL_INDEX_COUNT_LOG2)) ^ SL_INDEX_COUNT;
+        fl = bit - (FL_INDEX_SHIFT - 1);
+    }
+}
+
+// same as mappingInsert, but rounds up to the next size class so that any block
+// found in the returned list is big enough
+static inline void mappingSearch(size_t size, unsigned &fl, unsigned &sl) {
+    if (size >= SMALL_BLOCK_SIZE) {
+        size += ((size_t)1 << (flsBit(size) - SL_INDEX_COUNT_LOG2)) - 1;
+    }
+    mappingInsert(size, fl, sl);
+}
+
+static inline AllocBlock *getNextPhysBlock(AllocBlock *block) {
+    return (AllocBlock *)((uint8_t *)block + HEADER_SIZE + block->size);
+}
+
+static void insertFreeBlock(AllocBlock *block) {
+    unsigned fl, sl;
+    mappingInsert(block->size, fl, sl);
+
+    auto head = g_freeBlocks[fl][sl];
+    block->prevFree = nullptr;
+    block->nextFree = head;
+    if (head) {
+        head->prevFree = block;
+    }
+    g_freeBlocks[fl][sl] = block;
+
+    g_flBitmap |= 1u << fl;
+    g_slBitmap[fl] |= 1u << sl;
+
+    g_freeSize += block->size;
+}
+
+static void removeFreeBlock(AllocBlock *block) {
+    unsigned fl, sl;
+    mappingInsert(block->size, fl, sl);
+
+    if (block->prevFree) {
+        block->prevFree->nextFree = block->nextFree;
+    } else {
+        g_freeBlocks[fl][sl] = block->nextFree;
+        if (!block->nextFree) {
+            g_slBitmap[fl] &= ~(1u << sl);
+            if (!g_slBitmap[fl]) {
+                g_flBitmap &= ~(1u << fl);
+            }
+        }
+    }
+
+    if (block->nextFree) {
+        block->nextFree->prevFree = block->prevFree;
+    }
+
+    g_freeSize -= block->size;
+}
+
+static AllocBlock *findFreeBlock(size_t size) {
+    unsigned fl, sl;
+    mappingSearch(size, fl, sl);
+    if (fl >= FL_INDEX_COUNT) {
+        return nullptr;
+    }
+
+    uint32_t slMap = g_slBitmap[fl] & (~0u << sl);
+    if (!slMap) {
+        uint32_t flMap = fl + 1 < FL_INDEX_COUNT ? g_flBitmap & (~0u << (fl + 1)) : 0;
+        if (!flMap) {
+            return nullptr;
+        }
+        fl = ffsBit(flMap);
+        slMap = g_slBitmap[fl];
+    }
+    sl = ffsBit(slMap);
+
+    return g_freeBlocks[fl][sl];
+}
+
+void initAllocHeap(uint8_t *heap, size_t heapSize) {
+    auto heapStart = ((uintptr_t)heap + ALIGNMENT - 1) & ~(uintptr_t)(ALIGNMENT - 1);
+    heapSize -= heapStart - (uintptr_t)heap;
+
+    g_flBitmap = 0;
+    memset(g_slBitmap, 0, sizeof(g_slBitmap));
+    memset(g_freeBlocks, 0, sizeof(g_freeBlocks));
+    g_freeSize = 0;
+    g_allocSize = 0;
+    g_maxAllocSize = 0;
+
+    // one big free block followed by the zero sized sentinel block which is never free
+	g_firstBlock = (AllocBlock *)heapStart;
+	g_firstBlock->prevPhysBlock = nullptr;
+	g_firstBlock->size = (heapSize - 2 * HEADER_SIZE) & ~(ALIGNMENT - 1);
+	g_firstBlock->free = 1;
+    g_firstBlock->id = 0;
+
+    auto sentinel = getNextPhysBlock(g_firstBlock);
+    sentinel->prevPhysBlock = g_firstBlock;
+    sentinel->size = 0;
+    sentinel->free = 0;
+    sentinel->id = 0;
+
+    insertFreeBlock(g_firstBlock);
+
+	EEZ_MUTEX_CREATE(alloc);
+}
+
+void *alloc(size_t size, uint32_t id) {
+	if (size == 0) {
+		return nullptr;
+	}
+
+	if (EEZ_MUTEX_WAIT(alloc, osWaitForever)) {
+		size = ((size + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT;
+        if (size < MIN_BLOCK_SIZE) {
+            size = MIN_BLOCK_SIZE;
+        }
+
+        auto block = findFreeBlock(size);
+		if (!block) {
+			EEZ_MUTEX_RELEASE(alloc);
+			return nullptr;
+		}
+
+        removeFreeBlock(block);
+
+		if (block->size >= size + HEADER_SIZE + MIN_BLOCK_SIZE) {
+			// remaining size is enough to create a new block
+			auto newBlock = (AllocBlock *)((uint8_t *)block + HEADER_SIZE + size);
+			newBlock->prevPhysBlock = block;
+			newBlock->size = block->size - size - HEADER_SIZE;
+			newBlock->free = 1;
+            newBlock->id = 0;
+            getNextPhysBlock(newBlock)->prevPhysBlock = newBlock;
+
+			block->size = size;
+
+            insertFreeBlock(newBlock);
+		}
+
+		block->free = 0;
+		block->id = id;
+
+        g_allocSize += block->size;
+        if (g_allocSize > g_maxAllocSize) {
+            g_maxAllocSize = g_allocSize;
+        }
+
+		EEZ_MUTEX_RELEASE(alloc);
+
+		return (uint8_t *)block + HEADER_SIZE;
+	}
+
+	return nullptr;
+}
+
+void free(void *ptr) {
+	if (ptr == 0) {
+		return;
+	}
+
+	if (EEZ_MUTEX_WAIT(alloc, osWaitForever)) {
+        auto block = (AllocBlock *)((uint8_t *)ptr - HEADER_SIZE);
+
+		if (block->free) {
+			assert(false);
+			EEZ_MUTEX_RELEASE(alloc);
+			return;
+		}
+
+		// reset memory to catch errors when memory is used after free is called
+		memset(ptr, 0xCC, block->size);
+
+        g_allocSize -= block->size;
+
+        block->free = 1;
+
+        // merge with next block
+        auto nextBlock = getNextPhysBlock(block);
+        if (nextBlock->free) {
+            removeFreeBlock(nextBlock);
+            block->size += HEADER_SIZE + nextBlock->size;
+            getNextPhysBlock(block)->prevPhysBlock = block;
+        }
+
+        // merge with previous block
+        auto prevBlock = block->prevPhysBlock;
+        if (prevBlock && prevBlock->free) {
+            removeFreeBlock(prevBlock);
+            prevBlock->size += HEADER_SIZE + block->size;
+            getNextPhysBlock(prevBlock)->prevPhysBlock = prevBlock;
+            block = prevBlock;
+        }
+
+        insertFreeBlock(block);
+
+		EEZ_MUTEX_RELEASE(alloc);
+	}
+}
+
+template<typename T> void freeObject(T *ptr) {
+	ptr->~T();
+	free(ptr);
+}
+
+#if OPTION_SCPI
+void dumpAlloc(scpi_t *context) {
+	for (AllocBlock *block = g_firstBlock; block->size > 0; block = getNextPhysBlock(block)) {
+		char buffer[100];
+		if (block->free) {
+			snprintf(buffer, sizeof(buffer), "FREE: %d", (int)block->size);
+		} else {
+			snprintf(buffer, sizeof(buffer), "ALOC (0x%08x): %d", (unsigned int)block->id, (int)block->size);
+		}
+		SCPI_ResultText(context, buffer);
+	}
+}
+#endif
+
+void getAllocInfo(uint32_t &free, uint32_t &alloc) {
+	free = g_freeSize;
+	alloc = g_allocSize;
+}
+
+void getAllocInfo(AllocInfo &allocInfo) {
+    memset(&allocInfo, 0, sizeof(AllocInfo));
+	if (EEZ_MUTEX_WAIT(alloc, osWaitForever)) {
+        for (AllocBlock *block = g_firstBlock; block->size > 0; block = getNextPhysBlock(block)) {
+			if (block->free) {
+                allocInfo.numFreeBlocks++;
+                if (block->size > allocInfo.largestFreeBlock) {
+                    allocInfo.largestFreeBlock = block->size;
+                }
+			} else {
+                allocInfo.numAllocBlocks++;
+			}
+        }
+        allocInfo.free = g_freeSize;
+        allocInfo.alloc = g_allocSize;
+        allocInfo.maxAlloc = g_maxAllocSize;
+		EEZ_MUTEX_RELEASE(alloc);
+	}
+    allocInfo.fragmentation = allocInfo.free > 0 ? 100 - (uint32_t)(100ULL * allocInfo.largestFreeBlock / allocInfo.free) : 0;
+}
+
 #else
 
 static const size_t ALIGNMENT = 64;
@@ -107,6 +460,9 @@ struct AllocBlock {
 
 static uint8_t *g_heap;
 
+static size_t g_allocSize;
+static size_t g_maxAllocSize;
+
 #if defined(EEZ_PLATFORM_STM32)
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wparentheses"
@@ -126,6 +482,9 @@ void initAllocHeap(uint8_t *heap, size_t heapSize) {
 	first->free = 1;
 	first->size = heapSize - sizeof(AllocBlock);
 
+    g_allocSize = 0;
+    g_maxAllocSize = 0;
+
 	EEZ_MUTEX_CREATE(alloc);
 }
 
@@ -169,6 +528,11 @@ void *alloc(size_t size, uint32_t id) {
 		block->free = 0;
 		block->id = id;
 
+        g_allocSize += block->size;
+        if (g_allocSize > g_maxAllocSize) {
+            g_maxAllocSize = g_allocSize;
+        }
+
 		EEZ_MUTEX_RELEASE(alloc);
 
 		return block + 1;
@@ -202,6 +566,8 @@ void free(void *ptr) {
 		// reset memory to catch errors when memory is used after free is called
 		memset(ptr, 0xCC, block->size);
 
+        g_allocSize -= block->size;
+
 		auto nextBlock = block->next;
 		if (nextBlock && nextBlock->free) {
 			if (prevBlock && prevBlock->free) {
@@ -267,6 +633,27 @@ void getAllocInfo(uint32_t &free, uint32_t &alloc) {
 	}
 }
 
+void getAllocInfo(AllocInfo &allocInfo) {
+    memset(&allocInfo, 0, sizeof(AllocInfo));
+	if (EEZ_MUTEX_WAIT(alloc, osWaitForever)) {
+		for (AllocBlock *block = (AllocBlock *)g_heap; block; block = block->next) {
+			if (block->free) {
+				allocInfo.free += block->size;
+                allocInfo.numFreeBlocks++;
+                if (block->size > allocInfo.largestFreeBlock) {
+                    allocInfo.largestFreeBlock = block->size;
+                }
+			} else {
+				allocInfo.alloc += block->size;
+                allocInfo.numAllocBlocks++;
+			}
+		}
+        allocInfo.maxAlloc = g_maxAllocSize;
+		EEZ_MUTEX_RELEASE(alloc);
+	}
+    allocInfo.fragmentation = allocInfo.free > 0 ? 100 - (uint32_t)(100ULL * allocInfo.largestFreeBlock / allocInfo.free) : 0;
+}
+
 #endif
 
 } // eez
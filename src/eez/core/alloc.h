@@ -42,4 +42,16 @@ void dumpAlloc(scpi_t *context);
 
 void getAllocInfo(uint32_t &free, uint32_t &alloc);
 
+struct AllocInfo {
+    uint32_t free;
+    uint32_t alloc;
+    uint32_t maxAlloc; // high-water mark of allocated memory
+    uint32_t largestFreeBlock;
+    uint32_t numFreeBlocks;
+    uint32_t numAllocBlocks;
+    uint32_t fragmentation; // in percent, 0 if all free memory is in one block
+};
+
+void getAllocInfo(AllocInfo &allocInfo);
+
 } // eez
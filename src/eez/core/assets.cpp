@@ -19,7 +19,9 @@
 #include <eez/core/memory.h>
 #include <eez/core/debug.h>
 #include <eez/core/assets.h>
+#include <eez/core/name_index.h>
 #include <eez/flow/flow.h>
+#include <eez/flow/expression.h>
 
 #if EEZ_FOR_LVGL_LZ4_OPTION
 #include <eez/libs/lz4/lz4.h>
@@ -31,11 +33,26 @@
 using namespace eez::gui;
 #endif
 
+#if EEZ_OPTION_GUI && (defined(EEZ_PLATFORM_SIMULATOR) || defined(EEZ_PLATFORM_STM32)) && !defined(EEZ_FOR_LVGL)
+#define EEZ_EXTERNAL_ASSETS_FILE 1
+#include <eez/fs/fs.h>
+// uncompressed external assets file is mapped into memory instead of read
+#if defined(EEZ_PLATFORM_SIMULATOR) && !defined(EEZ_PLATFORM_SIMULATOR_WIN32) && !defined(__EMSCRIPTEN__)
+#define EEZ_EXTERNAL_ASSETS_MMAP 1
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#endif
+
 #if OPTION_SCPI
 #include <scpi/scpi.h>
 #else
 #define SCPI_ERROR_OUT_OF_DEVICE_MEMORY -321
 #define SCPI_ERROR_INVALID_BLOCK_DATA -161
+#define SCPI_ERROR_FILE_NAME_NOT_FOUND -256
+#define SCPI_ERROR_MASS_STORAGE_ERROR -250
 #endif
 
 namespace eez {
@@ -45,6 +62,24 @@ Assets *g_mainAssets;
 bool g_mainAssetsUncompressed;
 Assets *g_externalAssets;
 
+// memory block holding g_externalAssets, it is either allocated or mapped file
+static uint8_t *g_externalAssetsMemory;
+#if EEZ_EXTERNAL_ASSETS_MMAP
+static size_t g_externalAssetsMappedSize;
+#endif
+
+#if EEZ_OPTION_GUI
+// name lookup indexes, built on the first lookup
+struct AssetsNameIndex {
+    Assets *assets;
+    NameIndex index;
+};
+
+static AssetsNameIndex g_bitmapNameIndex;
+static AssetsNameIndex g_mainVariableNameIndex;
+static AssetsNameIndex g_externalVariableNameIndex;
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 
 void fixOffsets(Assets *assets);
@@ -141,6 +176,9 @@ static void allocMemoryForDecompressedAssets(const uint8_t *assetsData, uint32_t
     decompressedAssetsMemoryBuffer = (uint8_t *)eez::alloc(decompressedAssetsMemoryBufferSize, 0x587da194);
 }
 
+// Compressed assets are one LZ4 block decompressed as a whole. Decompressing pages, fonts
+// and bitmaps on demand would need a container with separately compressed sections from
+// the Studio build, asset references are offsets within one contiguous image.
 void loadMainAssets(const uint8_t *assets, uint32_t assetsSize) {
     auto header = (Header *)assets;
     if (header->tag == HEADER_TAG) {
@@ -161,12 +199,182 @@ void loadMainAssets(const uint8_t *assets, uint32_t assetsSize) {
     g_isMainAssetsLoaded = true;
 }
 
+#if EEZ_EXTERNAL_ASSETS_FILE
+
+static void setErr(int *err, int value) {
+    if (err) {
+        *err = value;
+    }
+}
+
+// Decompresses, if needed, assets file content into g_externalAssets.
+// Takes the ownership of the data, which must be allocated with eez::alloc.
+static bool setExternalAssetsData(uint8_t *data, uint32_t size, int *err) {
+    if (size < sizeof(uint32_t)) {
+        free(data);
+        setErr(err, SCPI_ERROR_INVALID_BLOCK_DATA);
+        return false;
+    }
+
+    auto header = (Header *)data;
+    if (header->tag == HEADER_TAG) {
+        if (size < sizeof(uint32_t) + sizeof(Assets)) {
+            free(data);
+            setErr(err, SCPI_ERROR_INVALID_BLOCK_DATA);
+            return false;
+        }
+        g_externalAssetsMemory = data;
+        g_externalAssets = (Assets *)(data + sizeof(uint32_t)/* skip HEADER_TAG*/);
+        g_externalAssets->external = true;
+    } else {
+        if (header->tag != HEADER_TAG_COMPRESSED || size < sizeof(Header)) {
+            free(data);
+            setErr(err, SCPI_ERROR_INVALID_BLOCK_DATA);
+            return false;
+        }
+
+        uint8_t *decompressedData;
+        uint32_t decompressedDataSize;
+        allocMemoryForDecompressedAssets(data, size, decompressedData, decompressedDataSize);
+        if (!decompressedData) {
+            free(data);
+            setErr(err, SCPI_ERROR_OUT_OF_DEVICE_MEMORY);
+            return false;
+        }
+
+        bool result = decompressAssetsData(data, size, (Assets *)decompressedData, decompressedDataSize, err);
+        free(data);
+        if (!result) {
+            free(decompressedData);
+            return false;
+        }
+
+        g_externalAssetsMemory = decompressedData;
+        g_externalAssets = (Assets *)decompressedData;
+        g_externalAssets->external = true;
+    }
+
+    return true;
+}
+
+#if EEZ_EXTERNAL_ASSETS_MMAP
+// Maps uncompressed assets file read-only, pages are shared with the page cache. Only the page
+// with the external flag is written (copy-on-write) before the mapping is made read-only.
+// Returns false without error if file is compressed and must be loaded and decompressed instead.
+static bool mapExternalAssets(const char *filePath, bool &mapped, int *err) {
+    mapped = false;
+
+    int fd = ::open(filePath, O_RDONLY);
+    if (fd == -1) {
+        setErr(err, SCPI_ERROR_FILE_NAME_NOT_FOUND);
+        return false;
+    }
+
+    struct stat st;
+    uint32_t tag = 0;
+    if (fstat(fd, &st) != 0 || ::read(fd, &tag, sizeof(tag)) != sizeof(tag)) {
+        ::close(fd);
+        setErr(err, SCPI_ERROR_MASS_STORAGE_ERROR);
+        return false;
+    }
+
+    if (tag != HEADER_TAG) {
+        ::close(fd);
+        return true;
+    }
+
+    if ((size_t)st.st_size < sizeof(uint32_t) + sizeof(Assets)) {
+        ::close(fd);
+        setErr(err, SCPI_ERROR_INVALID_BLOCK_DATA);
+        return false;
+    }
+
+    void *data = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        setErr(err, SCPI_ERROR_OUT_OF_DEVICE_MEMORY);
+        return false;
+    }
+
+    auto assets = (Assets *)((uint8_t *)data + sizeof(uint32_t)/* skip HEADER_TAG*/);
+    assets->external = true;
+
+    if (mprotect(data, st.st_size, PROT_READ) != 0) {
+        munmap(data, st.st_size);
+        setErr(err, SCPI_ERROR_OUT_OF_DEVICE_MEMORY);
+        return false;
+    }
+
+    g_externalAssetsMemory = (uint8_t *)data;
+    g_externalAssetsMappedSize = st.st_size;
+    g_externalAssets = assets;
+    mapped = true;
+
+    return true;
+}
+#endif
+
+// Whole assets image is kept in memory (or mapped) while loaded, same as main assets.
+bool loadExternalAssets(const char *filePath, int *err) {
+    unloadExternalAssets();
+
+#if EEZ_EXTERNAL_ASSETS_MMAP
+    bool mapped;
+    if (!mapExternalAssets(filePath, mapped, err)) {
+        return false;
+    }
+    if (mapped) {
+        return true;
+    }
+#endif
+
+    File file;
+    if (!file.open(filePath, FILE_OPEN_EXISTING | FILE_READ)) {
+        setErr(err, SCPI_ERROR_FILE_NAME_NOT_FOUND);
+        return false;
+    }
+
+    uint32_t size = file.size();
+
+    auto data = (uint8_t *)alloc(size, 0x4b8d21f6);
+    if (!data) {
+        file.close();
+        setErr(err, SCPI_ERROR_OUT_OF_DEVICE_MEMORY);
+        return false;
+    }
+
+    uint32_t bytesRead = file.read(data, size);
+    file.close();
+
+    if (bytesRead != size) {
+        free(data);
+        setErr(err, SCPI_ERROR_MASS_STORAGE_ERROR);
+        return false;
+    }
+
+    return setExternalAssetsData(data, size, err);
+}
+
+#endif // EEZ_EXTERNAL_ASSETS_FILE
+
 void unloadExternalAssets() {
 	if (g_externalAssets) {
+		// compiled expressions are keyed by instruction pointers into assets memory
+		flow::resetCompiledExpressions();
 #if EEZ_OPTION_GUI
 		removeExternalPagesFromTheStack();
+		font::freeGlyphIndex(g_externalAssets);
+		g_externalVariableNameIndex.index.reset();
+		g_externalVariableNameIndex.assets = nullptr;
+#endif
+#if EEZ_EXTERNAL_ASSETS_MMAP
+		if (g_externalAssetsMappedSize) {
+			munmap(g_externalAssetsMemory, g_externalAssetsMappedSize);
+			g_externalAssetsMappedSize = 0;
+		} else
 #endif
-		free(g_externalAssets);
+		free(g_externalAssetsMemory ? g_externalAssetsMemory : (uint8_t *)g_externalAssets);
+		g_externalAssetsMemory = nullptr;
 		g_externalAssets = nullptr;
 	}
 }
@@ -237,8 +445,20 @@ const gui::Bitmap *getBitmap(int bitmapID) {
 }
 
 const int getBitmapIdByName(const char *bitmapName) {
-    for (uint32_t i = 0; i < g_mainAssets->bitmaps.count; i++) {
-		if (strcmp(g_mainAssets->bitmaps[i]->name, bitmapName) == 0) {
+    auto assets = g_mainAssets;
+    auto getName = [assets](uint32_t i) { return (const char *)assets->bitmaps[i]->name; };
+
+    if (g_bitmapNameIndex.assets != assets) {
+        g_bitmapNameIndex.assets = assets;
+        g_bitmapNameIndex.index.build(assets->bitmaps.count, getName);
+    }
+
+    if (g_bitmapNameIndex.index.isBuilt()) {
+        return g_bitmapNameIndex.index.find(bitmapName, getName) + 1;
+    }
+
+    for (uint32_t i = 0; i < assets->bitmaps.count; i++) {
+		if (strcmp(assets->bitmaps[i]->name, bitmapName) == 0) {
             return i + 1;
         }
 	}
@@ -315,8 +535,21 @@ int16_t getDataIdFromName(const WidgetCursor &widgetCursor, const char *name) {
 		return 0;
 	}
 
-	for (uint32_t i = 0; i < widgetCursor.assets->variableNames.count; i++) {
-		if (strcmp(widgetCursor.assets->variableNames[i], name) == 0) {
+    auto assets = widgetCursor.assets;
+    auto getName = [assets](uint32_t i) { return (const char *)assets->variableNames[i]; };
+
+    auto &nameIndex = assets == g_externalAssets ? g_externalVariableNameIndex : g_mainVariableNameIndex;
+    if (nameIndex.assets != assets) {
+        nameIndex.assets = assets;
+        nameIndex.index.build(assets->variableNames.count, getName);
+    }
+
+    if (nameIndex.index.isBuilt()) {
+        return -((int16_t)nameIndex.index.find(name, getName) + 1);
+    }
+
+	for (uint32_t i = 0; i < assets->variableNames.count; i++) {
+		if (strcmp(assets->variableNames[i], name) == 0) {
 			return -((int16_t)i + 1);
 		}
 	}
@@ -0,0 +1,98 @@
+/*
+ * eez-framework
+ *
+ * MIT License
+ * Copyright 2024 Envox d.o.o.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <eez/core/alloc.h>
+
+namespace eez {
+
+// FNV-1a
+inline uint32_t hashName(const char *name) {
+    uint32_t hash = 2166136261u;
+    for (const uint8_t *p = (const uint8_t *)name; *p; p++) {
+        hash = (hash ^ *p) * 16777619u;
+    }
+    return hash;
+}
+
+// Open addressing (linear probing) hash index for the table of names which doesn't change
+// after it is installed. Slot holds the table index + 1, 0 is for the empty slot.
+struct NameIndex {
+    uint32_t *slots;
+    uint32_t mask;
+
+    bool isBuilt() const {
+        return slots != nullptr;
+    }
+
+    // getName(i) returns the name of the i-th table item, items with nullptr name are skipped.
+    // If the same name is in the table more than once, find will return the first one (as linear search).
+    template<typename GetName>
+    bool build(uint32_t count, GetName getName) {
+        reset();
+
+        uint32_t numSlots = 8;
+        while (numSlots < 2 * count) {
+            numSlots *= 2;
+        }
+
+        slots = (uint32_t *)alloc(numSlots * sizeof(uint32_t), 0x3e6a0c57);
+        if (!slots) {
+            return false;
+        }
+        memset(slots, 0, numSlots * sizeof(uint32_t));
+        mask = numSlots - 1;
+
+        for (uint32_t i = 0; i < count; i++) {
+            const char *name = getName(i);
+            if (!name) {
+                continue;
+            }
+
+            for (uint32_t slot = hashName(name) & mask; ; slot = (slot + 1) & mask) {
+                if (!slots[slot]) {
+                    slots[slot] = i + 1;
+                    break;
+                }
+                if (strcmp(getName(slots[slot] - 1), name) == 0) {
+                    break;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    // Returns the table index or -1 if not found
+    template<typename GetName>
+    int32_t find(const char *name, GetName getName) const {
+        for (uint32_t slot = hashName(name) & mask; slots[slot]; slot = (slot + 1) & mask) {
+            uint32_t i = slots[slot] - 1;
+            if (strcmp(getName(i), name) == 0) {
+                return (int32_t)i;
+            }
+        }
+        return -1;
+    }
+
+    void reset() {
+        if (slots) {
+            free(slots);
+            slots = nullptr;
+        }
+        mask = 0;
+    }
+};
+
+} // namespace eez
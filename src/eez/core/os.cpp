@@ -36,6 +36,8 @@
 
 #if defined(__EMSCRIPTEN__)
 #include <sys/time.h>
+#elif defined(EEZ_PLATFORM_SIMULATOR)
+#include <chrono>
 #endif
 
 #include <eez/core/os.h>
@@ -64,4 +66,30 @@ uint32_t millis() {
 #endif
 }
 
+uint32_t micros() {
+#if defined(EEZ_PLATFORM_STM32)
+    // SysTick counts down from LOAD to 0 every millisecond
+    uint32_t ms;
+    uint32_t ticks;
+    do {
+        ms = HAL_GetTick();
+        ticks = SysTick->VAL;
+    } while (ms != HAL_GetTick());
+    uint32_t load = SysTick->LOAD + 1;
+    return ms * 1000 + (load - ticks) * 1000 / load;
+#elif defined(__EMSCRIPTEN__)
+	return (uint32_t)(emscripten_get_now() * 1000.0);
+#elif defined(EEZ_PLATFORM_SIMULATOR)
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#elif defined(EEZ_PLATFORM_ESP32)
+	return (uint32_t)esp_timer_get_time();
+#elif defined(EEZ_PLATFORM_PICO)
+    return (uint32_t)to_us_since_boot(get_absolute_time());
+#elif defined(EEZ_PLATFORM_RASPBERRY)
+    return CTimer::Get()->GetClockTicks();
+#else
+    return millis() * 1000;
+#endif
+}
+
 } // namespace eez
@@ -95,6 +95,8 @@ enum TestResult {
 };
 
 uint32_t millis();
+// microseconds counter, wraps around every ~71 minutes
+uint32_t micros();
 
 extern bool g_shutdown;
 void shutdown();
@@ -862,11 +862,16 @@ ValueTypeNameFunction g_valueTypeNames[] = {
 
 ArrayValueRef::~ArrayValueRef() {
     eez::flow::onArrayValueFree(&arrayValue);
-    for (uint32_t i = 1; i < arrayValue.arraySize; i++) {
+    auto capacity = getArrayRefCapacity(this);
+    for (uint32_t i = 1; i < capacity; i++) {
         (arrayValue.values + i)->~Value();
     }
 }
 
+void *ArrayValueRef::getAllocatedBlock() {
+    return (uint8_t *)this - ARRAY_VALUE_REF_HEADER_SIZE;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 bool assignValue(Value &dstValue, const Value &srcValue, uint32_t dstValueType) {
@@ -1432,16 +1437,25 @@ Value Value::concatenateString(const Value &str1, const Value &str2) {
 	return value;
 }
 
-Value Value::makeArrayRef(int arraySize, int arrayType, uint32_t id) {
-    auto ptr = alloc(sizeof(ArrayValueRef) + (arraySize > 0 ? arraySize - 1 : 0) * sizeof(Value), id);
+Value Value::makeArrayRef(int arraySize, int arrayType, uint32_t id, int capacity) {
+    if (capacity < arraySize) {
+        capacity = arraySize;
+    }
+
+    if (capacity < 1) {
+        capacity = 1;
+    }
+
+    auto ptr = (uint8_t *)alloc(ARRAY_VALUE_REF_HEADER_SIZE + sizeof(ArrayValueRef) + (capacity - 1) * sizeof(Value), id);
 	if (ptr == nullptr) {
 		return Value(0, VALUE_TYPE_NULL);
 	}
 
-    ArrayValueRef *arrayRef = new (ptr) ArrayValueRef;
+    *(uint32_t *)ptr = capacity;
+    ArrayValueRef *arrayRef = new (ptr + ARRAY_VALUE_REF_HEADER_SIZE) ArrayValueRef;
     arrayRef->arrayValue.arraySize = arraySize;
     arrayRef->arrayValue.arrayType = arrayType;
-    for (int i = 1; i < arraySize; i++) {
+    for (int i = 1; i < capacity; i++) {
         new (arrayRef->arrayValue.values + i) Value();
     }
 
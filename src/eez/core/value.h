@@ -89,6 +89,8 @@ struct PairOfInt16Value {
 struct Ref {
 	uint32_t refCounter;
     virtual ~Ref() {}
+    // start of the memory block allocated for this object
+    virtual void *getAllocatedBlock() { return this; }
 };
 
 struct ArrayValue;
@@ -220,6 +222,9 @@ struct Value {
 
     typedef float (*YtDataGetValueFunctionPointer)(uint32_t rowIndex, uint8_t columnIndex, float *max);
 
+    // Batched variant of YtDataGetValueFunctionPointer, fills count values (and max values if max is not nullptr) starting from rowIndex
+    typedef void (*YtDataGetValuesFunctionPointer)(uint32_t rowIndex, uint32_t count, uint8_t columnIndex, float *values, float *max);
+
     Value(YtDataGetValueFunctionPointer ytDataGetValueFunctionPointer)
         : type(VALUE_TYPE_YT_DATA_GET_VALUE_FUNCTION_POINTER), unit(UNIT_UNKNOWN), options(0), dstValueType(VALUE_TYPE_UNDEFINED), pVoidValue((void *)ytDataGetValueFunctionPointer)
     {
@@ -245,7 +250,9 @@ struct Value {
     void freeRef() {
 		if (options & VALUE_OPTIONS_REF) {
 			if (--refValue->refCounter == 0) {
-                ObjectAllocator<Ref>::deallocate(refValue);
+                auto block = refValue->getAllocatedBlock();
+                refValue->~Ref();
+                free(block);
 			}
 		}/* else if (type == VALUE_TYPE_VALUE_PTR) {
             if (pValueValue->options & VALUE_OPTIONS_REF) {
@@ -561,7 +568,8 @@ struct Value {
 	static Value makeStringRef(const char *str, int len, uint32_t id);
 	static Value concatenateString(const Value &str1, const Value &str2);
 
-    static Value makeArrayRef(int arraySize, int arrayType, uint32_t id);
+    // capacity is the number of allocated elements, if less than arraySize then arraySize is used
+    static Value makeArrayRef(int arraySize, int arrayType, uint32_t id, int capacity = 0);
     static Value makeArrayElementRef(Value arrayValue, int elementIndex, uint32_t id);
     static Value makeJsonMemberRef(Value jsonValue, Value propertyName, uint32_t id);
 
@@ -638,9 +646,19 @@ struct ArrayValue {
 
 struct ArrayValueRef : public Ref {
     ~ArrayValueRef();
+    void *getAllocatedBlock();
 	ArrayValue arrayValue;
 };
 
+// Number of elements allocated for the array (always >= arrayValue.arraySize) is stored
+// in front of ArrayValueRef, in the same memory block, because offset of arrayValue
+// is also used on the Dashboard (WASM) side.
+static const size_t ARRAY_VALUE_REF_HEADER_SIZE = alignof(ArrayValueRef) > sizeof(uint32_t) ? alignof(ArrayValueRef) : sizeof(uint32_t);
+
+inline uint32_t getArrayRefCapacity(const ArrayValueRef *arrayRef) {
+    return *(const uint32_t *)((const uint8_t *)arrayRef - ARRAY_VALUE_REF_HEADER_SIZE);
+}
+
 struct BlobRef : public Ref {
     ~BlobRef() {
         if (blob) {
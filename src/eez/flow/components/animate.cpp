@@ -16,7 +16,7 @@
 #include <eez/flow/flow_defs_v3.h>
 #include <eez/flow/expression.h>
 #include <eez/flow/private.h>
-#include <eez/flow/queue.h>
+#include <eez/flow/timers.h>
 #include <eez/flow/debugger.h>
 
 #if EEZ_OPTION_GUI
@@ -24,6 +24,11 @@
 using namespace eez::gui;
 #endif
 
+// Timeline position is updated at most once per this many milliseconds
+#if !defined(EEZ_FLOW_ANIMATE_UPDATE_PERIOD)
+#define EEZ_FLOW_ANIMATE_UPDATE_PERIOD 16
+#endif
+
 namespace eez {
 namespace flow {
 
@@ -74,9 +79,7 @@ void executeAnimateComponent(FlowState *flowState, unsigned componentIndex) {
             state->speed = speed;
             state->startTimestamp = millis();
 
-            if (!addToQueue(flowState, componentIndex, -1, -1, -1, true)) {
-                return;
-            }
+            addTimer(flowState, componentIndex, state->startTimestamp);
         }
     } else {
         float currentTime;
@@ -100,9 +103,7 @@ void executeAnimateComponent(FlowState *flowState, unsigned componentIndex) {
             deallocateComponentExecutionState(flowState, componentIndex);
             propagateValueThroughSeqout(flowState, componentIndex);
         } else {
-            if (!addToQueue(flowState, componentIndex, -1, -1, -1, true)) {
-                return;
-            }
+            addTimer(flowState, componentIndex, millis() + EEZ_FLOW_ANIMATE_UPDATE_PERIOD);
         }
     }
 }
@@ -17,7 +17,7 @@
 #include <eez/flow/components.h>
 #include <eez/flow/flow_defs_v3.h>
 #include <eez/flow/expression.h>
-#include <eez/flow/queue.h>
+#include <eez/flow/timers.h>
 
 namespace eez {
 namespace flow {
@@ -44,17 +44,13 @@ void executeDelayComponent(FlowState *flowState, unsigned componentIndex) {
 			return;
 		}
 
-		if (!addToQueue(flowState, componentIndex, -1, -1, -1, true)) {
-			return;
-		}
+		addTimer(flowState, componentIndex, delayComponentExecutionState->waitUntil);
 	} else {
-		if (millis() >= delayComponentExecutionState->waitUntil) {
+		if (isDeadlineReached(delayComponentExecutionState->waitUntil, millis())) {
 			deallocateComponentExecutionState(flowState, componentIndex);
 			propagateValueThroughSeqout(flowState, componentIndex);
 		} else {
-			if (!addToQueue(flowState, componentIndex, -1, -1, -1, true)) {
-				return;
-			}
+			addTimer(flowState, componentIndex, delayComponentExecutionState->waitUntil);
 		}
 	}
 }
@@ -29,10 +29,6 @@ LineChartWidgetComponenentExecutionState::LineChartWidgetComponenentExecutionSta
 
 LineChartWidgetComponenentExecutionState::~LineChartWidgetComponenentExecutionState() {
     if (data != nullptr) {
-        auto xValues = (Value *)data;
-        for (uint32_t i = 0; i < maxPoints; i++) {
-            (xValues + i)->~Value();
-        }
         eez::free(data);
     }
 
@@ -46,15 +42,24 @@ void LineChartWidgetComponenentExecutionState::init(uint32_t numLines_, uint32_t
     numLines = numLines_;
     maxPoints = maxPoints_;
 
-    data = eez::alloc(maxPoints * sizeof(Value) + maxPoints * numLines * sizeof(float), 0xe4945fea);
+    numBlocks = (maxPoints + LINE_CHART_BLOCK_SIZE - 1) / LINE_CHART_BLOCK_SIZE;
 
-    auto xValues = (Value *)data;
-    for (uint32_t i = 0; i < maxPoints; i++) {
-		new (xValues + i) Value();
-	}
+    data = eez::alloc(
+        maxPoints * sizeof(double) +
+        numBlocks * sizeof(LineChartBlock) +
+        maxPoints * numLines * sizeof(float) +
+        numBlocks * numLines * 2 * sizeof(float) +
+        maxPoints * sizeof(uint8_t),
+        0xe4945fea
+    );
 
-    numPoints = 0;
-    startPointIndex = 0;
+    xValues = (double *)data;
+    blocks = (LineChartBlock *)(xValues + maxPoints);
+    yValues = (float *)(blocks + numBlocks);
+    blockYValues = yValues + maxPoints * numLines;
+    xTypes = (uint8_t *)(blockYValues + numBlocks * numLines * 2);
+
+    reset();
 
     lineLabels = (Value *)eez::alloc(numLines * sizeof(Value), 0xe8afd215);
     for (uint32_t i = 0; i < numLines; i++) {
@@ -64,37 +69,75 @@ void LineChartWidgetComponenentExecutionState::init(uint32_t numLines_, uint32_t
     updated = true;
 }
 
-Value LineChartWidgetComponenentExecutionState::getX(int pointIndex) {
-    auto xValues = (Value *)data;
-    return xValues[pointIndex];
+void LineChartWidgetComponenentExecutionState::reset() {
+    numPoints = 0;
+    startPointIndex = 0;
+    numXDescents = 0;
+
+    for (uint32_t i = 0; i < numBlocks; i++) {
+        blocks[i].count = 0;
+    }
 }
 
-void LineChartWidgetComponenentExecutionState::setX(int pointIndex, Value& value) {
-    auto xValues = (Value *)data;
-    xValues[pointIndex] = value;
+Value LineChartWidgetComponenentExecutionState::getX(int pointIndex) {
+    return Value(xValues[pointIndex], getXType(pointIndex));
 }
 
-float LineChartWidgetComponenentExecutionState::getY(int pointIndex, int lineIndex) {
-    auto yValues = (float *)((Value *)data + maxPoints);
-    return *(yValues + pointIndex * numLines + lineIndex);
+void LineChartWidgetComponenentExecutionState::setX(int pointIndex, double x, ValueType type) {
+    xValues[pointIndex] = x;
+    xTypes[pointIndex] = (uint8_t)type;
 }
 
 void LineChartWidgetComponenentExecutionState::setY(int pointIndex, int lineIndex, float value) {
-    auto yValues = (float *)((Value *)data + maxPoints);
-    *(yValues + pointIndex * numLines + lineIndex) = value;
+    yValues[pointIndex * numLines + lineIndex] = value;
 }
 
-bool LineChartWidgetComponenentExecutionState::onInputValue(FlowState *flowState, unsigned componentIndex) {
-    auto component = (LineChartWidgetComponenent *)flowState->flow->components[componentIndex];
+int LineChartWidgetComponenentExecutionState::getBlockIndex(uint32_t pointIndex, uint32_t numPointsLeft) {
+    if (pointIndex % LINE_CHART_BLOCK_SIZE != 0) {
+        return -1;
+    }
 
-    uint32_t pointIndex;
+    int blockIndex = pointIndex / LINE_CHART_BLOCK_SIZE;
+    auto blockLength = getBlockLength(blockIndex);
+    if (blocks[blockIndex].count != blockLength || blockLength > numPointsLeft) {
+        return -1;
+    }
 
-    if (numPoints < component->maxPoints) {
-        pointIndex = numPoints++;
-    } else {
-        startPointIndex = (startPointIndex + 1) % component->maxPoints;
-        pointIndex = (startPointIndex + component->maxPoints - 1) % component->maxPoints;
+    return blockIndex;
+}
+
+void LineChartWidgetComponenentExecutionState::updateBlock(int pointIndex) {
+    auto blockIndex = pointIndex / LINE_CHART_BLOCK_SIZE;
+    auto indexInBlock = pointIndex % LINE_CHART_BLOCK_SIZE;
+
+    auto &block = blocks[blockIndex];
+    auto blockY = blockYValues + 2 * blockIndex * numLines;
+    auto x = xValues[pointIndex];
+    auto y = yValues + pointIndex * numLines;
+
+    if (indexInBlock == 0) {
+        // first point in the block, previous ranges are from the points this one is replacing
+        block.xMin = x;
+        block.xMax = x;
+        for (uint32_t lineIndex = 0; lineIndex < numLines; lineIndex++) {
+            blockY[2 * lineIndex] = y[lineIndex];
+            blockY[2 * lineIndex + 1] = y[lineIndex];
+        }
+        block.count = 1;
+    } else if (block.count == indexInBlock) {
+        if (x < block.xMin) block.xMin = x;
+        if (x > block.xMax) block.xMax = x;
+        for (uint32_t lineIndex = 0; lineIndex < numLines; lineIndex++) {
+            if (y[lineIndex] < blockY[2 * lineIndex]) blockY[2 * lineIndex] = y[lineIndex];
+            if (y[lineIndex] > blockY[2 * lineIndex + 1]) blockY[2 * lineIndex + 1] = y[lineIndex];
+        }
+        block.count++;
     }
+    // else some point in this block is missing from the ranges, block stays unusable until it is rewritten
+}
+
+bool LineChartWidgetComponenentExecutionState::onInputValue(FlowState *flowState, unsigned componentIndex) {
+    auto component = (LineChartWidgetComponenent *)flowState->flow->components[componentIndex];
 
     Value value;
     if (!evalExpression(flowState, componentIndex, component->xValue, value, FlowError::Plain("Failed to evaluate x value in LineChartWidget"))) {
@@ -102,13 +145,35 @@ bool LineChartWidgetComponenentExecutionState::onInputValue(FlowState *flowState
     }
 
     int err;
-    value.toDouble(&err);
+    auto x = value.toDouble(&err);
     if (err) {
         throwError(flowState, componentIndex, FlowError::Plain("X value not an number or date"));
         return false;
     }
 
-    setX(pointIndex, value);
+    uint32_t pointIndex;
+
+    if (numPoints < component->maxPoints) {
+        pointIndex = numPoints++;
+    } else {
+        // oldest point is removed
+        auto nextPointIndex = (startPointIndex + 1) % component->maxPoints;
+        if (xValues[nextPointIndex] < xValues[startPointIndex]) {
+            numXDescents--;
+        }
+
+        startPointIndex = nextPointIndex;
+        pointIndex = (startPointIndex + component->maxPoints - 1) % component->maxPoints;
+    }
+
+    if (numPoints > 1) {
+        auto prevPointIndex = (pointIndex + component->maxPoints - 1) % component->maxPoints;
+        if (x < xValues[prevPointIndex]) {
+            numXDescents++;
+        }
+    }
+
+    setX(pointIndex, x, value.getType() == VALUE_TYPE_DATE ? VALUE_TYPE_DATE : VALUE_TYPE_DOUBLE);
 
     for (uint32_t lineIndex = 0; lineIndex < numLines; lineIndex++) {
         Value value;
@@ -126,6 +191,8 @@ bool LineChartWidgetComponenentExecutionState::onInputValue(FlowState *flowState
         setY(pointIndex, lineIndex, y);
     }
 
+    updateBlock(pointIndex);
+
     return true;
 }
 
@@ -152,8 +219,7 @@ void executeLineChartWidgetComponent(FlowState *flowState, unsigned componentInd
 
     if (flowState->values[component->inputs[resetInputIndex]].type != VALUE_TYPE_UNDEFINED) {
         // reset
-        executionState->numPoints = 0;
-        executionState->startPointIndex = 0;
+        executionState->reset();
         executionState->updated = true;
 
         clearInputValue(flowState, component->inputs[resetInputIndex]);
@@ -167,8 +233,7 @@ void executeLineChartWidgetComponent(FlowState *flowState, unsigned componentInd
         if (inputValue.isArray() && inputValue.getArray()->arrayType == defs_v3::ARRAY_TYPE_ANY) {
             auto array = inputValue.getArray();
             bool updated = false;
-            executionState->startPointIndex = 0;
-            executionState->numPoints = 0;
+            executionState->reset();
             for (uint32_t elementIndex = 0; elementIndex < array->arraySize; elementIndex++) {
                 flowState->values[valueInputIndexInFlow] = array->values[elementIndex];
                 if (executionState->onInputValue(flowState, componentIndex)) {
@@ -36,17 +36,31 @@ struct Point {
     float lines[1];
 };
 
+// Points are grouped in blocks of this size, for each block x and y ranges are kept
+static const uint32_t LINE_CHART_BLOCK_SIZE = 64;
+
+struct LineChartBlock {
+    double xMin;
+    double xMax;
+    // number of consecutive points, starting from the first point in the block, included in the ranges
+    uint32_t count;
+};
+
 struct LineChartWidgetComponenentExecutionState : public ComponenentExecutionState {
     LineChartWidgetComponenentExecutionState();
     ~LineChartWidgetComponenentExecutionState();
 
     void init(uint32_t numLines, uint32_t maxPoints);
+    void reset();
 
     uint32_t numLines;
     uint32_t maxPoints;
     uint32_t numPoints;
     uint32_t startPointIndex;
 
+    // number of neighbouring points where x is decreasing, if 0 then points are sorted by x
+    uint32_t numXDescents;
+
     Value *lineLabels;
 
     bool updated;
@@ -54,21 +68,64 @@ struct LineChartWidgetComponenentExecutionState : public ComponenentExecutionSta
     bool onInputValue(FlowState *flowState, unsigned componentIndex);
 
     Value getX(int pointIndex);
-    void setX(int pointIndex, Value& value);
 
-    float getY(int pointIndex, int lineIndex);
-    void setY(int pointIndex, int lineIndex, float value);
+    double getXDouble(int pointIndex) {
+        return xValues[pointIndex];
+    }
+
+    ValueType getXType(int pointIndex) {
+        return (ValueType)xTypes[pointIndex];
+    }
+
+    float getY(int pointIndex, int lineIndex) {
+        return yValues[pointIndex * numLines + lineIndex];
+    }
+
+    // Returns the block starting at pointIndex if its ranges cover the whole block
+    // and all of its points are within the next numPointsLeft points, otherwise -1.
+    int getBlockIndex(uint32_t pointIndex, uint32_t numPointsLeft);
+
+    uint32_t getBlockLength(int blockIndex) {
+        return MIN(LINE_CHART_BLOCK_SIZE, maxPoints - blockIndex * LINE_CHART_BLOCK_SIZE);
+    }
+
+    const LineChartBlock &getBlock(int blockIndex) {
+        return blocks[blockIndex];
+    }
+
+    float getBlockYMin(int blockIndex, int lineIndex) {
+        return blockYValues[2 * (blockIndex * numLines + lineIndex)];
+    }
+
+    float getBlockYMax(int blockIndex, int lineIndex) {
+        return blockYValues[2 * (blockIndex * numLines + lineIndex) + 1];
+    }
 
 private:
-    // Data structure where n is no. of points, m is no. of lines, Xi is Value and Yij is float:
-    // X1
-    // X2
-    // Xn
+    void setX(int pointIndex, double x, ValueType type);
+    void setY(int pointIndex, int lineIndex, float value);
+    void updateBlock(int pointIndex);
+
+    // Data structure where n is no. of points, m is no. of lines, b is no. of blocks,
+    // Xi is double, Yij is float and Ti is the value type of Xi:
+    // X1 X2 ... Xn
+    // B1 B2 ... Bb (LineChartBlock)
     // Y11 Y12 ... Y1m
-    // Y21 Y22 ... Y2m
     // ...
-    // Yn1 Yn2 ... Ynm,
+    // Yn1 Yn2 ... Ynm
+    // Ymin11 Ymax11 ... Ymin1m Ymax1m
+    // ...
+    // Yminb1 Ymaxb1 ... Yminbm Ymaxbm
+    // T1 T2 ... Tn
     void *data;
+
+    double *xValues;
+    LineChartBlock *blocks;
+    float *yValues;
+    float *blockYValues;
+    uint8_t *xTypes;
+
+    uint32_t numBlocks;
 };
 
 #endif // EEZ_OPTION_GUI
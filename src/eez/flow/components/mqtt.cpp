@@ -9,10 +9,15 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
 
 #include <eez/conf-internal.h>
 
 #include <eez/core/debug.h>
+#include <eez/core/os.h>
 
 #include <eez/flow/flow.h>
 #include <eez/flow/components.h>
@@ -20,9 +25,12 @@
 #include <eez/flow/expression.h>
 #include <eez/flow/debugger.h>
 #include <eez/flow/queue.h>
+#include <eez/flow/timers.h>
 
 #include <eez/flow/components/mqtt.h>
 
+static_assert((EEZ_MQTT_EVENT_QUEUE_SIZE & (EEZ_MQTT_EVENT_QUEUE_SIZE - 1)) == 0, "EEZ_MQTT_EVENT_QUEUE_SIZE must be power of 2");
+
 namespace eez {
 namespace flow {
 
@@ -50,8 +58,18 @@ struct MQTTEventActionComponenentExecutionState : public ComponenentExecutionSta
     unsigned componentIndex;
     MQTTEvent *firstEvent;
     MQTTEvent *lastEvent;
+    uint32_t numEvents;
 
-    MQTTEventActionComponenentExecutionState() : firstEvent(nullptr), lastEvent(nullptr) {}
+    // component is in the queue or has a timer
+    bool isScheduled;
+
+    uint32_t tickCounter;
+    uint32_t numEventsDeliveredInTick;
+
+    MQTTEventActionComponenentExecutionState()
+        : firstEvent(nullptr), lastEvent(nullptr), numEvents(0), isScheduled(false), tickCounter(0), numEventsDeliveredInTick(0)
+    {
+    }
 
     virtual ~MQTTEventActionComponenentExecutionState() override;
 
@@ -67,8 +85,51 @@ struct MQTTEventActionComponenentExecutionState : public ComponenentExecutionSta
             lastEvent->next = event;
             lastEvent = event;
         }
+        numEvents++;
     }
 
+#if EEZ_MQTT_OVERFLOW_POLICY == EEZ_MQTT_OVERFLOW_COALESCE_TOPIC
+    // Replaces message with the same topic that is still waiting to be delivered
+    bool replaceMessage(int16_t outputIndex, const Value &messageValue) {
+        if (!messageValue.isArray()) {
+            return false;
+        }
+        auto topic = messageValue.getArray()->values[defs_v3::SYSTEM_STRUCTURE_MQTT_MESSAGE_FIELD_TOPIC].getString();
+        for (auto event = firstEvent; event; event = event->next) {
+            if (event->outputIndex == outputIndex && event->value.isArray()) {
+                auto eventTopic = event->value.getArray()->values[defs_v3::SYSTEM_STRUCTURE_MQTT_MESSAGE_FIELD_TOPIC].getString();
+                if (strcmp(eventTopic, topic) == 0) {
+                    event->value = messageValue;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+#endif
+
+#if EEZ_MQTT_OVERFLOW_POLICY != EEZ_MQTT_OVERFLOW_DROP_NEWEST
+    bool removeOldestMessage(int16_t outputIndex) {
+        MQTTEvent *prevEvent = nullptr;
+        for (auto event = firstEvent; event; prevEvent = event, event = event->next) {
+            if (event->outputIndex == outputIndex) {
+                if (prevEvent) {
+                    prevEvent->next = event->next;
+                } else {
+                    firstEvent = event->next;
+                }
+                if (lastEvent == event) {
+                    lastEvent = prevEvent;
+                }
+                numEvents--;
+                ObjectAllocator<MQTTEvent>::deallocate(event);
+                return true;
+            }
+        }
+        return false;
+    }
+#endif
+
     MQTTEvent *removeEvent() {
         auto event = firstEvent;
         if (event) {
@@ -76,6 +137,7 @@ struct MQTTEventActionComponenentExecutionState : public ComponenentExecutionSta
             if (!firstEvent) {
                 lastEvent = nullptr;
             }
+            numEvents--;
         }
         return event;
     }
@@ -83,16 +145,232 @@ struct MQTTEventActionComponenentExecutionState : public ComponenentExecutionSta
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// MQTT library adapter reports events from its own thread (or threads), so they are first put into
+// the connection event queue and later, from the flow thread, taken out in drainMQTTEvents and
+// converted to the values delivered by the MQTTEvent components. This is bounded ring buffer where
+// each slot has the sequence number telling if the slot is free or holds the event, so it can be
+// used from multiple threads without locks. Producer becomes also the consumer when it needs to
+// drop the oldest event.
+
+struct MQTTEventSlot {
+    std::atomic<uint32_t> sequence;
+    EEZ_MQTT_Event event;
+    uint32_t topicLength;
+    uint32_t payloadLength;
+    char *data; // topic and payload, both null terminated, points to inlineData or is allocated with malloc
+    char inlineData[EEZ_MQTT_EVENT_DATA_SIZE];
+};
+
+struct MQTTEventQueue {
+    MQTTEventSlot slots[EEZ_MQTT_EVENT_QUEUE_SIZE];
+    std::atomic<uint32_t> enqueuePosition;
+    std::atomic<uint32_t> dequeuePosition;
+    std::atomic<uint32_t> numDroppedEvents;
+
+    MQTTEventQueue() : enqueuePosition(0), dequeuePosition(0), numDroppedEvents(0) {
+        for (uint32_t i = 0; i < EEZ_MQTT_EVENT_QUEUE_SIZE; i++) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~MQTTEventQueue();
+
+    // Returns nullptr if queue is full
+    MQTTEventSlot *beginEnqueue() {
+        auto position = enqueuePosition.load(std::memory_order_relaxed);
+        for (;;) {
+            auto slot = &slots[position & (EEZ_MQTT_EVENT_QUEUE_SIZE - 1)];
+            auto diff = (int32_t)(slot->sequence.load(std::memory_order_acquire) - position);
+            if (diff == 0) {
+                if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    return slot;
+                }
+            } else if (diff < 0) {
+                return nullptr;
+            } else {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void endEnqueue(MQTTEventSlot *slot) {
+        slot->sequence.store(slot->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Returns nullptr if queue is empty
+    MQTTEventSlot *beginDequeue() {
+        auto position = dequeuePosition.load(std::memory_order_relaxed);
+        for (;;) {
+            auto slot = &slots[position & (EEZ_MQTT_EVENT_QUEUE_SIZE - 1)];
+            auto diff = (int32_t)(slot->sequence.load(std::memory_order_acquire) - (position + 1));
+            if (diff == 0) {
+                if (dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    return slot;
+                }
+            } else if (diff < 0) {
+                return nullptr;
+            } else {
+                position = dequeuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void endDequeue(MQTTEventSlot *slot) {
+        slot->sequence.store(slot->sequence.load(std::memory_order_relaxed) + EEZ_MQTT_EVENT_QUEUE_SIZE - 1, std::memory_order_release);
+    }
+
+    bool isEmpty() {
+        auto position = dequeuePosition.load(std::memory_order_relaxed);
+        auto slot = &slots[position & (EEZ_MQTT_EVENT_QUEUE_SIZE - 1)];
+        return (int32_t)(slot->sequence.load(std::memory_order_acquire) - (position + 1)) < 0;
+    }
+};
+
+static void releaseEventData(MQTTEventSlot *slot) {
+    if (slot->data != slot->inlineData) {
+        // allocated by the producer which may not be the flow thread, that's why malloc is used
+        ::free(slot->data);
+    }
+}
+
+MQTTEventQueue::~MQTTEventQueue() {
+    MQTTEventSlot *slot;
+    while ((slot = beginDequeue())) {
+        releaseEventData(slot);
+        endDequeue(slot);
+    }
+}
+
+static void enqueueEvent(MQTTEventQueue *queue, EEZ_MQTT_Event event, const char *topic, size_t topicLength, const void *payload, size_t payloadLength) {
+    size_t dataSize = topicLength + 1 + payloadLength + 1;
+    char *data = nullptr;
+    if (dataSize > EEZ_MQTT_EVENT_DATA_SIZE) {
+        data = (char *)::malloc(dataSize);
+        if (!data) {
+            queue->numDroppedEvents.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    auto slot = queue->beginEnqueue();
+
+#if EEZ_MQTT_OVERFLOW_POLICY != EEZ_MQTT_OVERFLOW_DROP_NEWEST
+    if (!slot) {
+        auto oldestSlot = queue->beginDequeue();
+        if (oldestSlot) {
+            releaseEventData(oldestSlot);
+            queue->endDequeue(oldestSlot);
+            queue->numDroppedEvents.fetch_add(1, std::memory_order_relaxed);
+        }
+        // still can fail if some other thread took the free slot in the meantime
+        slot = queue->beginEnqueue();
+    }
+#endif
+
+    if (!slot) {
+        if (data) {
+            ::free(data);
+        }
+        queue->numDroppedEvents.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    slot->event = event;
+    slot->topicLength = (uint32_t)topicLength;
+    slot->payloadLength = (uint32_t)payloadLength;
+    slot->data = data ? data : slot->inlineData;
+    if (topicLength > 0) {
+        memcpy(slot->data, topic, topicLength);
+    }
+    slot->data[topicLength] = 0;
+    if (payloadLength > 0) {
+        memcpy(slot->data + topicLength + 1, payload, payloadLength);
+    }
+    slot->data[dataSize - 1] = 0;
+
+    queue->endEnqueue(slot);
+}
+
+// Adapter reports events using the connection handle, but the list of connections belongs to
+// the flow thread, so event queues are registered here where they can be found from any thread.
+struct MQTTEventQueueRegistration {
+    std::atomic<void *> handle;
+    std::atomic<MQTTEventQueue *> eventQueue;
+};
+
+static MQTTEventQueueRegistration g_mqttEventQueues[EEZ_MQTT_MAX_CONNECTIONS];
+
+static bool registerEventQueue(void *handle, MQTTEventQueue *eventQueue) {
+    for (size_t i = 0; i < EEZ_MQTT_MAX_CONNECTIONS; i++) {
+        if (!g_mqttEventQueues[i].handle.load(std::memory_order_relaxed)) {
+            g_mqttEventQueues[i].eventQueue.store(eventQueue, std::memory_order_relaxed);
+            g_mqttEventQueues[i].handle.store(handle, std::memory_order_release);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void unregisterEventQueue(void *handle) {
+    for (size_t i = 0; i < EEZ_MQTT_MAX_CONNECTIONS; i++) {
+        if (g_mqttEventQueues[i].handle.load(std::memory_order_relaxed) == handle) {
+            g_mqttEventQueues[i].handle.store(nullptr, std::memory_order_release);
+            g_mqttEventQueues[i].eventQueue.store(nullptr, std::memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+static MQTTEventQueue *findEventQueue(void *handle) {
+    for (size_t i = 0; i < EEZ_MQTT_MAX_CONNECTIONS; i++) {
+        if (g_mqttEventQueues[i].handle.load(std::memory_order_acquire) == handle) {
+            return g_mqttEventQueues[i].eventQueue.load(std::memory_order_relaxed);
+        }
+    }
+    return nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct MQTTTopicNode;
+
 struct MQTTConnectionEventHandler {
     MQTTEventActionComponenentExecutionState *componentExecutionState;
 
+    // node in the connection topic tree where topic filter of this handler ends
+    MQTTTopicNode *topicNode;
+    MQTTConnectionEventHandler *nextInTopicNode;
+
     MQTTConnectionEventHandler *next;
     MQTTConnectionEventHandler *prev;
 };
 
+// Topic filters of all the handlers of the connection are kept in the tree with one topic level
+// per node, so received message is matched only against the filters that share its topic levels
+// and the message value is created only if some handler wants it.
+struct MQTTTopicNode {
+    MQTTTopicNode *parent;
+    MQTTTopicNode *firstChild;
+    MQTTTopicNode *nextSibling;
+
+    MQTTConnectionEventHandler *firstEventHandler;
+
+    // statistics for the topic filter ending at this node
+    uint32_t numMatchedMessages;
+    uint32_t numDroppedMessages;
+
+    uint32_t levelLength;
+    const char *level; // not null terminated
+};
+
 struct MQTTConnection {
     void *handle;
 
+    MQTTTopicNode topicTreeRoot;
+
+    MQTTEventQueue *eventQueue;
+    uint32_t numReportedDroppedEvents;
+
     MQTTConnectionEventHandler *firstEventHandler;
     MQTTConnectionEventHandler *lastEventHandler;
 
@@ -103,6 +381,8 @@ struct MQTTConnection {
 MQTTConnection *g_firstMQTTConnection = nullptr;
 MQTTConnection *g_lastMQTTConnection = nullptr;
 
+static uint32_t g_mqttTickCounter;
+
 ////////////////////////////////////////////////////////////////////////////////
 
 static MQTTConnection *addConnection(void *handle) {
@@ -111,7 +391,21 @@ static MQTTConnection *addConnection(void *handle) {
         return nullptr;
     }
 
+    connection->eventQueue = ObjectAllocator<MQTTEventQueue>::allocate(0x3c8d0e57);
+    if (!connection->eventQueue) {
+        ObjectAllocator<MQTTConnection>::deallocate(connection);
+        return nullptr;
+    }
+
+    if (!registerEventQueue(handle, connection->eventQueue)) {
+        ObjectAllocator<MQTTEventQueue>::deallocate(connection->eventQueue);
+        ObjectAllocator<MQTTConnection>::deallocate(connection);
+        return nullptr;
+    }
+
     connection->handle = handle;
+    memset(&connection->topicTreeRoot, 0, sizeof(MQTTTopicNode));
+    connection->numReportedDroppedEvents = 0;
     connection->firstEventHandler = nullptr;
     connection->lastEventHandler = nullptr;
 
@@ -154,6 +448,10 @@ static void deleteConnection(void *handle) {
 
     eez_mqtt_deinit(connection->handle);
 
+    // adapter doesn't report events after deinit, so nobody else is using event queue anymore
+    unregisterEventQueue(connection->handle);
+    ObjectAllocator<MQTTEventQueue>::deallocate(connection->eventQueue);
+
     if (connection->prev) {
         connection->prev->next = connection->next;
     } else {
@@ -168,7 +466,103 @@ static void deleteConnection(void *handle) {
     ObjectAllocator<MQTTConnection>::deallocate(connection);
 }
 
-static MQTTConnectionEventHandler *addConnectionEventHandler(void *handle, MQTTEventActionComponenentExecutionState *componentExecutionState) {
+////////////////////////////////////////////////////////////////////////////////
+
+static bool isValidTopicFilter(const char *topicFilter) {
+    if (!*topicFilter) {
+        return false;
+    }
+    for (auto p = topicFilter; *p; p++) {
+        if (*p == '+' || *p == '#') {
+            // wildcard must occupy the whole level and '#' must be the last level
+            if (p != topicFilter && p[-1] != '/') {
+                return false;
+            }
+            if (*p == '#' ? p[1] != 0 : (p[1] != 0 && p[1] != '/')) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static inline bool isTopicNodeLevel(MQTTTopicNode *node, const char *level, size_t levelLength) {
+    return node->levelLength == levelLength && memcmp(node->level, level, levelLength) == 0;
+}
+
+static MQTTTopicNode *findChildTopicNode(MQTTTopicNode *node, const char *level, size_t levelLength) {
+    for (auto child = node->firstChild; child; child = child->nextSibling) {
+        if (isTopicNodeLevel(child, level, levelLength)) {
+            return child;
+        }
+    }
+    return nullptr;
+}
+
+// Frees the nodes not used anymore, from this one towards the root
+static void pruneTopicNode(MQTTTopicNode *node) {
+    while (node->parent && !node->firstChild && !node->firstEventHandler) {
+        auto parent = node->parent;
+
+        for (auto pNext = &parent->firstChild; *pNext; pNext = &(*pNext)->nextSibling) {
+            if (*pNext == node) {
+                *pNext = node->nextSibling;
+                break;
+            }
+        }
+
+        eez::free(node);
+
+        node = parent;
+    }
+}
+
+// Handlers without the topic filter are attached to the root node
+static MQTTTopicNode *addTopicNodes(MQTTTopicNode *root, const char *topicFilter) {
+    if (!topicFilter) {
+        return root;
+    }
+
+    auto node = root;
+    for (;;) {
+        auto levelEnd = strchr(topicFilter, '/');
+        size_t levelLength = levelEnd ? levelEnd - topicFilter : strlen(topicFilter);
+
+        auto child = findChildTopicNode(node, topicFilter, levelLength);
+        if (!child) {
+            // level is stored right after the node
+            child = (MQTTTopicNode *)alloc(sizeof(MQTTTopicNode) + levelLength, 0x8b2e61f4);
+            if (!child) {
+                pruneTopicNode(node);
+                return nullptr;
+            }
+
+            child->parent = node;
+            child->firstChild = nullptr;
+            child->firstEventHandler = nullptr;
+            child->numMatchedMessages = 0;
+            child->numDroppedMessages = 0;
+            child->levelLength = levelLength;
+            child->level = (const char *)(child + 1);
+            memcpy(child + 1, topicFilter, levelLength);
+
+            child->nextSibling = node->firstChild;
+            node->firstChild = child;
+        }
+
+        node = child;
+
+        if (!levelEnd) {
+            return node;
+        }
+
+        topicFilter = levelEnd + 1;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static MQTTConnectionEventHandler *addConnectionEventHandler(void *handle, MQTTEventActionComponenentExecutionState *componentExecutionState, const char *topicFilter) {
     auto connection = findConnection(handle);
     if (!connection) {
         return nullptr;
@@ -181,6 +575,14 @@ static MQTTConnectionEventHandler *addConnectionEventHandler(void *handle, MQTTE
 
     eventHandler->componentExecutionState = componentExecutionState;
 
+    eventHandler->topicNode = addTopicNodes(&connection->topicTreeRoot, topicFilter);
+    if (!eventHandler->topicNode) {
+        ObjectAllocator<MQTTConnectionEventHandler>::deallocate(eventHandler);
+        return nullptr;
+    }
+    eventHandler->nextInTopicNode = eventHandler->topicNode->firstEventHandler;
+    eventHandler->topicNode->firstEventHandler = eventHandler;
+
     if (!connection->firstEventHandler) {
         connection->firstEventHandler = eventHandler;
         connection->lastEventHandler = eventHandler;
@@ -212,6 +614,15 @@ static void removeEventHandler(MQTTEventActionComponenentExecutionState *compone
                     connection->lastEventHandler = eventHandler->prev;
                 }
 
+                auto topicNode = eventHandler->topicNode;
+                for (auto pNext = &topicNode->firstEventHandler; *pNext; pNext = &(*pNext)->nextInTopicNode) {
+                    if (*pNext == eventHandler) {
+                        *pNext = eventHandler->nextInTopicNode;
+                        break;
+                    }
+                }
+                pruneTopicNode(topicNode);
+
                 ObjectAllocator<MQTTConnectionEventHandler>::deallocate(eventHandler);
                 return;
             }
@@ -225,6 +636,236 @@ void onFreeMQTTConnection(ArrayValue *mqttConnectionValue) {
     deleteConnection(handle);
 }
 
+static int16_t getEventOutputIndex(MQTTEventActionComponenent *component, EEZ_MQTT_Event event) {
+    switch (event) {
+    case EEZ_MQTT_EVENT_CONNECT: return component->connectEventOutputIndex;
+    case EEZ_MQTT_EVENT_RECONNECT: return component->reconnectEventOutputIndex;
+    case EEZ_MQTT_EVENT_CLOSE: return component->closeEventOutputIndex;
+    case EEZ_MQTT_EVENT_DISCONNECT: return component->disconnectEventOutputIndex;
+    case EEZ_MQTT_EVENT_OFFLINE: return component->offlineEventOutputIndex;
+    case EEZ_MQTT_EVENT_END: return component->endEventOutputIndex;
+    case EEZ_MQTT_EVENT_ERROR: return component->errorEventOutputIndex;
+    case EEZ_MQTT_EVENT_MESSAGE: return component->messageEventOutputIndex;
+    }
+    return -1;
+}
+
+static Value makePayloadValue(const char *payload, uint32_t payloadLength) {
+#if EEZ_MQTT_PAYLOAD_AS_BLOB
+    return Value::makeBlobRef((const uint8_t *)payload, payloadLength, 0xcfa25e4f);
+#else
+    if (memchr(payload, 0, payloadLength)) {
+        return Value::makeBlobRef((const uint8_t *)payload, payloadLength, 0xcfa25e4f);
+    }
+    return Value::makeStringRef(payload, payloadLength, 0xcfa25e4f);
+#endif
+}
+
+static Value makeEventValue(MQTTEventSlot *slot) {
+    auto topic = slot->data;
+    auto payload = slot->data + slot->topicLength + 1;
+
+    if (slot->event == EEZ_MQTT_EVENT_ERROR) {
+        return Value::makeStringRef(payload, slot->payloadLength, 0x2b7ac31a);
+    }
+
+    if (slot->event == EEZ_MQTT_EVENT_MESSAGE) {
+        Value messageValue = Value::makeArrayRef(defs_v3::SYSTEM_STRUCTURE_MQTT_MESSAGE_NUM_FIELDS, defs_v3::SYSTEM_STRUCTURE_MQTT_MESSAGE, 0xe256716a);
+        auto messageArray = messageValue.getArray();
+        messageArray->values[defs_v3::SYSTEM_STRUCTURE_MQTT_MESSAGE_FIELD_TOPIC] = Value::makeStringRef(topic, slot->topicLength, 0x5bdff567);
+        messageArray->values[defs_v3::SYSTEM_STRUCTURE_MQTT_MESSAGE_FIELD_PAYLOAD] = makePayloadValue(payload, slot->payloadLength);
+        return messageValue;
+    }
+
+    return Value(VALUE_TYPE_NULL);
+}
+
+static void addEventToHandler(MQTTEventActionComponenentExecutionState *componentExecutionState, int16_t outputIndex, const Value &value) {
+    componentExecutionState->addEvent(outputIndex, value);
+
+    if (!componentExecutionState->isScheduled) {
+        componentExecutionState->isScheduled = addToQueue(componentExecutionState->flowState, componentExecutionState->componentIndex, -1, -1, -1, false);
+    }
+}
+
+static void addMessageToHandler(MQTTConnectionEventHandler *eventHandler, int16_t outputIndex, const Value &messageValue) {
+    auto componentExecutionState = eventHandler->componentExecutionState;
+
+#if EEZ_MQTT_OVERFLOW_POLICY == EEZ_MQTT_OVERFLOW_COALESCE_TOPIC
+    if (componentExecutionState->replaceMessage(outputIndex, messageValue)) {
+        eventHandler->topicNode->numDroppedMessages++;
+        return;
+    }
+#endif
+
+    // slow handler drops its own messages and doesn't hold back the others
+    if (componentExecutionState->numEvents >= EEZ_MQTT_EVENT_QUEUE_SIZE) {
+        eventHandler->topicNode->numDroppedMessages++;
+#if EEZ_MQTT_OVERFLOW_POLICY == EEZ_MQTT_OVERFLOW_DROP_NEWEST
+        return;
+#else
+        if (!componentExecutionState->removeOldestMessage(outputIndex)) {
+            return;
+        }
+#endif
+    }
+
+    addEventToHandler(componentExecutionState, outputIndex, messageValue);
+}
+
+struct MQTTMessageDispatch {
+    MQTTEventSlot *slot;
+    Value messageValue;
+    bool isMessageValueCreated;
+};
+
+static void dispatchMessageToTopicNode(MQTTTopicNode *node, MQTTMessageDispatch &dispatch) {
+    if (!node->firstEventHandler) {
+        return;
+    }
+
+    node->numMatchedMessages++;
+
+    for (auto eventHandler = node->firstEventHandler; eventHandler; eventHandler = eventHandler->nextInTopicNode) {
+        auto componentExecutionState = eventHandler->componentExecutionState;
+        auto component = (MQTTEventActionComponenent *)componentExecutionState->flowState->flow->components[componentExecutionState->componentIndex];
+        if (component->messageEventOutputIndex < 0) {
+            continue;
+        }
+
+        // value is created only once and shared between all the matching handlers
+        if (!dispatch.isMessageValueCreated) {
+            dispatch.messageValue = makeEventValue(dispatch.slot);
+            dispatch.isMessageValueCreated = true;
+        }
+
+        addMessageToHandler(eventHandler, component->messageEventOutputIndex, dispatch.messageValue);
+    }
+}
+
+static void dispatchMessage(MQTTTopicNode *node, const char *topic, MQTTMessageDispatch &dispatch) {
+    auto levelEnd = strchr(topic, '/');
+    size_t levelLength = levelEnd ? levelEnd - topic : strlen(topic);
+
+    // wildcards at the first level don't match topics starting with '$'
+    bool isWildcardAllowed = node->parent || *topic != '$';
+
+    for (auto child = node->firstChild; child; child = child->nextSibling) {
+        if (isTopicNodeLevel(child, "#", 1)) {
+            if (isWildcardAllowed) {
+                dispatchMessageToTopicNode(child, dispatch);
+            }
+        } else if ((isWildcardAllowed && isTopicNodeLevel(child, "+", 1)) || isTopicNodeLevel(child, topic, levelLength)) {
+            if (levelEnd) {
+                dispatchMessage(child, levelEnd + 1, dispatch);
+            } else {
+                dispatchMessageToTopicNode(child, dispatch);
+
+                // "a/#" also matches "a"
+                auto multiLevelWildcardNode = findChildTopicNode(child, "#", 1);
+                if (multiLevelWildcardNode) {
+                    dispatchMessageToTopicNode(multiLevelWildcardNode, dispatch);
+                }
+            }
+        }
+    }
+}
+
+static void dispatchEvent(MQTTConnection *connection, MQTTEventSlot *slot) {
+    if (slot->event == EEZ_MQTT_EVENT_MESSAGE) {
+        MQTTMessageDispatch dispatch;
+        dispatch.slot = slot;
+        dispatch.isMessageValueCreated = false;
+        dispatchMessageToTopicNode(&connection->topicTreeRoot, dispatch);
+        dispatchMessage(&connection->topicTreeRoot, slot->data, dispatch);
+        return;
+    }
+
+    // other events go to all the handlers and are never dropped
+    Value value;
+    bool isValueCreated = false;
+
+    for (auto eventHandler = connection->firstEventHandler; eventHandler; eventHandler = eventHandler->next) {
+        auto componentExecutionState = eventHandler->componentExecutionState;
+        auto component = (MQTTEventActionComponenent *)componentExecutionState->flowState->flow->components[componentExecutionState->componentIndex];
+
+        auto outputIndex = getEventOutputIndex(component, slot->event);
+        if (outputIndex < 0) {
+            continue;
+        }
+
+        if (!isValueCreated) {
+            value = makeEventValue(slot);
+            isValueCreated = true;
+        }
+
+        addEventToHandler(componentExecutionState, outputIndex, value);
+    }
+}
+
+void drainMQTTEvents() {
+    g_mqttTickCounter++;
+
+    for (auto connection = g_firstMQTTConnection; connection; connection = connection->next) {
+        auto eventQueue = connection->eventQueue;
+
+        for (uint32_t i = 0; i < EEZ_MQTT_EVENT_QUEUE_SIZE; i++) {
+            auto slot = eventQueue->beginDequeue();
+            if (!slot) {
+                break;
+            }
+
+            dispatchEvent(connection, slot);
+
+            releaseEventData(slot);
+            eventQueue->endDequeue(slot);
+        }
+
+        auto numDroppedEvents = eventQueue->numDroppedEvents.load(std::memory_order_relaxed);
+        if (numDroppedEvents != connection->numReportedDroppedEvents) {
+            ErrorTrace("MQTT: %u events dropped\n", (unsigned)(numDroppedEvents - connection->numReportedDroppedEvents));
+            connection->numReportedDroppedEvents = numDroppedEvents;
+        }
+    }
+}
+
+static void visitTopicFilterStats(MQTTTopicNode *node, char *topicFilter, size_t topicFilterLength, EEZ_MQTT_TopicFilterStatsCallback callback, void *param) {
+    for (auto child = node->firstChild; child; child = child->nextSibling) {
+        // separator + level + null terminator
+        if (topicFilterLength + 1 + child->levelLength + 1 > EEZ_MQTT_MAX_TOPIC_LENGTH) {
+            continue;
+        }
+
+        auto childTopicFilterLength = topicFilterLength;
+        if (node->parent) {
+            topicFilter[childTopicFilterLength++] = '/';
+        }
+        memcpy(topicFilter + childTopicFilterLength, child->level, child->levelLength);
+        childTopicFilterLength += child->levelLength;
+        topicFilter[childTopicFilterLength] = 0;
+
+        if (child->firstEventHandler) {
+            callback(topicFilter, child->numMatchedMessages, child->numDroppedMessages, param);
+        }
+
+        visitTopicFilterStats(child, topicFilter, childTopicFilterLength, callback, param);
+    }
+}
+
+uint32_t getMQTTEventsTickDelay() {
+    bool hasEventHandlers = false;
+    for (auto connection = g_firstMQTTConnection; connection; connection = connection->next) {
+        if (!connection->eventQueue->isEmpty()) {
+            return 0;
+        }
+        if (connection->firstEventHandler) {
+            hasEventHandlers = true;
+        }
+    }
+    // adapter can't wake up the flow thread, so poll while there is someone waiting for the events
+    return hasEventHandlers ? EEZ_MQTT_EVENT_POLL_PERIOD : TICK_NO_DEADLINE;
+}
+
 MQTTEventActionComponenentExecutionState::~MQTTEventActionComponenentExecutionState() {
     removeEventHandler(this);
 
@@ -296,7 +937,11 @@ void executeMQTTInitComponent(FlowState *flowState, unsigned componentIndex) {
         return;
     }
 
-    addConnection(handle);
+    if (!addConnection(handle)) {
+        eez_mqtt_deinit(handle);
+        throwError(flowState, componentIndex, FlowError::Plain("Failed to initialize MQTT connection: too many connections"));
+        return;
+    }
 
     Value connectionValue = Value::makeArrayRef(defs_v3::OBJECT_TYPE_MQTT_CONNECTION_NUM_FIELDS, defs_v3::OBJECT_TYPE_MQTT_CONNECTION, 0x51ba2203);
     auto connectionArray = connectionValue.getArray();
@@ -388,24 +1033,61 @@ void executeMQTTEventComponent(FlowState *flowState, unsigned componentIndex) {
 
     auto componentExecutionState = (MQTTEventActionComponenentExecutionState *)flowState->componenentExecutionStates[componentIndex];
     if (!componentExecutionState) {
+        // topic filter is optional, without it all the messages are received
+        const char *topicFilter = nullptr;
+        Value topicFilterValue;
+        auto component = flowState->flow->components[componentIndex];
+        if (component->properties.count > EEZ_MQTT_EVENT_TOPIC_FILTER_PROPERTY) {
+            if (!evalProperty(flowState, componentIndex, EEZ_MQTT_EVENT_TOPIC_FILTER_PROPERTY, topicFilterValue, FlowError::Property("MQTTEvent", "Topic filter"))) {
+                return;
+            }
+            if (topicFilterValue.isString()) {
+                if (*topicFilterValue.getString()) {
+                    topicFilter = topicFilterValue.getString();
+                }
+            } else if (topicFilterValue.getType() != VALUE_TYPE_UNDEFINED) {
+                throwError(flowState, componentIndex, FlowError::Plain("Topic filter must be a string"));
+                return;
+            }
+            if (topicFilter && !isValidTopicFilter(topicFilter)) {
+                throwError(flowState, componentIndex, FlowError::Plain("Invalid topic filter"));
+                return;
+            }
+        }
+
         componentExecutionState = allocateComponentExecutionState<MQTTEventActionComponenentExecutionState>(flowState, componentIndex);
         componentExecutionState->flowState = flowState;
         componentExecutionState->componentIndex = componentIndex;
 
         auto connectionArray = connectionValue.getArray();
         void *handle = connectionArray->values[defs_v3::OBJECT_TYPE_MQTT_CONNECTION_FIELD_ID].getVoidPointer();
-        addConnectionEventHandler(handle, componentExecutionState);
+        addConnectionEventHandler(handle, componentExecutionState, topicFilter);
 
 	    propagateValueThroughSeqout(flowState, componentIndex);
-
-        addToQueue(flowState, componentIndex, -1, -1, -1, true);
     } else {
+        componentExecutionState->isScheduled = false;
+
         auto event = componentExecutionState->removeEvent();
         if (event) {
             propagateValue(flowState, componentIndex, event->outputIndex, event->value);
             ObjectAllocator<MQTTEvent>::deallocate(event);
-        } else {
-            addToQueue(flowState, componentIndex, -1, -1, -1, true);
+
+            if (componentExecutionState->tickCounter != g_mqttTickCounter) {
+                componentExecutionState->tickCounter = g_mqttTickCounter;
+                componentExecutionState->numEventsDeliveredInTick = 0;
+            }
+            componentExecutionState->numEventsDeliveredInTick++;
+        }
+
+        // Only one event is delivered per execution, so that the next one doesn't overwrite
+        // the input of the connected component before it is executed. Component is not in
+        // the queue while waiting for the events, drainMQTTEvents will put it there.
+        if (componentExecutionState->firstEvent) {
+            if (componentExecutionState->numEventsDeliveredInTick < EEZ_MQTT_EVENTS_PER_TICK) {
+                componentExecutionState->isScheduled = addToQueue(flowState, componentIndex, -1, -1, -1, false);
+            } else {
+                componentExecutionState->isScheduled = addTimer(flowState, componentIndex, millis());
+            }
         }
     }
 }
@@ -531,6 +1213,60 @@ void executeMQTTPublishComponent(FlowState *flowState, unsigned componentIndex)
 
 ////////////////////////////////////////////////////////////////////////////////
 
+void eez_mqtt_on_event_callback(void *handle, EEZ_MQTT_Event event, void *eventData) {
+    if (event == EEZ_MQTT_EVENT_MESSAGE) {
+        auto messageEvent = (EEZ_MQTT_MessageEvent *)eventData;
+        eez_mqtt_on_message_callback(handle, messageEvent->topic, messageEvent->payload, strlen(messageEvent->payload));
+        return;
+    }
+
+    auto eventQueue = eez::flow::findEventQueue(handle);
+    if (!eventQueue) {
+        return;
+    }
+
+    if (event == EEZ_MQTT_EVENT_ERROR && eventData) {
+        eez::flow::enqueueEvent(eventQueue, event, nullptr, 0, eventData, strlen((const char *)eventData));
+    } else {
+        eez::flow::enqueueEvent(eventQueue, event, nullptr, 0, nullptr, 0);
+    }
+}
+
+void eez_mqtt_on_message_callback(void *handle, const char *topic, const void *payload, size_t payloadLength) {
+    auto eventQueue = eez::flow::findEventQueue(handle);
+    if (!eventQueue) {
+        return;
+    }
+
+    eez::flow::enqueueEvent(eventQueue, EEZ_MQTT_EVENT_MESSAGE, topic, strlen(topic), payload, payloadLength);
+}
+
+void eez_mqtt_get_topic_filter_stats(void *handle, EEZ_MQTT_TopicFilterStatsCallback callback, void *param) {
+    auto connection = eez::flow::findConnection(handle);
+    if (!connection) {
+        return;
+    }
+
+    auto root = &connection->topicTreeRoot;
+    if (root->firstEventHandler) {
+        callback("", root->numMatchedMessages, root->numDroppedMessages, param);
+    }
+
+    char topicFilter[EEZ_MQTT_MAX_TOPIC_LENGTH];
+    eez::flow::visitTopicFilterStats(root, topicFilter, 0, callback, param);
+}
+
+uint32_t eez_mqtt_get_num_dropped_events(void *handle) {
+    auto eventQueue = eez::flow::findEventQueue(handle);
+    if (!eventQueue) {
+        return 0;
+    }
+
+    return eventQueue->numDroppedEvents.load(std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 #ifdef EEZ_STUDIO_FLOW_RUNTIME
 
 #include <emscripten.h>
@@ -589,78 +1325,177 @@ int eez_mqtt_publish(void *handle, const char *topic, const char *payload) {
 
 }
 
-void eez_mqtt_on_event_callback(void *handle, EEZ_MQTT_Event event, void *eventData) {
-    using namespace eez;
-    using namespace eez::flow;
+EM_PORT_API(void) onMqttEvent(void *handle, EEZ_MQTT_Event event, void *eventDataPtr1, void *eventDataPtr2) {
+    void *eventData;
+    if (eventDataPtr1 && eventDataPtr2)  {
+        EEZ_MQTT_MessageEvent eventData;
+        eventData.topic = (const char *)eventDataPtr1;
+        eventData.payload = (const char *)eventDataPtr2;
+        eez_mqtt_on_event_callback(handle, event, &eventData);
+    } else if (eventDataPtr1) {
+        eez_mqtt_on_event_callback(handle, event, eventDataPtr1);
+    } else {
+        eez_mqtt_on_event_callback(handle, event, nullptr);
+    }
+}
 
-    auto connection = findConnection(handle);
+#elif defined(EEZ_MQTT_LOOPBACK)
+
+#ifndef EEZ_MQTT_LOOPBACK_MAX_SUBSCRIPTIONS
+#define EEZ_MQTT_LOOPBACK_MAX_SUBSCRIPTIONS 16
+#endif
+
+struct LoopbackConnection {
+    bool isConnected;
+    char *subscriptions[EEZ_MQTT_LOOPBACK_MAX_SUBSCRIPTIONS];
+    LoopbackConnection *next;
+};
+
+static LoopbackConnection *g_firstLoopbackConnection;
+
+static bool loopbackTopicMatches(const char *filter, const char *topic) {
+    if (*topic == '$' && (*filter == '+' || *filter == '#')) {
+        // wildcards don't match system topics
+        return false;
+    }
+
+    for (;;) {
+        if (*filter == '#') {
+            return true;
+        }
+
+        if (*filter == '+') {
+            filter++;
+            while (*topic && *topic != '/') {
+                topic++;
+            }
+            continue;
+        }
+
+        if (*filter != *topic) {
+            // "a/#" also matches "a"
+            return *topic == 0 && filter[0] == '/' && filter[1] == '#' && filter[2] == 0;
+        }
+
+        if (*filter == 0) {
+            return true;
+        }
+
+        filter++;
+        topic++;
+    }
+}
+
+int eez_mqtt_init(const char *protocol, const char *host, int port, const char *username, const char *password, void **handle) {
+    EEZ_UNUSED(protocol);
+    EEZ_UNUSED(host);
+    EEZ_UNUSED(port);
+    EEZ_UNUSED(username);
+    EEZ_UNUSED(password);
+
+    auto connection = (LoopbackConnection *)eez::alloc(sizeof(LoopbackConnection), 0x6f1e2a84);
     if (!connection) {
-        return;
+        return MQTT_ERROR_OTHER;
     }
 
-    for (auto eventHandler = connection->firstEventHandler; eventHandler; eventHandler = eventHandler->next) {
-        auto componentExecutionState = eventHandler->componentExecutionState;
+    connection->isConnected = false;
+    for (size_t i = 0; i < EEZ_MQTT_LOOPBACK_MAX_SUBSCRIPTIONS; i++) {
+        connection->subscriptions[i] = nullptr;
+    }
 
-        auto flowState = componentExecutionState->flowState;
-        auto componentIndex = componentExecutionState->componentIndex;
+    connection->next = g_firstLoopbackConnection;
+    g_firstLoopbackConnection = connection;
 
-        auto component = (MQTTEventActionComponenent *)flowState->flow->components[componentIndex];
+    *handle = connection;
 
-        if (event == EEZ_MQTT_EVENT_CONNECT) {
-            if (component->connectEventOutputIndex >= 0) {
-                componentExecutionState->addEvent(component->connectEventOutputIndex);
-            }
-        } else if (event == EEZ_MQTT_EVENT_RECONNECT) {
-            if (component->reconnectEventOutputIndex >= 0) {
-                componentExecutionState->addEvent(component->reconnectEventOutputIndex);
-            }
-        } else if (event == EEZ_MQTT_EVENT_CLOSE) {
-            if (component->closeEventOutputIndex >= 0) {
-                componentExecutionState->addEvent(component->closeEventOutputIndex);
-            }
-        } else if (event == EEZ_MQTT_EVENT_DISCONNECT) {
-            if (component->disconnectEventOutputIndex >= 0) {
-                componentExecutionState->addEvent(component->disconnectEventOutputIndex);
-            }
-        } else if (event == EEZ_MQTT_EVENT_OFFLINE) {
-            if (component->offlineEventOutputIndex >= 0) {
-                componentExecutionState->addEvent(component->offlineEventOutputIndex);
-            }
-        } else if (event == EEZ_MQTT_EVENT_END) {
-            if (component->endEventOutputIndex >= 0) {
-                componentExecutionState->addEvent(component->endEventOutputIndex);
-            }
-        } else if (event == EEZ_MQTT_EVENT_ERROR) {
-            if (component->errorEventOutputIndex >= 0) {
-                componentExecutionState->addEvent(component->errorEventOutputIndex, Value::makeStringRef((const char *)eventData, -1, 0x2b7ac31a));
-            }
-        } else if (event == EEZ_MQTT_EVENT_MESSAGE) {
-            if (component->messageEventOutputIndex >= 0) {
-                auto messageEvent = (EEZ_MQTT_MessageEvent *)eventData;
+    return MQTT_ERROR_OK;
+}
 
-                Value messageValue = Value::makeArrayRef(defs_v3::SYSTEM_STRUCTURE_MQTT_MESSAGE_NUM_FIELDS, defs_v3::SYSTEM_STRUCTURE_MQTT_MESSAGE, 0xe256716a);
-                auto messageArray = messageValue.getArray();
-                messageArray->values[defs_v3::SYSTEM_STRUCTURE_MQTT_MESSAGE_FIELD_TOPIC] = Value::makeStringRef(messageEvent->topic, -1, 0x5bdff567);
-                messageArray->values[defs_v3::SYSTEM_STRUCTURE_MQTT_MESSAGE_FIELD_PAYLOAD] = Value::makeStringRef(messageEvent->payload, -1, 0xcfa25e4f);
+int eez_mqtt_deinit(void *handle) {
+    auto connection = (LoopbackConnection *)handle;
+
+    for (auto pNext = &g_firstLoopbackConnection; *pNext; pNext = &(*pNext)->next) {
+        if (*pNext == connection) {
+            *pNext = connection->next;
+            break;
+        }
+    }
 
-                componentExecutionState->addEvent(component->messageEventOutputIndex, messageValue);
+    for (size_t i = 0; i < EEZ_MQTT_LOOPBACK_MAX_SUBSCRIPTIONS; i++) {
+        if (connection->subscriptions[i]) {
+            eez::free(connection->subscriptions[i]);
+        }
+    }
+
+    eez::free(connection);
+
+    return MQTT_ERROR_OK;
+}
+
+int eez_mqtt_connect(void *handle) {
+    auto connection = (LoopbackConnection *)handle;
+    connection->isConnected = true;
+    eez_mqtt_on_event_callback(handle, EEZ_MQTT_EVENT_CONNECT, nullptr);
+    return MQTT_ERROR_OK;
+}
+
+int eez_mqtt_disconnect(void *handle) {
+    auto connection = (LoopbackConnection *)handle;
+    connection->isConnected = false;
+    eez_mqtt_on_event_callback(handle, EEZ_MQTT_EVENT_CLOSE, nullptr);
+    return MQTT_ERROR_OK;
+}
+
+int eez_mqtt_subscribe(void *handle, const char *topic) {
+    auto connection = (LoopbackConnection *)handle;
+    for (size_t i = 0; i < EEZ_MQTT_LOOPBACK_MAX_SUBSCRIPTIONS; i++) {
+        if (!connection->subscriptions[i]) {
+            auto topicLength = strlen(topic);
+            connection->subscriptions[i] = (char *)eez::alloc(topicLength + 1, 0x6f1e2a85);
+            if (!connection->subscriptions[i]) {
+                return MQTT_ERROR_OTHER;
             }
+            memcpy(connection->subscriptions[i], topic, topicLength + 1);
+            return MQTT_ERROR_OK;
         }
     }
+    return MQTT_ERROR_OTHER;
 }
 
-EM_PORT_API(void) onMqttEvent(void *handle, EEZ_MQTT_Event event, void *eventDataPtr1, void *eventDataPtr2) {
-    void *eventData;
-    if (eventDataPtr1 && eventDataPtr2)  {
-        EEZ_MQTT_MessageEvent eventData;
-        eventData.topic = (const char *)eventDataPtr1;
-        eventData.payload = (const char *)eventDataPtr2;
-        eez_mqtt_on_event_callback(handle, event, &eventData);
-    } else if (eventDataPtr1) {
-        eez_mqtt_on_event_callback(handle, event, eventDataPtr1);
-    } else {
-        eez_mqtt_on_event_callback(handle, event, nullptr);
+int eez_mqtt_unsubscribe(void *handle, const char *topic) {
+    auto connection = (LoopbackConnection *)handle;
+    for (size_t i = 0; i < EEZ_MQTT_LOOPBACK_MAX_SUBSCRIPTIONS; i++) {
+        if (connection->subscriptions[i] && strcmp(connection->subscriptions[i], topic) == 0) {
+            eez::free(connection->subscriptions[i]);
+            connection->subscriptions[i] = nullptr;
+            return MQTT_ERROR_OK;
+        }
+    }
+    return MQTT_ERROR_OTHER;
+}
+
+int eez_mqtt_publish(void *handle, const char *topic, const char *payload) {
+    if (!((LoopbackConnection *)handle)->isConnected) {
+        return MQTT_ERROR_OTHER;
+    }
+
+    for (auto connection = g_firstLoopbackConnection; connection; connection = connection->next) {
+        if (!connection->isConnected) {
+            continue;
+        }
+        for (size_t i = 0; i < EEZ_MQTT_LOOPBACK_MAX_SUBSCRIPTIONS; i++) {
+            if (connection->subscriptions[i] && loopbackTopicMatches(connection->subscriptions[i], topic)) {
+                eez_mqtt_on_message_callback(connection, topic, payload, strlen(payload));
+                break;
+            }
+        }
     }
+
+    return MQTT_ERROR_OK;
+}
+
+void eez_mqtt_loopback_inject(void *handle, const char *topic, const void *payload, size_t payloadLength) {
+    eez_mqtt_on_message_callback(handle, topic, payload, payloadLength);
 }
 
 #else
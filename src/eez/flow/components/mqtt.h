@@ -8,6 +8,66 @@
  * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <stddef.h>
+#include <stdint.h>
+
+// Max. number of received events waiting to be processed by the flow, per connection (must be power of 2)
+#ifndef EEZ_MQTT_EVENT_QUEUE_SIZE
+#define EEZ_MQTT_EVENT_QUEUE_SIZE 32
+#endif
+
+// Topic and payload of the received message are stored inside the event queue if they fit in this
+// many bytes, otherwise they are allocated on the heap
+#ifndef EEZ_MQTT_EVENT_DATA_SIZE
+#define EEZ_MQTT_EVENT_DATA_SIZE 96
+#endif
+
+// What to do when event is received and the event queue is full, also when message is matched
+// by the topic filter of MQTTEvent component which already has EEZ_MQTT_EVENT_QUEUE_SIZE
+// messages waiting to be delivered
+#define EEZ_MQTT_OVERFLOW_DROP_OLDEST 0
+#define EEZ_MQTT_OVERFLOW_DROP_NEWEST 1
+// Same as EEZ_MQTT_OVERFLOW_DROP_OLDEST, and also if MQTTEvent component still didn't deliver
+// the message with the same topic it is replaced with the new one
+#define EEZ_MQTT_OVERFLOW_COALESCE_TOPIC 2
+
+#ifndef EEZ_MQTT_OVERFLOW_POLICY
+#define EEZ_MQTT_OVERFLOW_POLICY EEZ_MQTT_OVERFLOW_DROP_OLDEST
+#endif
+
+// Index of the "Topic filter" property of MQTTEvent component. This property is not (yet) generated
+// into flow_defs_v3.h by the Studio, so it is read only if the component has that many properties.
+// MQTTEvent component without the topic filter receives all the messages, including topics starting with '$'.
+#ifndef EEZ_MQTT_EVENT_TOPIC_FILTER_PROPERTY
+#define EEZ_MQTT_EVENT_TOPIC_FILTER_PROPERTY 1
+#endif
+
+// Max. length of the topic filter reported by eez_mqtt_get_topic_filter_stats, including null terminator
+#ifndef EEZ_MQTT_MAX_TOPIC_LENGTH
+#define EEZ_MQTT_MAX_TOPIC_LENGTH 256
+#endif
+
+// Max. number of simultaneously initialized connections
+#ifndef EEZ_MQTT_MAX_CONNECTIONS
+#define EEZ_MQTT_MAX_CONNECTIONS 8
+#endif
+
+// Max. number of events MQTTEvent component delivers in one tick, the rest is delivered in the next tick
+#ifndef EEZ_MQTT_EVENTS_PER_TICK
+#define EEZ_MQTT_EVENTS_PER_TICK 16
+#endif
+
+// If no events are in the queue, check again after this many milliseconds
+#ifndef EEZ_MQTT_EVENT_POLL_PERIOD
+#define EEZ_MQTT_EVENT_POLL_PERIOD 10
+#endif
+
+// 1: message payload is always delivered as blob
+// 0: message payload is delivered as string, or as blob if it contains null character
+#ifndef EEZ_MQTT_PAYLOAD_AS_BLOB
+#define EEZ_MQTT_PAYLOAD_AS_BLOB 0
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -30,7 +90,9 @@ int eez_mqtt_unsubscribe(void *handle, const char *topic);
 int eez_mqtt_publish(void *handle, const char *topic, const char *payload);
 
 //
-// The following function is implemented inside EEZ Framework and should be called by the MQTT library adapter
+// The following functions are implemented inside EEZ Framework and should be called by the MQTT library adapter.
+// They can be called from any thread, but events of the same connection must be reported from one thread
+// at the time and adapter must not report any event after eez_mqtt_deinit returned.
 //
 
 typedef enum {
@@ -49,6 +111,28 @@ typedef struct {
     const char *payload;
 } EEZ_MQTT_MessageEvent;
 
+void eez_mqtt_on_event_callback(void *handle, EEZ_MQTT_Event event, void *eventData);
+
+// Same as EEZ_MQTT_EVENT_MESSAGE event, but payload can contain binary data
+void eez_mqtt_on_message_callback(void *handle, const char *topic, const void *payload, size_t payloadLength);
+
+// Number of events dropped because the event queue was full
+uint32_t eez_mqtt_get_num_dropped_events(void *handle);
+
+// Reports for each topic filter used by MQTTEvent components how many messages it matched and
+// how many of them were dropped (or replaced with newer one) before being delivered.
+// Components without the topic filter are reported together, with the empty topic filter.
+// Unlike the functions above, this one must be called from the flow thread.
+typedef void (*EEZ_MQTT_TopicFilterStatsCallback)(const char *topicFilter, uint32_t numMatchedMessages, uint32_t numDroppedMessages, void *param);
+void eez_mqtt_get_topic_filter_stats(void *handle, EEZ_MQTT_TopicFilterStatsCallback callback, void *param);
+
+#ifdef EEZ_MQTT_LOOPBACK
+// Loopback adapter is used for testing without MQTT broker: published messages are delivered to all
+// connected loopback connections subscribed to the topic. This function delivers message to the
+// connection as if it was received from the broker.
+void eez_mqtt_loopback_inject(void *handle, const char *topic, const void *payload, size_t payloadLength);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -23,6 +23,7 @@
 #include <eez/flow/dashboard_api.h>
 #include <eez/flow/private.h>
 #include <eez/flow/debugger.h>
+#include <eez/flow/watch_list.h>
 
 using namespace eez;
 using namespace eez::flow;
@@ -353,6 +354,7 @@ EM_PORT_API(Value *) createErrorValue() {
 EM_PORT_API(void) arrayValueSetElementValue(Value *arrayValuePtr, int elementIndex, Value *valuePtr) {
     auto array = arrayValuePtr->getArray();
     array->values[elementIndex] = *valuePtr;
+    markValueChanged(nullptr, nullptr);
 }
 
 EM_PORT_API(void) valueFree(Value *valuePtr) {
@@ -376,6 +378,7 @@ EM_PORT_API(void) setGlobalVariable(int globalVariableIndex, Value *valuePtr) {
         : flowDefinition->globalVariables[globalVariableIndex];
     *globalVariableValuePtr = *valuePtr;
     onValueChanged(globalVariableValuePtr);
+    markGlobalVariableChanged(globalVariableIndex);
 }
 
 EM_PORT_API(void) updateGlobalVariable(int globalVariableIndex, Value *valuePtr) {
@@ -384,6 +387,7 @@ EM_PORT_API(void) updateGlobalVariable(int globalVariableIndex, Value *valuePtr)
         ? g_globalVariables->values + globalVariableIndex
         : flowDefinition->globalVariables[globalVariableIndex];
     updateArrayValue(globalVariableValuePtr->getArray(), valuePtr->getArray());
+    markGlobalVariableChanged(globalVariableIndex);
 }
 
 EM_PORT_API(int) getFlowIndex(int flowStateIndex) {
@@ -588,6 +592,7 @@ EM_PORT_API(void) setPropertyField(int flowStateIndex, int componentIndex, int p
 
     array->values[fieldIndex] = *valuePtr;
     onValueChanged(array->values + fieldIndex);
+    markValueChanged(flowState, array->values + fieldIndex);
 }
 
 EM_PORT_API(void) propagateValue(int flowStateIndex, int componentIndex, int outputIndex, Value *valuePtr) {
@@ -24,6 +24,7 @@
 #include <eez/flow/private.h>
 #include <eez/flow/debugger.h>
 #include <eez/flow/hooks.h>
+#include <eez/flow/profiler.h>
 
 namespace eez {
 namespace flow {
@@ -53,9 +54,39 @@ enum MessagesToDebugger {
 	MESSAGE_TO_DEBUGGER_PAGE_CHANGED, // PAGE_ID
 
     MESSAGE_TO_DEBUGGER_COMPONENT_EXECUTION_STATE_CHANGED, // FLOW_STATE_INDEX, COMPONENT_INDEX, STATE
-    MESSAGE_TO_DEBUGGER_COMPONENT_ASYNC_STATE_CHANGED // FLOW_STATE_INDEX, COMPONENT_INDEX, STATE
+    MESSAGE_TO_DEBUGGER_COMPONENT_ASYNC_STATE_CHANGED, // FLOW_STATE_INDEX, COMPONENT_INDEX, STATE
+
+    MESSAGE_TO_DEBUGGER_PROFILER_TICK_STATS, // NUM_TICKS, NUM_TICKS_OVER_BUDGET, TOTAL_TICK_TIME, MAX_TICK_TIME, TOTAL_WATCH_LIST_TIME, MAX_WATCH_LIST_TIME, MAX_QUEUE_SIZE, NUM_UNTRACKED_COMPONENT_EXECUTIONS, QUEUE_SIZE_HISTORY (comma separated)
+    MESSAGE_TO_DEBUGGER_PROFILER_COMPONENT_STATS, // FLOW_INDEX, COMPONENT_TYPE, COUNT, TOTAL_TIME, MAX_TIME, HISTOGRAM (comma separated)
+
+    MESSAGE_TO_DEBUGGER_PROTOCOL_CHANGED // PROTOCOL, VALUE_SIZE, ARRAY_VALUES_OFFSET, ALLOC_BUFFER_SIZE (always sent as text)
 };
 
+// Binary protocol
+//
+// After MESSAGE_TO_DEBUGGER_PROTOCOL_CHANGED with PROTOCOL 1 all messages are binary.
+// Message is varint encoded message type followed by the same params as in the text protocol
+// encoded as:
+//   - unsigned ints and addresses: varint (LEB128)
+//   - signed ints: zigzag varint
+//   - strings: varint length followed by UTF-8 bytes (no escaping)
+//   - values: VALUE_TYPE_* byte followed by:
+//       - BOOLEAN: 1 byte
+//       - INT8 - INT64: zigzag varint, UINT8 - UINT64: varint
+//       - FLOAT, DOUBLE, DATE: 4 or 8 bytes little endian
+//       - STRING: string
+//       - ARRAY: ADDR, SIZE, ARRAY_TYPE, IS_DELTA (1 byte), followed by VALUE_CHANGED message for each
+//         transferred element (if IS_DELTA is 1 only for the elements changed since the array was last sent),
+//         element address is ADDR + ARRAY_VALUES_OFFSET + index * VALUE_SIZE
+//       - BLOB_REF: varint length, STREAM and JSON: zigzag varint, POINTER, WIDGET and EVENT: address
+// Differences in params:
+//   - ADD_TO_QUEUE: -1 is sent as 0 for SOURCE_COMPONENT_INDEX, SOURCE_OUTPUT_INDEX and TARGET_INPUT_INDEX
+//     (i.e. index + 1), FREE_MEMORY is sent as difference to FREE_MEMORY in previous ADD_TO_QUEUE message
+//     and ALLOC_MEMORY is not sent (it is in PROTOCOL_CHANGED)
+//   - REMOVE_FROM_QUEUE: COUNT, consecutive removes are sent as one message
+//   - histograms and QUEUE_SIZE_HISTORY in profiler messages: varint count followed by varint items
+// Messages are batched and written at the end of every tick.
+
 enum MessagesFromDebugger {
     MESSAGE_FROM_DEBUGGER_RESUME, // no params
     MESSAGE_FROM_DEBUGGER_PAUSE, // no params
@@ -66,7 +97,11 @@ enum MessagesFromDebugger {
     MESSAGE_FROM_DEBUGGER_ENABLE_BREAKPOINT, // FLOW_INDEX, COMPONENT_INDEX
     MESSAGE_FROM_DEBUGGER_DISABLE_BREAKPOINT, // FLOW_INDEX, COMPONENT_INDEX
 
-    MESSAGE_FROM_DEBUGGER_MODE // MODE (0:RUN | 1:DEBUG)
+    MESSAGE_FROM_DEBUGGER_MODE, // MODE (0:RUN | 1:DEBUG)
+
+    MESSAGE_FROM_DEBUGGER_GET_PROFILER_STATS, // RESET (0 | 1), only if EEZ_FLOW_PROFILER is enabled
+
+    MESSAGE_FROM_DEBUGGER_PROTOCOL // PROTOCOL (0:TEXT | 1:BINARY), only if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL is enabled
 };
 
 enum LogItemType {
@@ -96,6 +131,139 @@ static unsigned g_inputFromDebuggerPosition;
 
 int g_debuggerMode = DEBUGGER_MODE_RUN;
 
+enum DebuggerProtocol {
+    DEBUGGER_PROTOCOL_TEXT,
+    DEBUGGER_PROTOCOL_BINARY
+};
+
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+static DebuggerProtocol g_debuggerProtocol = DEBUGGER_PROTOCOL_TEXT;
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+
+static uint8_t g_binaryOutputBuffer[EEZ_FLOW_DEBUGGER_BINARY_OUTPUT_BUFFER_SIZE];
+static uint32_t g_binaryOutputBufferPosition;
+
+static uint32_t g_numPendingRemoveFromQueue;
+static uint32_t g_lastSentFreeMemory;
+
+// Array for which the debugger already has all the elements, so only changed elements are sent again.
+// Copies of the sent elements are kept (not hashes), so a change is never missed. Because they hold
+// references, a sent string can't be freed and its address reused while it is tracked.
+struct TrackedArray {
+    const ArrayValue *arrayValue;
+    uint32_t arraySize;
+    uint32_t arrayType;
+    uint32_t lastUsed;
+    uint32_t numElementValues;
+    Value *elementValues;
+};
+
+static TrackedArray g_trackedArrays[EEZ_FLOW_DEBUGGER_MAX_TRACKED_ARRAYS];
+static uint32_t g_trackedArraysUseCounter;
+
+static void flushBinaryOutput() {
+    if (g_binaryOutputBufferPosition > 0) {
+        writeDebuggerBufferHook((const char *)g_binaryOutputBuffer, g_binaryOutputBufferPosition);
+        g_binaryOutputBufferPosition = 0;
+    }
+}
+
+static void binaryBytes(const void *data, size_t length) {
+    auto src = (const uint8_t *)data;
+    while (length > 0) {
+        if (g_binaryOutputBufferPosition == sizeof(g_binaryOutputBuffer)) {
+            flushBinaryOutput();
+        }
+        auto n = sizeof(g_binaryOutputBuffer) - g_binaryOutputBufferPosition;
+        if (n > length) {
+            n = length;
+        }
+        memcpy(g_binaryOutputBuffer + g_binaryOutputBufferPosition, src, n);
+        g_binaryOutputBufferPosition += n;
+        src += n;
+        length -= n;
+    }
+}
+
+static inline void binaryByte(uint8_t value) {
+    if (g_binaryOutputBufferPosition == sizeof(g_binaryOutputBuffer)) {
+        flushBinaryOutput();
+    }
+    g_binaryOutputBuffer[g_binaryOutputBufferPosition++] = value;
+}
+
+static void binaryUint(uint64_t value) {
+    while (value >= 0x80) {
+        binaryByte((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    binaryByte((uint8_t)value);
+}
+
+static inline void binaryInt(int64_t value) {
+    binaryUint(((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+static inline void binaryAddr(const void *ptr) {
+    binaryUint((uintptr_t)ptr);
+}
+
+static void binaryString(const char *str, size_t length) {
+    binaryUint(length);
+    binaryBytes(str, length);
+}
+
+static inline void binaryString(const char *str) {
+    binaryString(str, strlen(str));
+}
+
+static void binaryRemoveFromQueue() {
+    if (g_numPendingRemoveFromQueue > 0) {
+        binaryUint(MESSAGE_TO_DEBUGGER_REMOVE_FROM_QUEUE);
+        binaryUint(g_numPendingRemoveFromQueue);
+        g_numPendingRemoveFromQueue = 0;
+    }
+}
+
+static void binaryMessage(MessagesToDebugger messageType) {
+    // keep the order of messages, consecutive removes are coalesced until some other message is sent
+    binaryRemoveFromQueue();
+    binaryUint(messageType);
+}
+
+static void untrackArray(TrackedArray &trackedArray) {
+    if (trackedArray.elementValues) {
+        for (uint32_t i = 0; i < trackedArray.numElementValues; i++) {
+            (trackedArray.elementValues + i)->~Value();
+        }
+        eez::free(trackedArray.elementValues);
+    }
+    trackedArray.arrayValue = nullptr;
+    trackedArray.numElementValues = 0;
+    trackedArray.elementValues = nullptr;
+}
+
+static void resetTrackedArrays() {
+    for (uint32_t i = 0; i < EEZ_FLOW_DEBUGGER_MAX_TRACKED_ARRAYS; i++) {
+        untrackArray(g_trackedArrays[i]);
+    }
+}
+
+static void setDebuggerProtocol(DebuggerProtocol protocol) {
+    g_debuggerProtocol = protocol;
+
+    g_binaryOutputBufferPosition = 0;
+    g_numPendingRemoveFromQueue = 0;
+    g_lastSentFreeMemory = 0;
+    resetTrackedArrays();
+}
+
+#endif // EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+
 ////////////////////////////////////////////////////////////////////////////////
 
 void setDebuggerMessageSubsciptionFilter(uint32_t filter) {
@@ -117,6 +285,13 @@ static void setDebuggerState(DebuggerState newState) {
 		g_debuggerState = newState;
 
 		if (isSubscribedTo(MESSAGE_TO_DEBUGGER_STATE_CHANGED)) {
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+            if (g_debuggerProtocol == DEBUGGER_PROTOCOL_BINARY) {
+                binaryMessage(MESSAGE_TO_DEBUGGER_STATE_CHANGED);
+                binaryUint(g_debuggerState);
+                return;
+            }
+#endif
 			char buffer[256];
 			snprintf(buffer, sizeof(buffer), "%d\t%d\n",
 				MESSAGE_TO_DEBUGGER_STATE_CHANGED,
@@ -135,14 +310,138 @@ void onDebuggerClientConnected() {
 	g_skipNextBreakpoint = false;
 	g_inputFromDebuggerPosition = 0;
 
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+    // every client starts with the text protocol
+    setDebuggerProtocol(DEBUGGER_PROTOCOL_TEXT);
+#endif
+
     setDebuggerState(DEBUGGER_STATE_PAUSED);
 }
 
 void onDebuggerClientDisconnected() {
     g_debuggerIsConnected = false;
     setDebuggerState(DEBUGGER_STATE_RESUMED);
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+    setDebuggerProtocol(DEBUGGER_PROTOCOL_TEXT);
+#endif
+}
+
+void flushDebuggerOutput() {
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+    if (g_debuggerProtocol == DEBUGGER_PROTOCOL_BINARY && g_debuggerIsConnected) {
+        binaryRemoveFromQueue();
+        flushBinaryOutput();
+    }
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#if EEZ_FLOW_PROFILER
+
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+static void sendProfilerStatsBinary() {
+    if (isSubscribedTo(MESSAGE_TO_DEBUGGER_PROFILER_TICK_STATS)) {
+        eez_flow_profiler_tick_stats_t tickStats;
+        eez_flow_profiler_get_tick_stats(&tickStats);
+
+        binaryMessage(MESSAGE_TO_DEBUGGER_PROFILER_TICK_STATS);
+        binaryUint(tickStats.numTicks);
+        binaryUint(tickStats.numTicksOverBudget);
+        binaryUint(tickStats.totalTickTime);
+        binaryUint(tickStats.maxTickTime);
+        binaryUint(tickStats.totalWatchListTime);
+        binaryUint(tickStats.maxWatchListTime);
+        binaryUint(tickStats.maxQueueSize);
+        binaryUint(tickStats.numUntrackedComponentExecutions);
+        binaryUint(tickStats.numQueueSizeHistory);
+        for (uint32_t i = 0; i < tickStats.numQueueSizeHistory; i++) {
+            binaryUint(tickStats.queueSizeHistory[i]);
+        }
+    }
+
+    eez_flow_profiler_component_stats_t componentStats;
+    for (uint32_t i = 0; eez_flow_profiler_get_component_stats(i, &componentStats); i++) {
+        if (!isSubscribedTo(MESSAGE_TO_DEBUGGER_PROFILER_COMPONENT_STATS)) {
+            break;
+        }
+
+        binaryMessage(MESSAGE_TO_DEBUGGER_PROFILER_COMPONENT_STATS);
+        binaryUint(componentStats.flowIndex);
+        binaryUint(componentStats.componentType);
+        binaryUint(componentStats.count);
+        binaryUint(componentStats.totalTime);
+        binaryUint(componentStats.maxTime);
+        binaryUint(EEZ_FLOW_PROFILER_HISTOGRAM_SIZE);
+        for (uint32_t j = 0; j < EEZ_FLOW_PROFILER_HISTOGRAM_SIZE; j++) {
+            binaryUint(componentStats.histogram[j]);
+        }
+    }
+}
+#endif
+
+static void sendProfilerStats() {
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+    if (g_debuggerProtocol == DEBUGGER_PROTOCOL_BINARY) {
+        sendProfilerStatsBinary();
+        return;
+    }
+#endif
+
+    char buffer[256];
+
+    if (isSubscribedTo(MESSAGE_TO_DEBUGGER_PROFILER_TICK_STATS)) {
+        eez_flow_profiler_tick_stats_t tickStats;
+        eez_flow_profiler_get_tick_stats(&tickStats);
+
+        snprintf(buffer, sizeof(buffer), "%d\t%" PRIu32 "\t%" PRIu32 "\t%" PRIu64 "\t%" PRIu32 "\t%" PRIu64 "\t%" PRIu32 "\t%" PRIu32 "\t%" PRIu32 "\t",
+            MESSAGE_TO_DEBUGGER_PROFILER_TICK_STATS,
+            tickStats.numTicks,
+            tickStats.numTicksOverBudget,
+            tickStats.totalTickTime,
+            tickStats.maxTickTime,
+            tickStats.totalWatchListTime,
+            tickStats.maxWatchListTime,
+            tickStats.maxQueueSize,
+            tickStats.numUntrackedComponentExecutions
+        );
+        writeDebuggerBufferHook(buffer, strlen(buffer));
+
+        for (uint32_t i = 0; i < tickStats.numQueueSizeHistory; i++) {
+            snprintf(buffer, sizeof(buffer), i > 0 ? ",%" PRIu32 : "%" PRIu32, tickStats.queueSizeHistory[i]);
+            writeDebuggerBufferHook(buffer, strlen(buffer));
+        }
+
+        writeDebuggerBufferHook("\n", 1);
+    }
+
+    eez_flow_profiler_component_stats_t componentStats;
+    for (uint32_t i = 0; eez_flow_profiler_get_component_stats(i, &componentStats); i++) {
+        if (!isSubscribedTo(MESSAGE_TO_DEBUGGER_PROFILER_COMPONENT_STATS)) {
+            break;
+        }
+
+        snprintf(buffer, sizeof(buffer), "%d\t%d\t%d\t%" PRIu32 "\t%" PRIu64 "\t%" PRIu32 "\t",
+            MESSAGE_TO_DEBUGGER_PROFILER_COMPONENT_STATS,
+            (int)componentStats.flowIndex,
+            (int)componentStats.componentType,
+            componentStats.count,
+            componentStats.totalTime,
+            componentStats.maxTime
+        );
+        writeDebuggerBufferHook(buffer, strlen(buffer));
+
+        for (uint32_t j = 0; j < EEZ_FLOW_PROFILER_HISTOGRAM_SIZE; j++) {
+            snprintf(buffer, sizeof(buffer), j > 0 ? ",%" PRIu32 : "%" PRIu32, componentStats.histogram[j]);
+            writeDebuggerBufferHook(buffer, strlen(buffer));
+        }
+
+        writeDebuggerBufferHook("\n", 1);
+    }
 }
 
+#endif // EEZ_FLOW_PROFILER
+
 ////////////////////////////////////////////////////////////////////////////////
 
 void processDebuggerInput(char *buffer, uint32_t length) {
@@ -185,6 +484,44 @@ void processDebuggerInput(char *buffer, uint32_t length) {
                 gui::refreshScreen();
 #endif
             }
+#if EEZ_FLOW_PROFILER
+            else if (messageFromDebugger == MESSAGE_FROM_DEBUGGER_GET_PROFILER_STATS) {
+                sendProfilerStats();
+                if (strtol(g_inputFromDebugger + 2, nullptr, 10)) {
+                    profilerReset();
+                }
+            }
+#endif
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+            else if (messageFromDebugger == MESSAGE_FROM_DEBUGGER_PROTOCOL) {
+                auto protocol = strtol(g_inputFromDebugger + 2, nullptr, 10) == DEBUGGER_PROTOCOL_BINARY ?
+                    DEBUGGER_PROTOCOL_BINARY : DEBUGGER_PROTOCOL_TEXT;
+
+                // everything batched so far is sent in the old protocol
+                flushDebuggerOutput();
+                setDebuggerProtocol(protocol);
+
+                if (g_debuggerIsConnected) {
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winvalid-offsetof"
+#endif
+                    char buffer[256];
+                    snprintf(buffer, sizeof(buffer), "%d\t%d\t%d\t%d\t%u\n",
+                        MESSAGE_TO_DEBUGGER_PROTOCOL_CHANGED,
+                        (int)protocol,
+                        (int)sizeof(Value),
+                        (int)offsetof(ArrayValue, values),
+                        (unsigned int)ALLOC_BUFFER_SIZE
+                    );
+#ifdef __GNUC__
+#pragma GCC diagnostic pop
+#endif
+                    startToDebuggerMessageHook();
+                    writeDebuggerBufferHook(buffer, strlen(buffer));
+                }
+            }
+#endif
 
 			g_inputFromDebuggerPosition = 0;
 		} else {
@@ -469,12 +806,209 @@ static void writeValue(const Value &value) {
 	writeDebuggerBufferHook(tempStr, strlen(tempStr));
 }
 
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+
+// Returns true only if it is certain that the debugger already has this value
+static bool isAlreadySent(const Value &sentValue, const Value &value) {
+    switch (value.type) {
+    case VALUE_TYPE_UNDEFINED:
+    case VALUE_TYPE_NULL:
+    case VALUE_TYPE_BOOLEAN:
+    case VALUE_TYPE_INT8:
+    case VALUE_TYPE_UINT8:
+    case VALUE_TYPE_INT16:
+    case VALUE_TYPE_UINT16:
+    case VALUE_TYPE_INT32:
+    case VALUE_TYPE_UINT32:
+    case VALUE_TYPE_INT64:
+    case VALUE_TYPE_UINT64:
+    case VALUE_TYPE_FLOAT:
+    case VALUE_TYPE_DOUBLE:
+    case VALUE_TYPE_DATE:
+    // immutable, and sent value holds the reference
+    case VALUE_TYPE_STRING_ASSET:
+    case VALUE_TYPE_STRING_REF:
+        return sentValue.type == value.type && sentValue.unit == value.unit && sentValue.uint64Value == value.uint64Value;
+
+    default:
+        // VALUE_TYPE_STRING can point to a buffer that is modified in place,
+        // arrays are sent with their own delta, etc.
+        return false;
+    }
+}
+
+static TrackedArray *findTrackedArray(const ArrayValue *arrayValue, uint32_t transferredSize, bool &isDelta) {
+    isDelta = false;
+
+    TrackedArray *leastRecentlyUsed = &g_trackedArrays[0];
+
+    for (uint32_t i = 0; i < EEZ_FLOW_DEBUGGER_MAX_TRACKED_ARRAYS; i++) {
+        auto &trackedArray = g_trackedArrays[i];
+        if (trackedArray.arrayValue == arrayValue) {
+            if (trackedArray.arraySize == arrayValue->arraySize && trackedArray.arrayType == arrayValue->arrayType) {
+                trackedArray.lastUsed = ++g_trackedArraysUseCounter;
+                isDelta = true;
+                return &trackedArray;
+            }
+            leastRecentlyUsed = &trackedArray;
+            break;
+        }
+        if (trackedArray.lastUsed < leastRecentlyUsed->lastUsed) {
+            leastRecentlyUsed = &trackedArray;
+        }
+    }
+
+    auto &trackedArray = *leastRecentlyUsed;
+    untrackArray(trackedArray);
+
+    if (transferredSize == 0 || transferredSize > EEZ_FLOW_DEBUGGER_MAX_TRACKED_ARRAY_SIZE) {
+        // always sent in full
+        return nullptr;
+    }
+
+    trackedArray.elementValues = (Value *)alloc(transferredSize * sizeof(Value), 0x6c1f8a04);
+    if (!trackedArray.elementValues) {
+        return nullptr;
+    }
+    for (uint32_t i = 0; i < transferredSize; i++) {
+        new (trackedArray.elementValues + i) Value();
+    }
+    trackedArray.numElementValues = transferredSize;
+
+    trackedArray.arrayValue = arrayValue;
+    trackedArray.arraySize = arrayValue->arraySize;
+    trackedArray.arrayType = arrayValue->arrayType;
+    trackedArray.lastUsed = ++g_trackedArraysUseCounter;
+    return &trackedArray;
+}
+
+static void binaryArray(const ArrayValue *arrayValue) {
+    auto transferredSize = arrayValue->arraySize > MAX_ARRAY_SIZE_TRANSFERRED_IN_DEBUGGER ? MAX_ARRAY_SIZE_TRANSFERRED_IN_DEBUGGER : arrayValue->arraySize;
+
+    bool isDelta;
+    auto trackedArray = findTrackedArray(arrayValue, transferredSize, isDelta);
+
+    binaryAddr(arrayValue);
+    binaryUint(arrayValue->arraySize);
+    binaryUint(arrayValue->arrayType);
+    binaryByte(isDelta ? 1 : 0);
+
+    for (uint32_t i = 0; i < transferredSize; i++) {
+        auto &elementValue = arrayValue->values[i];
+        if (trackedArray) {
+            auto &sentValue = trackedArray->elementValues[i];
+            if (isDelta && isAlreadySent(sentValue, elementValue)) {
+                continue;
+            }
+            // arrays are not kept, they are tracked by their own entry
+            sentValue = elementValue.isArray() ? Value() : elementValue;
+        }
+        onValueChanged(&elementValue);
+    }
+}
+
+static void binaryValue(const Value &value) {
+    auto type = value.getType();
+
+    binaryByte((uint8_t)type);
+
+	switch (type) {
+	case VALUE_TYPE_BOOLEAN:
+		binaryByte(value.getBoolean() ? 1 : 0);
+		break;
+
+	case VALUE_TYPE_INT8:
+		binaryInt(value.int8Value);
+		break;
+
+	case VALUE_TYPE_UINT8:
+		binaryUint(value.uint8Value);
+		break;
+
+	case VALUE_TYPE_INT16:
+		binaryInt(value.int16Value);
+		break;
+
+	case VALUE_TYPE_UINT16:
+		binaryUint(value.uint16Value);
+		break;
+
+	case VALUE_TYPE_INT32:
+	case VALUE_TYPE_STREAM:
+	case VALUE_TYPE_JSON:
+		binaryInt(value.int32Value);
+		break;
+
+	case VALUE_TYPE_UINT32:
+		binaryUint(value.uint32Value);
+		break;
+
+	case VALUE_TYPE_INT64:
+		binaryInt(value.int64Value);
+		break;
+
+	case VALUE_TYPE_UINT64:
+		binaryUint(value.uint64Value);
+		break;
+
+	case VALUE_TYPE_FLOAT:
+		binaryBytes(&value.floatValue, sizeof(float));
+		break;
+
+	case VALUE_TYPE_DOUBLE:
+	case VALUE_TYPE_DATE:
+		binaryBytes(&value.doubleValue, sizeof(double));
+		break;
+
+	case VALUE_TYPE_STRING:
+	case VALUE_TYPE_STRING_ASSET:
+	case VALUE_TYPE_STRING_REF:
+		binaryString(value.getString());
+		break;
+
+	case VALUE_TYPE_ARRAY:
+	case VALUE_TYPE_ARRAY_ASSET:
+	case VALUE_TYPE_ARRAY_REF:
+		binaryArray(value.getArray());
+		break;
+
+	case VALUE_TYPE_BLOB_REF:
+		binaryUint(((BlobRef *)value.refValue)->len);
+		break;
+
+	case VALUE_TYPE_POINTER:
+	case VALUE_TYPE_WIDGET:
+	case VALUE_TYPE_EVENT:
+		binaryAddr(value.getVoidPointer());
+		break;
+
+	default:
+		break;
+	}
+}
+
+#endif // EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+
 ////////////////////////////////////////////////////////////////////////////////
 
 void onStarted(Assets *assets) {
     if (isSubscribedTo(MESSAGE_TO_DEBUGGER_GLOBAL_VARIABLE_INIT)) {
 		auto flowDefinition = static_cast<FlowDefinition *>(assets->flowDefinition);
 
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+        if (g_debuggerProtocol == DEBUGGER_PROTOCOL_BINARY) {
+            auto numVars = g_globalVariables ? g_globalVariables->count : flowDefinition->globalVariables.count;
+            for (uint32_t i = 0; i < numVars; i++) {
+                const Value *pValue = g_globalVariables ? g_globalVariables->values + i : flowDefinition->globalVariables[i];
+                binaryMessage(MESSAGE_TO_DEBUGGER_GLOBAL_VARIABLE_INIT);
+                binaryUint(i);
+                binaryAddr(pValue);
+                binaryValue(*pValue);
+            }
+            return;
+        }
+#endif
+
         if (g_globalVariables) {
             for (uint32_t i = 0; i < g_globalVariables->count; i++) {
                 auto pValue = g_globalVariables->values + i;
@@ -509,6 +1043,24 @@ void onStarted(Assets *assets) {
 
 void onStopped() {
     setDebuggerState(DEBUGGER_STATE_STOPPED);
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+    // addresses of the asset arrays are not valid anymore
+    resetTrackedArrays();
+#endif
+}
+
+void onDebuggerArrayValueFree(const ArrayValue *arrayValue) {
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+    for (uint32_t i = 0; i < EEZ_FLOW_DEBUGGER_MAX_TRACKED_ARRAYS; i++) {
+        if (g_trackedArrays[i].arrayValue == arrayValue) {
+            // another array can be allocated at the same address, it must be sent in full
+            untrackArray(g_trackedArrays[i]);
+            break;
+        }
+    }
+#else
+    EEZ_UNUSED(arrayValue);
+#endif
 }
 
 void onAddToQueue(FlowState *flowState, int sourceComponentIndex, int sourceOutputIndex, unsigned targetComponentIndex, int targetInputIndex) {
@@ -517,6 +1069,20 @@ void onAddToQueue(FlowState *flowState, int sourceComponentIndex, int sourceOutp
         uint32_t alloc;
         getAllocInfo(free, alloc);
 
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+        if (g_debuggerProtocol == DEBUGGER_PROTOCOL_BINARY) {
+            binaryMessage(MESSAGE_TO_DEBUGGER_ADD_TO_QUEUE);
+            binaryUint(flowState->flowStateIndex);
+            binaryUint(sourceComponentIndex + 1);
+            binaryUint(sourceOutputIndex + 1);
+            binaryUint(targetComponentIndex);
+            binaryUint(targetInputIndex + 1);
+            binaryInt((int64_t)free - (int64_t)g_lastSentFreeMemory);
+            g_lastSentFreeMemory = free;
+            return;
+        }
+#endif
+
         char buffer[256];
 		snprintf(buffer, sizeof(buffer), "%d\t%d\t%d\t%d\t%d\t%d\t%u\t%u\n",
 			MESSAGE_TO_DEBUGGER_ADD_TO_QUEUE,
@@ -534,6 +1100,12 @@ void onAddToQueue(FlowState *flowState, int sourceComponentIndex, int sourceOutp
 
 void onRemoveFromQueue() {
     if (isSubscribedTo(MESSAGE_TO_DEBUGGER_REMOVE_FROM_QUEUE)) {
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+        if (g_debuggerProtocol == DEBUGGER_PROTOCOL_BINARY) {
+            g_numPendingRemoveFromQueue++;
+            return;
+        }
+#endif
         char buffer[256];
 		snprintf(buffer, sizeof(buffer), "%d\n",
 			MESSAGE_TO_DEBUGGER_REMOVE_FROM_QUEUE
@@ -544,6 +1116,14 @@ void onRemoveFromQueue() {
 
 void onValueChanged(const Value *pValue) {
     if (isSubscribedTo(MESSAGE_TO_DEBUGGER_VALUE_CHANGED)) {
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+        if (g_debuggerProtocol == DEBUGGER_PROTOCOL_BINARY) {
+            binaryMessage(MESSAGE_TO_DEBUGGER_VALUE_CHANGED);
+            binaryAddr(pValue);
+            binaryValue(pValue->getValue());
+            return;
+        }
+#endif
         char buffer[256];
 		snprintf(buffer, sizeof(buffer), "%d\t%p\t",
 			MESSAGE_TO_DEBUGGER_VALUE_CHANGED,
@@ -555,7 +1135,50 @@ void onValueChanged(const Value *pValue) {
     }
 }
 
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+static void onFlowStateCreatedBinary(FlowState *flowState) {
+    if (isSubscribedTo(MESSAGE_TO_DEBUGGER_FLOW_STATE_CREATED)) {
+        binaryMessage(MESSAGE_TO_DEBUGGER_FLOW_STATE_CREATED);
+        binaryUint(flowState->flowStateIndex);
+        binaryUint(flowState->flowIndex);
+        binaryInt(flowState->parentFlowState ? flowState->parentFlowState->flowStateIndex : -1);
+        binaryInt(flowState->parentComponentIndex);
+    }
+
+    auto flow = flowState->flow;
+
+    if (isSubscribedTo(MESSAGE_TO_DEBUGGER_LOCAL_VARIABLE_INIT)) {
+		for (uint32_t i = 0; i < flow->localVariables.count; i++) {
+			auto pValue = &flowState->values[flow->componentInputs.count + i];
+            binaryMessage(MESSAGE_TO_DEBUGGER_LOCAL_VARIABLE_INIT);
+            binaryUint(flowState->flowStateIndex);
+            binaryUint(i);
+            binaryAddr(pValue);
+            binaryValue(*pValue);
+        }
+    }
+
+    if (isSubscribedTo(MESSAGE_TO_DEBUGGER_COMPONENT_INPUT_INIT)) {
+		for (uint32_t i = 0; i < flow->componentInputs.count; i++) {
+            auto pValue = &flowState->values[i];
+            binaryMessage(MESSAGE_TO_DEBUGGER_COMPONENT_INPUT_INIT);
+            binaryUint(flowState->flowStateIndex);
+            binaryUint(i);
+            binaryAddr(pValue);
+            binaryValue(*pValue);
+        }
+	}
+}
+#endif
+
 void onFlowStateCreated(FlowState *flowState) {
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+    if (g_debuggerProtocol == DEBUGGER_PROTOCOL_BINARY) {
+        onFlowStateCreatedBinary(flowState);
+        return;
+    }
+#endif
+
     if (isSubscribedTo(MESSAGE_TO_DEBUGGER_FLOW_STATE_CREATED)) {
         char buffer[256];
 		snprintf(buffer, sizeof(buffer), "%d\t%d\t%d\t%d\t%d\n",
@@ -612,6 +1235,13 @@ void onFlowStateCreated(FlowState *flowState) {
 
 void onFlowStateDestroyed(FlowState *flowState) {
 	if (isSubscribedTo(MESSAGE_TO_DEBUGGER_FLOW_STATE_DESTROYED)) {
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+        if (g_debuggerProtocol == DEBUGGER_PROTOCOL_BINARY) {
+            binaryMessage(MESSAGE_TO_DEBUGGER_FLOW_STATE_DESTROYED);
+            binaryUint(flowState->flowStateIndex);
+            return;
+        }
+#endif
 		char buffer[256];
 		snprintf(buffer, sizeof(buffer), "%d\t%d\n",
 			MESSAGE_TO_DEBUGGER_FLOW_STATE_DESTROYED,
@@ -623,6 +1253,14 @@ void onFlowStateDestroyed(FlowState *flowState) {
 
 void onFlowStateTimelineChanged(FlowState *flowState) {
 	if (isSubscribedTo(MESSAGE_TO_DEBUGGER_FLOW_STATE_TIMELINE_CHANGED)) {
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+        if (g_debuggerProtocol == DEBUGGER_PROTOCOL_BINARY) {
+            binaryMessage(MESSAGE_TO_DEBUGGER_FLOW_STATE_TIMELINE_CHANGED);
+            binaryUint(flowState->flowStateIndex);
+            binaryBytes(&flowState->timelinePosition, sizeof(flowState->timelinePosition));
+            return;
+        }
+#endif
 		char buffer[256];
 		snprintf(buffer, sizeof(buffer), "%d\t%d\t%g\n",
 			MESSAGE_TO_DEBUGGER_FLOW_STATE_TIMELINE_CHANGED,
@@ -635,6 +1273,14 @@ void onFlowStateTimelineChanged(FlowState *flowState) {
 
 void onFlowError(FlowState *flowState, int componentIndex, const char *errorMessage) {
 	if (isSubscribedTo(MESSAGE_TO_DEBUGGER_FLOW_STATE_ERROR)) {
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+        if (g_debuggerProtocol == DEBUGGER_PROTOCOL_BINARY) {
+            binaryMessage(MESSAGE_TO_DEBUGGER_FLOW_STATE_ERROR);
+            binaryUint(flowState->flowStateIndex);
+            binaryInt(componentIndex);
+            binaryString(errorMessage);
+        } else {
+#endif
 		char buffer[256];
 		snprintf(buffer, sizeof(buffer), "%d\t%d\t%d\t",
 			MESSAGE_TO_DEBUGGER_FLOW_STATE_ERROR,
@@ -643,6 +1289,9 @@ void onFlowError(FlowState *flowState, int componentIndex, const char *errorMess
 		);
 		writeDebuggerBufferHook(buffer, strlen(buffer));
 		writeString(errorMessage);
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+        }
+#endif
 	}
 
     if (onFlowErrorHook) {
@@ -652,6 +1301,15 @@ void onFlowError(FlowState *flowState, int componentIndex, const char *errorMess
 
 void onComponentExecutionStateChanged(FlowState *flowState, int componentIndex) {
 	if (isSubscribedTo(MESSAGE_TO_DEBUGGER_COMPONENT_EXECUTION_STATE_CHANGED)) {
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+        if (g_debuggerProtocol == DEBUGGER_PROTOCOL_BINARY) {
+            binaryMessage(MESSAGE_TO_DEBUGGER_COMPONENT_EXECUTION_STATE_CHANGED);
+            binaryUint(flowState->flowStateIndex);
+            binaryInt(componentIndex);
+            binaryAddr(flowState->componenentExecutionStates[componentIndex]);
+            return;
+        }
+#endif
 		char buffer[256];
 		snprintf(buffer, sizeof(buffer), "%d\t%d\t%d\t%p\n",
 			MESSAGE_TO_DEBUGGER_COMPONENT_EXECUTION_STATE_CHANGED,
@@ -666,6 +1324,15 @@ void onComponentExecutionStateChanged(FlowState *flowState, int componentIndex)
 
 void onComponentAsyncStateChanged(FlowState *flowState, int componentIndex) {
 	if (isSubscribedTo(MESSAGE_TO_DEBUGGER_COMPONENT_ASYNC_STATE_CHANGED)) {
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+        if (g_debuggerProtocol == DEBUGGER_PROTOCOL_BINARY) {
+            binaryMessage(MESSAGE_TO_DEBUGGER_COMPONENT_ASYNC_STATE_CHANGED);
+            binaryUint(flowState->flowStateIndex);
+            binaryInt(componentIndex);
+            binaryByte(flowState->componenentAsyncStates[componentIndex] ? 1 : 0);
+            return;
+        }
+#endif
 		char buffer[256];
 		snprintf(buffer, sizeof(buffer), "%d\t%d\t%d\t%d\n",
 			MESSAGE_TO_DEBUGGER_COMPONENT_ASYNC_STATE_CHANGED,
@@ -712,12 +1379,31 @@ static void writeLogMessage(const char *str, size_t len) {
 	FLUSH_OUTPUT_BUFFER();
 }
 
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+static void binaryLog(LogItemType logItemType, FlowState *flowState, unsigned componentIndex, const char *prefix, const char *message, size_t messageLength) {
+    binaryMessage(MESSAGE_TO_DEBUGGER_LOG);
+    binaryUint(logItemType);
+    binaryUint(flowState->flowStateIndex);
+    binaryInt(componentIndex);
+    auto prefixLength = strlen(prefix);
+    binaryUint(prefixLength + messageLength);
+    binaryBytes(prefix, prefixLength);
+    binaryBytes(message, messageLength);
+}
+#endif
+
 void logInfo(FlowState *flowState, unsigned componentIndex, const char *message) {
 #if defined(EEZ_FOR_LVGL)
     LV_LOG_USER("EEZ-FLOW: %s", message);
 #endif
 
 	if (isSubscribedTo(MESSAGE_TO_DEBUGGER_LOG)) {
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+        if (g_debuggerProtocol == DEBUGGER_PROTOCOL_BINARY) {
+            binaryLog(LOG_ITEM_TYPE_INFO, flowState, componentIndex, "", message, strlen(message));
+            return;
+        }
+#endif
 		char buffer[256];
 		snprintf(buffer, sizeof(buffer), "%d\t%d\t%d\t%d\t",
 			MESSAGE_TO_DEBUGGER_LOG,
@@ -732,6 +1418,12 @@ void logInfo(FlowState *flowState, unsigned componentIndex, const char *message)
 
 void logScpiCommand(FlowState *flowState, unsigned componentIndex, const char *cmd) {
 	if (isSubscribedTo(MESSAGE_TO_DEBUGGER_LOG)) {
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+        if (g_debuggerProtocol == DEBUGGER_PROTOCOL_BINARY) {
+            binaryLog(LOG_ITEM_TYPE_SCPI, flowState, componentIndex, "SCPI COMMAND: ", cmd, strlen(cmd));
+            return;
+        }
+#endif
 		char buffer[256];
 		snprintf(buffer, sizeof(buffer), "%d\t%d\t%d\t%d\tSCPI COMMAND: ",
 			MESSAGE_TO_DEBUGGER_LOG,
@@ -746,6 +1438,12 @@ void logScpiCommand(FlowState *flowState, unsigned componentIndex, const char *c
 
 void logScpiQuery(FlowState *flowState, unsigned componentIndex, const char *query) {
 	if (isSubscribedTo(MESSAGE_TO_DEBUGGER_LOG)) {
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+        if (g_debuggerProtocol == DEBUGGER_PROTOCOL_BINARY) {
+            binaryLog(LOG_ITEM_TYPE_SCPI, flowState, componentIndex, "SCPI QUERY: ", query, strlen(query));
+            return;
+        }
+#endif
 		char buffer[256];
 		snprintf(buffer, sizeof(buffer), "%d\t%d\t%d\t%d\tSCPI QUERY: ",
 			MESSAGE_TO_DEBUGGER_LOG,
@@ -760,6 +1458,12 @@ void logScpiQuery(FlowState *flowState, unsigned componentIndex, const char *que
 
 void logScpiQueryResult(FlowState *flowState, unsigned componentIndex, const char *resultText, size_t resultTextLen) {
 	if (isSubscribedTo(MESSAGE_TO_DEBUGGER_LOG)) {
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+        if (g_debuggerProtocol == DEBUGGER_PROTOCOL_BINARY) {
+            binaryLog(LOG_ITEM_TYPE_SCPI, flowState, componentIndex, "SCPI QUERY RESULT: ", resultText, resultTextLen);
+            return;
+        }
+#endif
 		char buffer[256];
 		snprintf(buffer, sizeof(buffer) - 1, "%d\t%d\t%d\t%d\tSCPI QUERY RESULT: ",
 			MESSAGE_TO_DEBUGGER_LOG,
@@ -811,6 +1515,13 @@ void onPageChanged(int previousPageId, int activePageId, bool activePageIsFromSt
     }
 
 	if (isSubscribedTo(MESSAGE_TO_DEBUGGER_PAGE_CHANGED)) {
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+        if (g_debuggerProtocol == DEBUGGER_PROTOCOL_BINARY) {
+            binaryMessage(MESSAGE_TO_DEBUGGER_PAGE_CHANGED);
+            binaryInt(activePageId);
+            return;
+        }
+#endif
         char buffer[256];
         snprintf(buffer, sizeof(buffer), "%d\t%d\n",
             MESSAGE_TO_DEBUGGER_PAGE_CHANGED,
@@ -848,6 +1559,13 @@ void onPageChanged(int previousPageId, int activePageId, bool activePageIsFromSt
     }
 
 	if (isSubscribedTo(MESSAGE_TO_DEBUGGER_PAGE_CHANGED)) {
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+        if (g_debuggerProtocol == DEBUGGER_PROTOCOL_BINARY) {
+            binaryMessage(MESSAGE_TO_DEBUGGER_PAGE_CHANGED);
+            binaryInt(activePageId);
+            return;
+        }
+#endif
         char buffer[256];
         snprintf(buffer, sizeof(buffer), "%d\t%d\n",
             MESSAGE_TO_DEBUGGER_PAGE_CHANGED,
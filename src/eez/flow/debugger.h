@@ -12,6 +12,39 @@
 
 #include <eez/flow/private.h>
 
+// Compact binary protocol (varint encoded messages, batched per tick, array deltas).
+// It is used only if debugger requests it with MESSAGE_FROM_DEBUGGER_PROTOCOL,
+// otherwise text protocol is used. Disabled by default, it needs the debugger that supports it.
+#if !defined(EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL)
+#define EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL 0
+#endif
+
+#if EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+
+#if !defined(EEZ_FLOW_DEBUGGER_BINARY_OUTPUT_BUFFER_SIZE)
+#if defined(__EMSCRIPTEN__)
+#define EEZ_FLOW_DEBUGGER_BINARY_OUTPUT_BUFFER_SIZE (64 * 1024)
+#else
+#define EEZ_FLOW_DEBUGGER_BINARY_OUTPUT_BUFFER_SIZE 512
+#endif
+#endif
+
+// Number of arrays for which sent elements are kept so only changed elements are sent again
+#if !defined(EEZ_FLOW_DEBUGGER_MAX_TRACKED_ARRAYS)
+#define EEZ_FLOW_DEBUGGER_MAX_TRACKED_ARRAYS 8
+#endif
+
+// Larger arrays are always sent in full
+#if !defined(EEZ_FLOW_DEBUGGER_MAX_TRACKED_ARRAY_SIZE)
+#if defined(__EMSCRIPTEN__)
+#define EEZ_FLOW_DEBUGGER_MAX_TRACKED_ARRAY_SIZE 1000
+#else
+#define EEZ_FLOW_DEBUGGER_MAX_TRACKED_ARRAY_SIZE 64
+#endif
+#endif
+
+#endif // EEZ_FLOW_DEBUGGER_BINARY_PROTOCOL
+
 namespace eez {
 namespace flow {
 
@@ -32,6 +65,7 @@ void onAddToQueue(FlowState *flowState, int sourceComponentIndex, int sourceOutp
 void onRemoveFromQueue();
 
 void onValueChanged(const Value *pValue);
+void onDebuggerArrayValueFree(const ArrayValue *arrayValue);
 
 void onFlowStateCreated(FlowState *flowState);
 void onFlowStateDestroyed(FlowState *flowState);
@@ -52,6 +86,9 @@ void onPageChanged(int previousPageId, int activePageId, bool activePageIsFromSt
 
 void processDebuggerInput(char *buffer, uint32_t length);
 
+// Writes messages batched by the binary protocol, called at the end of every tick.
+void flushDebuggerOutput();
+
 
 
 } // flow
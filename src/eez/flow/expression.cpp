@@ -12,6 +12,7 @@
 #include <eez/conf-internal.h>
 
 #include <stdio.h>
+#include <string.h>
 
 #include <eez/flow/private.h>
 #include <eez/flow/operations.h>
@@ -26,7 +27,51 @@ namespace flow {
 
 EvalStack g_stack;
 
-static void evalExpression(FlowState *flowState, const uint8_t *instructions, int *numInstructionBytes) {
+static void pushArrayElement(const Value &arrayValue, const Value &elementIndexValue) {
+    if (arrayValue.getType() == VALUE_TYPE_UNDEFINED || arrayValue.getType() == VALUE_TYPE_NULL) {
+        g_stack.push(Value(0, VALUE_TYPE_UNDEFINED));
+    } else {
+        if (arrayValue.isArray()) {
+            auto array = arrayValue.getArray();
+
+            int err;
+            auto elementIndex = elementIndexValue.toInt32(&err);
+            if (!err) {
+                if (elementIndex >= 0 && elementIndex < (int)array->arraySize) {
+                    g_stack.push(Value::makeArrayElementRef(arrayValue, elementIndex, 0x132e0e2f));
+                } else {
+                    g_stack.push(Value::makeError());
+                    g_stack.setErrorMessage("Array element index out of bounds\n");
+                }
+            } else {
+                g_stack.push(Value::makeError());
+                g_stack.setErrorMessage("Integer value expected for array element index\n");
+            }
+        } else if (arrayValue.isBlob()) {
+            auto blobRef = arrayValue.getBlob();
+
+            int err;
+            auto elementIndex = elementIndexValue.toInt32(&err);
+            if (!err) {
+                if (elementIndex >= 0 && elementIndex < (int)blobRef->len) {
+                    g_stack.push(Value::makeArrayElementRef(arrayValue, elementIndex, 0x132e0e2f));
+                } else {
+                    g_stack.push(Value::makeError());
+                    g_stack.setErrorMessage("Blob element index out of bounds\n");
+                }
+            } else {
+                g_stack.push(Value::makeError());
+                g_stack.setErrorMessage("Integer value expected for blob element index\n");
+            }
+
+        } else {
+            g_stack.push(Value::makeError());
+            g_stack.setErrorMessage("Array value expected\n");
+        }
+    }
+}
+
+static void interpretExpression(FlowState *flowState, const uint8_t *instructions, int *numInstructionBytes) {
 	auto flowDefinition = flowState->flowDefinition;
 	auto flow = flowState->flow;
 
@@ -57,48 +102,7 @@ static void evalExpression(FlowState *flowState, const uint8_t *instructions, in
 		} else if (instructionType == EXPR_EVAL_INSTRUCTION_ARRAY_ELEMENT) {
 			auto elementIndexValue = g_stack.pop().getValue();
 			auto arrayValue = g_stack.pop().getValue();
-
-            if (arrayValue.getType() == VALUE_TYPE_UNDEFINED || arrayValue.getType() == VALUE_TYPE_NULL) {
-                g_stack.push(Value(0, VALUE_TYPE_UNDEFINED));
-            } else {
-                if (arrayValue.isArray()) {
-                    auto array = arrayValue.getArray();
-
-                    int err;
-                    auto elementIndex = elementIndexValue.toInt32(&err);
-                    if (!err) {
-                        if (elementIndex >= 0 && elementIndex < (int)array->arraySize) {
-                            g_stack.push(Value::makeArrayElementRef(arrayValue, elementIndex, 0x132e0e2f));
-                        } else {
-                            g_stack.push(Value::makeError());
-                            g_stack.setErrorMessage("Array element index out of bounds\n");
-                        }
-                    } else {
-                        g_stack.push(Value::makeError());
-                        g_stack.setErrorMessage("Integer value expected for array element index\n");
-                    }
-                } else if (arrayValue.isBlob()) {
-                    auto blobRef = arrayValue.getBlob();
-
-                    int err;
-                    auto elementIndex = elementIndexValue.toInt32(&err);
-                    if (!err) {
-                        if (elementIndex >= 0 && elementIndex < (int)blobRef->len) {
-                            g_stack.push(Value::makeArrayElementRef(arrayValue, elementIndex, 0x132e0e2f));
-                        } else {
-                            g_stack.push(Value::makeError());
-                            g_stack.setErrorMessage("Blob element index out of bounds\n");
-                        }
-                    } else {
-                        g_stack.push(Value::makeError());
-                        g_stack.setErrorMessage("Integer value expected for blob element index\n");
-                    }
-
-                } else {
-                    g_stack.push(Value::makeError());
-                    g_stack.setErrorMessage("Array value expected\n");
-                }
-            }
+            pushArrayElement(arrayValue, elementIndexValue);
 		} else if (instructionType == EXPR_EVAL_INSTRUCTION_TYPE_OPERATION) {
 			g_evalOperations[instructionArg](g_stack);
 		} else {
@@ -133,6 +137,447 @@ static void evalExpression(FlowState *flowState, const uint8_t *instructions, in
 	}
 }
 
+#if EEZ_FLOW_EVAL_COMPILE_EXPRESSIONS
+
+////////////////////////////////////////////////////////////////////////////////
+// Compiled expressions
+//
+// On first evaluation the instruction stream is decoded once into an array of
+// CompiledInstruction's. Each one holds the pointer to its handler and already resolved
+// arguments (constant and variable pointers, input indexes, operation functions), so the
+// evaluation is just a loop of indirect calls. Some common instruction sequences are fused
+// into a single instruction and operations on constants are evaluated at compile time.
+
+struct CompiledInstruction;
+typedef void (*CompiledInstructionHandler)(const CompiledInstruction &instruction);
+
+struct CompiledInstruction {
+    CompiledInstructionHandler handler;
+    union {
+        const Value *value;
+        Value *variable;
+        uint32_t index;
+    };
+    union {
+        EvalOperation operation;
+        const Value *indexValue;
+        uint32_t dstValueType;
+    };
+};
+
+struct CompiledExpression {
+    uint32_t numInstructionBytes;
+    uint32_t numFoldedValues;
+    Value *foldedValues;
+    CompiledInstruction *instructions; // terminated with null handler
+};
+
+static bool g_compiledExpressionsEnabled = true;
+
+static void doPushValue(const CompiledInstruction &instruction) {
+    g_stack.push(*instruction.value);
+}
+
+static void doPushInput(const CompiledInstruction &instruction) {
+    g_stack.push(g_stack.flowState->values[instruction.index]);
+}
+
+static void doPushLocalVar(const CompiledInstruction &instruction) {
+    g_stack.push(&g_stack.flowState->values[instruction.index]);
+}
+
+static void doPushGlobalVar(const CompiledInstruction &instruction) {
+    g_stack.push(instruction.variable);
+}
+
+static void doPushNativeVar(const CompiledInstruction &instruction) {
+    g_stack.push(Value((int)instruction.index, VALUE_TYPE_NATIVE_VARIABLE));
+}
+
+static void doPushOutput(const CompiledInstruction &instruction) {
+    g_stack.push(Value((uint16_t)instruction.index, VALUE_TYPE_FLOW_OUTPUT));
+}
+
+static void doArrayElement(const CompiledInstruction &instruction) {
+    EEZ_UNUSED(instruction);
+    auto elementIndexValue = g_stack.pop().getValue();
+    auto arrayValue = g_stack.pop().getValue();
+    pushArrayElement(arrayValue, elementIndexValue);
+}
+
+static void doOperation(const CompiledInstruction &instruction) {
+    instruction.operation(g_stack);
+}
+
+// PUSH_INPUT + OPERATION
+static void doPushInputAndOperation(const CompiledInstruction &instruction) {
+    g_stack.push(g_stack.flowState->values[instruction.index]);
+    instruction.operation(g_stack);
+}
+
+// PUSH_CONSTANT + OPERATION
+static void doPushValueAndOperation(const CompiledInstruction &instruction) {
+    g_stack.push(*instruction.value);
+    instruction.operation(g_stack);
+}
+
+// PUSH_GLOBAL_VAR + PUSH_CONSTANT + ARRAY_ELEMENT
+static void doGlobalVarArrayElement(const CompiledInstruction &instruction) {
+    pushArrayElement(Value(instruction.variable, VALUE_TYPE_VALUE_PTR).getValue(), instruction.indexValue->getValue());
+}
+
+static void doEndWithDstValueType(const CompiledInstruction &instruction) {
+    if (g_stack.sp == 1) {
+        auto finalResult = g_stack.pop();
+
+        if (finalResult.getType() == VALUE_TYPE_VALUE_PTR) {
+            finalResult.dstValueType = instruction.dstValueType;
+        } else if (finalResult.getType() == VALUE_TYPE_ARRAY_ELEMENT_VALUE) {
+            auto arrayElementValue = (ArrayElementValue *)finalResult.refValue;
+            arrayElementValue->dstValueType = instruction.dstValueType;
+        }
+
+        g_stack.push(finalResult);
+    }
+}
+
+// Returns number of operands if operation result depends only on its operands, otherwise 0.
+static int getFoldableOperationArity(uint16_t operation) {
+    using namespace defs_v3;
+
+    if (operation <= OPERATION_TYPE_LOGICAL_OR) {
+        return 2;
+    }
+
+    if (operation >= OPERATION_TYPE_UNARY_PLUS && operation <= OPERATION_TYPE_NOT) {
+        return 1;
+    }
+
+    if (operation == OPERATION_TYPE_CONDITIONAL) {
+        return 3;
+    }
+
+    if (operation >= OPERATION_TYPE_MATH_SIN && operation <= OPERATION_TYPE_MATH_CEIL) {
+        return 1;
+    }
+
+    if (operation == OPERATION_TYPE_MATH_POW) {
+        return 2;
+    }
+
+    return 0;
+}
+
+static CompiledInstruction g_compileInstructions[EEZ_FLOW_EVAL_MAX_COMPILED_INSTRUCTIONS + 1];
+static Value g_compileFoldedValues[EEZ_FLOW_EVAL_MAX_COMPILED_INSTRUCTIONS];
+
+static bool isFoldedValue(const Value *value) {
+    return value >= g_compileFoldedValues && value < g_compileFoldedValues + EEZ_FLOW_EVAL_MAX_COMPILED_INSTRUCTIONS;
+}
+
+static bool foldOperation(int arity, uint16_t operation, unsigned &numInstructions, unsigned &numFoldedValues) {
+    for (int i = 1; i <= arity; i++) {
+        if (g_compileInstructions[numInstructions - i].handler != doPushValue) {
+            return false;
+        }
+    }
+
+    size_t savedSp = g_stack.sp;
+    const char *savedErrorMessage = g_stack.errorMessage;
+
+    for (int i = arity; i > 0; i--) {
+        g_stack.push(*g_compileInstructions[numInstructions - i].value);
+    }
+
+    g_evalOperations[operation](g_stack);
+
+    bool folded = false;
+    if (g_stack.sp == savedSp + 1) {
+        auto result = g_stack.pop();
+        if (!result.isError() && result.getType() != VALUE_TYPE_VALUE_PTR && result.getType() != VALUE_TYPE_ARRAY_ELEMENT_VALUE) {
+            g_compileFoldedValues[numFoldedValues] = result;
+
+            numInstructions -= arity;
+            auto &instruction = g_compileInstructions[numInstructions++];
+            instruction.handler = doPushValue;
+            instruction.value = &g_compileFoldedValues[numFoldedValues++];
+
+            folded = true;
+        }
+    }
+
+    g_stack.sp = savedSp;
+    g_stack.errorMessage = savedErrorMessage;
+
+    return folded;
+}
+
+static CompiledExpression *compileExpression(FlowState *flowState, const uint8_t *instructions) {
+	auto flowDefinition = flowState->flowDefinition;
+	auto flow = flowState->flow;
+
+    unsigned numInstructions = 0;
+    unsigned numFoldedValues = 0;
+
+	int i = 0;
+	while (true) {
+        if (numInstructions == EEZ_FLOW_EVAL_MAX_COMPILED_INSTRUCTIONS) {
+            // too long, it will be interpreted
+            for (unsigned j = 0; j < numFoldedValues; j++) {
+                g_compileFoldedValues[j] = Value();
+            }
+            return nullptr;
+        }
+
+		uint16_t instruction = instructions[i] + (instructions[i + 1] << 8);
+		auto instructionType = instruction & EXPR_EVAL_INSTRUCTION_TYPE_MASK;
+		auto instructionArg = instruction & EXPR_EVAL_INSTRUCTION_PARAM_MASK;
+
+        auto &compiledInstruction = g_compileInstructions[numInstructions];
+
+		if (instructionType == EXPR_EVAL_INSTRUCTION_TYPE_PUSH_CONSTANT) {
+            compiledInstruction.handler = doPushValue;
+            compiledInstruction.value = flowDefinition->constants[instructionArg];
+            numInstructions++;
+		} else if (instructionType == EXPR_EVAL_INSTRUCTION_TYPE_PUSH_INPUT) {
+            compiledInstruction.handler = doPushInput;
+            compiledInstruction.index = instructionArg;
+            numInstructions++;
+		} else if (instructionType == EXPR_EVAL_INSTRUCTION_TYPE_PUSH_LOCAL_VAR) {
+            compiledInstruction.handler = doPushLocalVar;
+            compiledInstruction.index = flow->componentInputs.count + instructionArg;
+            numInstructions++;
+		} else if (instructionType == EXPR_EVAL_INSTRUCTION_TYPE_PUSH_GLOBAL_VAR) {
+			if ((uint32_t)instructionArg < flowDefinition->globalVariables.count) {
+                compiledInstruction.handler = doPushGlobalVar;
+                compiledInstruction.variable = g_globalVariables ? g_globalVariables->values + instructionArg : flowDefinition->globalVariables[instructionArg];
+			} else {
+                compiledInstruction.handler = doPushNativeVar;
+                compiledInstruction.index = instructionArg - flowDefinition->globalVariables.count + 1;
+			}
+            numInstructions++;
+		} else if (instructionType == EXPR_EVAL_INSTRUCTION_TYPE_PUSH_OUTPUT) {
+            compiledInstruction.handler = doPushOutput;
+            compiledInstruction.index = instructionArg;
+            numInstructions++;
+		} else if (instructionType == EXPR_EVAL_INSTRUCTION_ARRAY_ELEMENT) {
+            if (
+                numInstructions >= 2 &&
+                g_compileInstructions[numInstructions - 2].handler == doPushGlobalVar &&
+                g_compileInstructions[numInstructions - 1].handler == doPushValue
+            ) {
+                auto &fusedInstruction = g_compileInstructions[numInstructions - 2];
+                fusedInstruction.handler = doGlobalVarArrayElement;
+                fusedInstruction.indexValue = g_compileInstructions[numInstructions - 1].value;
+                numInstructions--;
+            } else {
+                compiledInstruction.handler = doArrayElement;
+                numInstructions++;
+            }
+		} else if (instructionType == EXPR_EVAL_INSTRUCTION_TYPE_OPERATION) {
+            auto arity = getFoldableOperationArity(instructionArg);
+            if (arity > 0 && numInstructions >= (unsigned)arity && foldOperation(arity, instructionArg, numInstructions, numFoldedValues)) {
+                // folded into constant
+            } else if (numInstructions > 0 && g_compileInstructions[numInstructions - 1].handler == doPushInput) {
+                auto &fusedInstruction = g_compileInstructions[numInstructions - 1];
+                fusedInstruction.handler = doPushInputAndOperation;
+                fusedInstruction.operation = g_evalOperations[instructionArg];
+            } else if (numInstructions > 0 && g_compileInstructions[numInstructions - 1].handler == doPushValue) {
+                auto &fusedInstruction = g_compileInstructions[numInstructions - 1];
+                fusedInstruction.handler = doPushValueAndOperation;
+                fusedInstruction.operation = g_evalOperations[instructionArg];
+            } else {
+                compiledInstruction.handler = doOperation;
+                compiledInstruction.operation = g_evalOperations[instructionArg];
+                numInstructions++;
+            }
+		} else {
+            if (instruction == EXPR_EVAL_INSTRUCTION_TYPE_END_WITH_DST_VALUE_TYPE) {
+    			i += 2;
+                compiledInstruction.handler = doEndWithDstValueType;
+                compiledInstruction.dstValueType = instructions[i] + (instructions[i + 1] << 8) + (instructions[i + 2] << 16) + (instructions[i + 3] << 24);
+                numInstructions++;
+                i += 4;
+                break;
+            } else {
+			    i += 2;
+			    break;
+            }
+		}
+
+		i += 2;
+	}
+
+    g_compileInstructions[numInstructions++].handler = nullptr;
+
+    auto headerSize = (sizeof(CompiledExpression) + 7) & ~7;
+    auto compiledExpression = (CompiledExpression *)alloc(
+        headerSize +
+        numFoldedValues * sizeof(Value) +
+        numInstructions * sizeof(CompiledInstruction),
+        0x3a7c9e12
+    );
+    if (!compiledExpression) {
+        for (unsigned j = 0; j < numFoldedValues; j++) {
+            g_compileFoldedValues[j] = Value();
+        }
+        return nullptr;
+    }
+
+    compiledExpression->numInstructionBytes = i;
+    compiledExpression->numFoldedValues = numFoldedValues;
+    compiledExpression->foldedValues = (Value *)((uint8_t *)compiledExpression + headerSize);
+    compiledExpression->instructions = (CompiledInstruction *)(compiledExpression->foldedValues + numFoldedValues);
+
+    for (unsigned j = 0; j < numFoldedValues; j++) {
+        new (compiledExpression->foldedValues + j) Value(g_compileFoldedValues[j]);
+        g_compileFoldedValues[j] = Value();
+    }
+
+    for (unsigned j = 0; j < numInstructions; j++) {
+        auto &compiledInstruction = compiledExpression->instructions[j];
+        compiledInstruction = g_compileInstructions[j];
+
+        // relocate folded values
+        if (compiledInstruction.handler == doPushValue || compiledInstruction.handler == doPushValueAndOperation) {
+            if (isFoldedValue(compiledInstruction.value)) {
+                compiledInstruction.value = compiledExpression->foldedValues + (compiledInstruction.value - g_compileFoldedValues);
+            }
+        } else if (compiledInstruction.handler == doGlobalVarArrayElement) {
+            if (isFoldedValue(compiledInstruction.indexValue)) {
+                compiledInstruction.indexValue = compiledExpression->foldedValues + (compiledInstruction.indexValue - g_compileFoldedValues);
+            }
+        }
+    }
+
+    return compiledExpression;
+}
+
+static void runCompiledExpression(const CompiledExpression *compiledExpression) {
+    for (auto instruction = compiledExpression->instructions; instruction->handler; instruction++) {
+        instruction->handler(*instruction);
+    }
+}
+
+// Compiled expressions are cached in open addressing hash table with instructions pointer as a key.
+// Entry with null compiledExpression is for the expression that can't be compiled.
+struct CompiledExpressionsEntry {
+    const uint8_t *instructions;
+    CompiledExpression *compiledExpression;
+};
+
+static const uint32_t COMPILED_EXPRESSIONS_INITIAL_CAPACITY = 256;
+
+static CompiledExpressionsEntry *g_compiledExpressions;
+static uint32_t g_compiledExpressionsCapacity;
+static uint32_t g_numCompiledExpressions;
+
+static inline uint32_t getCompiledExpressionsHash(const uint8_t *instructions) {
+    return (uint32_t)(((uintptr_t)instructions >> 1) * 2654435761u);
+}
+
+static CompiledExpressionsEntry *findCompiledExpressionsEntry(CompiledExpressionsEntry *entries, uint32_t capacity, const uint8_t *instructions) {
+    auto mask = capacity - 1;
+    for (auto i = getCompiledExpressionsHash(instructions) & mask; ; i = (i + 1) & mask) {
+        if (entries[i].instructions == instructions || !entries[i].instructions) {
+            return entries + i;
+        }
+    }
+}
+
+static bool growCompiledExpressions() {
+    auto capacity = g_compiledExpressionsCapacity ? 2 * g_compiledExpressionsCapacity : COMPILED_EXPRESSIONS_INITIAL_CAPACITY;
+
+    auto entries = (CompiledExpressionsEntry *)alloc(capacity * sizeof(CompiledExpressionsEntry), 0x91d4a6e0);
+    if (!entries) {
+        return false;
+    }
+    memset(entries, 0, capacity * sizeof(CompiledExpressionsEntry));
+
+    for (uint32_t i = 0; i < g_compiledExpressionsCapacity; i++) {
+        if (g_compiledExpressions[i].instructions) {
+            *findCompiledExpressionsEntry(entries, capacity, g_compiledExpressions[i].instructions) = g_compiledExpressions[i];
+        }
+    }
+
+    eez::free(g_compiledExpressions);
+
+    g_compiledExpressions = entries;
+    g_compiledExpressionsCapacity = capacity;
+
+    return true;
+}
+
+static CompiledExpression *getCompiledExpression(FlowState *flowState, const uint8_t *instructions) {
+    if (g_compiledExpressions) {
+        auto entry = findCompiledExpressionsEntry(g_compiledExpressions, g_compiledExpressionsCapacity, instructions);
+        if (entry->instructions) {
+            return entry->compiledExpression;
+        }
+    }
+
+    if (2 * (g_numCompiledExpressions + 1) > g_compiledExpressionsCapacity && !growCompiledExpressions()) {
+        return nullptr;
+    }
+
+    auto entry = findCompiledExpressionsEntry(g_compiledExpressions, g_compiledExpressionsCapacity, instructions);
+    entry->instructions = instructions;
+    entry->compiledExpression = compileExpression(flowState, instructions);
+    g_numCompiledExpressions++;
+
+    return entry->compiledExpression;
+}
+
+void resetCompiledExpressions() {
+    for (uint32_t i = 0; i < g_compiledExpressionsCapacity; i++) {
+        auto compiledExpression = g_compiledExpressions[i].compiledExpression;
+        if (compiledExpression) {
+            for (uint32_t j = 0; j < compiledExpression->numFoldedValues; j++) {
+                (compiledExpression->foldedValues + j)->~Value();
+            }
+            eez::free(compiledExpression);
+        }
+    }
+
+    eez::free(g_compiledExpressions);
+
+    g_compiledExpressions = nullptr;
+    g_compiledExpressionsCapacity = 0;
+    g_numCompiledExpressions = 0;
+}
+
+void enableCompiledExpressions(bool enable) {
+    g_compiledExpressionsEnabled = enable;
+}
+
+#else
+
+void resetCompiledExpressions() {
+}
+
+void enableCompiledExpressions(bool enable) {
+    EEZ_UNUSED(enable);
+}
+
+#endif // EEZ_FLOW_EVAL_COMPILE_EXPRESSIONS
+
+static void evalExpression(FlowState *flowState, const uint8_t *instructions, int *numInstructionBytes) {
+#if EEZ_FLOW_EVAL_COMPILE_EXPRESSIONS
+    if (g_compiledExpressionsEnabled) {
+        auto compiledExpression = getCompiledExpression(flowState, instructions);
+        if (compiledExpression) {
+            runCompiledExpression(compiledExpression);
+            if (numInstructionBytes) {
+                *numInstructionBytes = compiledExpression->numInstructionBytes;
+            }
+            return;
+        }
+    }
+#endif
+
+    interpretExpression(flowState, instructions, numInstructionBytes);
+}
+
 #if EEZ_OPTION_GUI
 bool evalExpression(FlowState *flowState, int componentIndex, const uint8_t *instructions, Value &result, const FlowError &errorMessage, int *numInstructionBytes, const int32_t *iterators, DataOperationEnum operation) {
 #else
@@ -26,6 +26,17 @@ namespace flow {
 
 static const size_t STACK_SIZE = EEZ_FLOW_EVAL_STACK_SIZE;
 
+// Set to 1 to compile expression instructions on first use instead of always interpreting them.
+// Costs static RAM for the compile buffers and heap for each compiled expression.
+#if !defined(EEZ_FLOW_EVAL_COMPILE_EXPRESSIONS)
+#define EEZ_FLOW_EVAL_COMPILE_EXPRESSIONS 0
+#endif
+
+// Expressions with more instructions than this are not compiled
+#if !defined(EEZ_FLOW_EVAL_MAX_COMPILED_INSTRUCTIONS)
+#define EEZ_FLOW_EVAL_MAX_COMPILED_INSTRUCTIONS 128
+#endif
+
 struct EvalStack {
 	FlowState *flowState;
 	int componentIndex;
@@ -57,7 +68,11 @@ struct EvalStack {
         if (sp == 0) {
             return Value::makeError();
         }
-		return stack[--sp];
+		Value value = stack[--sp];
+        // release stack slot reference, so popped value can be the only owner
+        // (see copy-on-write array operations)
+        stack[sp] = Value();
+		return value;
 	}
 
     void setErrorMessage(const char *str) {
@@ -79,5 +94,11 @@ bool evalProperty(FlowState *flowState, int componentIndex, int propertyIndex, V
 #endif
 bool evalAssignableProperty(FlowState *flowState, int componentIndex, int propertyIndex, Value &result, const FlowError &errorMessage, int *numInstructionBytes = nullptr, const int32_t *iterators = nullptr);
 
+// Compiled expressions are cached until flow is stopped or started again,
+// or external assets, which hold instructions of the cached expressions, are unloaded.
+// If disabled, all expressions are evaluated by the interpreter.
+void enableCompiledExpressions(bool enable);
+void resetCompiledExpressions();
+
 } // flow
 } // eez
@@ -24,7 +24,9 @@
 #include <eez/flow/hooks.h>
 #include <eez/flow/components/lvgl_user_widget.h>
 #include <eez/flow/watch_list.h>
+#include <eez/flow/timers.h>
 #include <eez/flow/expression.h>
+#include <eez/flow/profiler.h>
 
 #if EEZ_OPTION_GUI
 #include <eez/gui/gui.h>
@@ -52,6 +54,11 @@ static const uint32_t FLOW_TICK_MAX_DURATION_MS = EEZ_FLOW_TICK_MAX_DURATION_MS;
 
 static unsigned g_tick_max_duration_count = 0;
 
+#if EEZ_FLOW_SCHEDULER
+static uint32_t g_schedulerTickBudget = EEZ_FLOW_SCHEDULER_TICK_BUDGET_US;
+static SchedulerStats g_schedulerStats;
+#endif
+
 int g_selectedLanguage = 0;
 FlowState *g_firstFlowState;
 FlowState *g_lastFlowState;
@@ -74,8 +81,17 @@ unsigned start(Assets *assets) {
 
     initGlobalVariables(assets);
 
+#if EEZ_FLOW_PROFILER
+    profilerReset();
+#endif
+#if EEZ_FLOW_SCHEDULER
+    resetSchedulerStats();
+#endif
+
 	queueReset();
     watchListReset();
+    timersReset();
+    resetCompiledExpressions();
 
 	scpiComponentInitHook();
 
@@ -84,23 +100,74 @@ unsigned start(Assets *assets) {
 	return 1;
 }
 
-void tick() {
+static inline void executeTask(FlowState *flowState, unsigned componentIndex) {
+#if EEZ_FLOW_PROFILER
+    auto flowIndex = flowState->flowIndex;
+    auto componentType = flowState->flow->components[componentIndex]->type;
+    auto startTime = micros();
+    executeComponent(flowState, componentIndex);
+    profilerComponentExecuted(flowIndex, componentType, micros() - startTime);
+#else
+    executeComponent(flowState, componentIndex);
+#endif
+}
+
+static uint32_t getNextTickDelay() {
+    if (getQueueSize() > 0 || hasWatchesEvaluatedOnEveryTick()) {
+        return 0;
+    }
+
+    uint32_t delay = getMQTTEventsTickDelay();
+
+    uint32_t deadline;
+    if (getNextTimerDeadline(deadline)) {
+        uint32_t time = millis();
+        uint32_t timerDelay = isDeadlineReached(deadline, time) ? 0 : deadline - time;
+        if (timerDelay < delay) {
+            delay = timerDelay;
+        }
+    }
+
+    return delay;
+}
+
+uint32_t tick() {
 	if (isFlowStopped()) {
-		return;
+		return TICK_NO_DEADLINE;
 	}
 
     if (g_isStopping) {
         doStop();
-        return;
+        return TICK_NO_DEADLINE;
     }
 
 	uint32_t startTickCount = millis();
+    bool overBudget = false;
+#if EEZ_FLOW_SCHEDULER
+    uint32_t startTickTime = micros();
+#endif
+
+#if EEZ_FLOW_PROFILER
+    profilerTickBegin();
+#endif
 
     visitWatchList();
+    visitTimers();
+    drainMQTTEvents();
 
     auto queueSizeAtTickStart = getQueueSize();
 
+#if EEZ_FLOW_PROFILER
+    profilerWatchListEnd(queueSizeAtTickStart);
+#endif
+
+#if EEZ_FLOW_SCHEDULER
+    // queue decides which task is next (see QueueLane), continuous tasks are executed at most once
+    queueTickBegin();
+    for (size_t i = 0; ; i++) {
+#else
     for (size_t i = 0; i < queueSizeAtTickStart || g_numNonContinuousTaskInQueue > 0; i++) {
+#endif
 		FlowState *flowState;
 		unsigned componentIndex;
         bool continuousTask;
@@ -125,13 +192,17 @@ void tick() {
             deallocateComponentExecutionState(flowState, componentIndex);
         } else {
             if (continuousTask) {
+#if EEZ_FLOW_SCHEDULER
+                executeTask(flowState, componentIndex);
+#else
                 if (i < queueSizeAtTickStart) {
-                    executeComponent(flowState, componentIndex);
+                    executeTask(flowState, componentIndex);
                 } else {
                     addToQueue(flowState, componentIndex, -1, -1, -1, true);
                 }
+#endif
             } else {
-                executeComponent(flowState, componentIndex);
+                executeTask(flowState, componentIndex);
             }
         }
 
@@ -145,14 +216,50 @@ void tick() {
             freeFlowState(flowState);
         }
 
+#if EEZ_FLOW_SCHEDULER
+        if (micros() - startTickTime >= g_schedulerTickBudget) {
+            overBudget = true;
+            break;
+        }
+#else
         if ((i + 1) % 5 == 0) {
             if (millis() - startTickCount >= FLOW_TICK_MAX_DURATION_MS) {
                 g_tick_max_duration_count++;
+                overBudget = true;
                 break;
             }
         }
+#endif
 	}
 
+#if EEZ_FLOW_SCHEDULER
+    // remaining tasks are carried over to the next tick
+    bool isWorkLeft = queueTickEnd();
+    overBudget = overBudget && isWorkLeft;
+
+    uint32_t tickDuration = micros() - startTickTime;
+    uint32_t utilisation = (uint32_t)((uint64_t)tickDuration * 1000 / (g_schedulerTickBudget > 0 ? g_schedulerTickBudget : 1));
+    g_schedulerStats.tickBudget = g_schedulerTickBudget;
+    g_schedulerStats.lastTickDuration = tickDuration;
+    g_schedulerStats.lastUtilisation = utilisation;
+    g_schedulerStats.averageUtilisation = (7 * g_schedulerStats.averageUtilisation + utilisation) / 8;
+    if (utilisation > g_schedulerStats.maxUtilisation) {
+        g_schedulerStats.maxUtilisation = utilisation;
+    }
+    g_schedulerStats.numTicks++;
+    if (overBudget) {
+        g_tick_max_duration_count++;
+        g_schedulerStats.numTicksOverBudget++;
+    }
+    g_schedulerStats.numCarriedOverTasks = getQueueSize();
+    for (int lane = 0; lane < NUM_QUEUE_LANES; lane++) {
+        g_schedulerStats.laneSizes[lane] = getQueueLaneSize(lane);
+    }
+    EEZ_UNUSED(startTickCount);
+    EEZ_UNUSED(queueSizeAtTickStart);
+#endif
+
+	flushDebuggerOutput();
 	finishToDebuggerMessageHook();
 
     // delete flow states marked with deleteOnNextTick
@@ -161,6 +268,14 @@ void tick() {
             freeFlowState(flowState);
         }
     }
+
+#if EEZ_FLOW_PROFILER
+    profilerTickEnd(overBudget);
+#else
+    EEZ_UNUSED(overBudget);
+#endif
+
+    return getNextTickDelay();
 }
 
 void stop() {
@@ -169,6 +284,7 @@ void stop() {
 
 void doStop() {
     onStopped();
+    flushDebuggerOutput();
     finishToDebuggerMessageHook();
     g_debuggerIsConnected = false;
 
@@ -180,6 +296,8 @@ void doStop() {
 
 	queueReset();
     watchListReset();
+    timersReset();
+    resetCompiledExpressions();
 }
 
 bool isFlowStopped() {
@@ -190,6 +308,22 @@ unsigned getTickMaxDurationCounter() {
     return g_tick_max_duration_count;
 }
 
+#if EEZ_FLOW_SCHEDULER
+
+void setSchedulerTickBudget(uint32_t tickBudget) {
+    g_schedulerTickBudget = tickBudget;
+}
+
+void getSchedulerStats(SchedulerStats &stats) {
+    stats = g_schedulerStats;
+}
+
+void resetSchedulerStats() {
+    memset(&g_schedulerStats, 0, sizeof(g_schedulerStats));
+}
+
+#endif
+
 #if EEZ_OPTION_GUI
 
 FlowState *getPageFlowState(Assets *assets, int16_t pageIndex, const WidgetCursor &widgetCursor) {
@@ -297,9 +431,18 @@ void setGlobalVariable(Assets *assets, uint32_t globalVariableIndex, const Value
         } else {
             *assets->flowDefinition->globalVariables[globalVariableIndex] = value;
         }
+        markGlobalVariableChanged(globalVariableIndex);
     }
 }
 
+void notifyGlobalVariableChanged(uint32_t globalVariableIndex) {
+    markGlobalVariableChanged(globalVariableIndex);
+}
+
+void notifyNativeVariableChanged(int nativeVariableId) {
+    markNativeVariableChanged(nativeVariableId);
+}
+
 Value getUserProperty(unsigned propertyIndex) {
     Value value;
     evalProperty(g_executeActionFlowState, g_executeActionComponentIndex, propertyIndex, value, FlowError::PropertyNum("CallAction", propertyIndex));
@@ -402,6 +545,9 @@ void executeFlowAction(const WidgetCursor &widgetCursor, int16_t actionId, void
 
 void dataOperation(int16_t dataId, DataOperationEnum operation, const WidgetCursor &widgetCursor, Value &value) {
 	if (isFlowStopped()) {
+#if EEZ_OPTION_GUI_SUBTREE_SKIPPING
+		g_widgetDataDependencies |= DATA_DEPENDS_ON_EVERYTHING;
+#endif
 		return;
 	}
 
@@ -415,6 +561,12 @@ void dataOperation(int16_t dataId, DataOperationEnum operation, const WidgetCurs
 		WidgetDataItem *widgetDataItem = flow->widgetDataItems[flowDataId];
 		auto component = flow->components[widgetDataItem->componentIndex];
 
+#if EEZ_OPTION_GUI_SUBTREE_SKIPPING
+		if (widgetDataItem->componentIndex != -1 && widgetDataItem->propertyValueIndex != -1) {
+			g_widgetDataDependencies |= getExpressionDependencies(flowState, component->properties[widgetDataItem->propertyValueIndex]->evalInstructions);
+		}
+#endif
+
 		if (operation == DATA_OPERATION_GET) {
 			getValue(flowDataId, operation, widgetCursor, value);
 			if (component->type == WIDGET_TYPE_INPUT && dataId == widgetCursor.widget->data) {
@@ -539,6 +691,7 @@ void dataOperation(int16_t dataId, DataOperationEnum operation, const WidgetCurs
                     }
                     array->values[defs_v3::SYSTEM_STRUCTURE_SCROLLBAR_STATE_FIELD_POSITION] = newPosition;
                     onValueChanged(&array->values[defs_v3::SYSTEM_STRUCTURE_SCROLLBAR_STATE_FIELD_POSITION]);
+                    markValueChanged(flowState, &array->values[defs_v3::SYSTEM_STRUCTURE_SCROLLBAR_STATE_FIELD_POSITION]);
                 } else {
                     value = 0;
                 }
@@ -570,6 +723,8 @@ void dataOperation(int16_t dataId, DataOperationEnum operation, const WidgetCurs
 #endif // EEZ_OPTION_GUI
 
 void onArrayValueFree(ArrayValue *arrayValue) {
+    onDebuggerArrayValueFree(arrayValue);
+
 #if defined(EEZ_DASHBOARD_API)
     if (g_dashboardValueFree) {
         return;
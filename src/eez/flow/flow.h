@@ -11,6 +11,7 @@
 #pragma once
 
 #include <eez/core/assets.h>
+#include <eez/flow/queue.h>
 
 #if EEZ_OPTION_GUI
 #include <eez/gui/gui.h>
@@ -27,12 +28,37 @@ extern uint32_t g_wasmModuleId;
 struct FlowState;
 
 unsigned start(Assets *assets);
-void tick();
+
+static const uint32_t TICK_NO_DEADLINE = 0xFFFFFFFF;
+
+// Returns the number of milliseconds the host can wait before the next tick if nothing else
+// happens in the meantime: 0 if there is work left, time until the first Delay, Animate, etc.
+// deadline or TICK_NO_DEADLINE if the flow is waiting only for the external events.
+uint32_t tick();
 void stop();
 
 bool isFlowStopped();
 unsigned getTickMaxDurationCounter();
 
+#if EEZ_FLOW_SCHEDULER
+struct SchedulerStats {
+    uint32_t tickBudget; // us
+    uint32_t numTicks;
+    uint32_t numTicksOverBudget; // ticks that ended with budget exhausted and tasks left to execute
+    uint32_t lastTickDuration; // us
+    // budget utilisation in 1/1000 of the budget, can be above 1000 if component overruns the budget
+    uint32_t lastUtilisation;
+    uint32_t averageUtilisation; // exponential moving average
+    uint32_t maxUtilisation;
+    uint32_t numCarriedOverTasks; // tasks left in the queue at the end of the last tick
+    uint32_t laneSizes[NUM_QUEUE_LANES];
+};
+
+void setSchedulerTickBudget(uint32_t tickBudget);
+void getSchedulerStats(SchedulerStats &stats);
+void resetSchedulerStats();
+#endif
+
 #if EEZ_OPTION_GUI
 FlowState *getPageFlowState(Assets *assets, int16_t pageIndex, const WidgetCursor &widgetCursor);
 #else
@@ -47,6 +73,12 @@ Value getGlobalVariable(Assets *assets, uint32_t globalVariableIndex);
 void setGlobalVariable(uint32_t globalVariableIndex, const Value &value);
 void setGlobalVariable(Assets *assets, uint32_t globalVariableIndex, const Value &value);
 
+// Call this if the content of the global variable (array element, struct member) has been
+// modified directly, i.e. not through setGlobalVariable, so that WatchVariable components are notified.
+void notifyGlobalVariableChanged(uint32_t globalVariableIndex);
+// Call this when native variable value is changed if EEZ_FLOW_NATIVE_VARIABLES_CHANGE_NOTIFY is enabled.
+void notifyNativeVariableChanged(int nativeVariableId);
+
 Value getUserProperty(unsigned propertyIndex);
 void setUserProperty(unsigned propertyIndex, const Value &value);
 
@@ -79,6 +111,8 @@ void onDebuggerClientDisconnected();
 
 void onArrayValueFree(ArrayValue *arrayValue);
 void onFreeMQTTConnection(ArrayValue *mqttConnectionValue);
+void drainMQTTEvents();
+uint32_t getMQTTEventsTickDelay();
 
 void executeScpi();
 void flushToDebuggerMessage();
@@ -17,11 +17,14 @@
 #include <eez/core/os.h>
 #include <eez/core/action.h>
 #include <eez/core/util.h>
+#include <eez/core/name_index.h>
 
 #include <eez/flow/flow.h>
 #include <eez/flow/expression.h>
 #include <eez/flow/hooks.h>
 #include <eez/flow/debugger.h>
+#include <eez/flow/watch_list.h>
+#include <eez/flow/timers.h>
 #include <eez/flow/components.h>
 #include <eez/flow/flow_defs_v3.h>
 #include <eez/flow/components/lvgl_user_widget.h>
@@ -34,20 +37,27 @@ extern "C" void tick_screen(int screen_index);
 
 static const char **g_screenNames;
 static size_t g_numScreens;
+static eez::NameIndex g_screenNameIndex;
 
 static lv_obj_t **g_objects;
 static const char **g_objectNames;
 static size_t g_numObjects;
+static size_t g_numObjectNames;
+static eez::NameIndex g_objectNameIndex;
 
 static lv_group_t **g_groups;
 static const char **g_groupNames;
 static size_t g_numGroups;
+static size_t g_numGroupNames;
+static eez::NameIndex g_groupNameIndex;
 
 static const char **g_styleNames;
 static size_t g_numStyles;
+static eez::NameIndex g_styleNameIndex;
 
 static const ext_img_desc_t *g_images;
 static size_t g_numImages;
+static eez::NameIndex g_imageNameIndex;
 
 static ActionExecFunc *g_actions;
 
@@ -75,43 +85,45 @@ static lv_group_t *getLvglGroupFromIndex(int32_t index) {
     return 0;
 }
 
-static int32_t getLvglScreenByName(const char *name) {
-    for (size_t i = 0; i < g_numScreens; i++) {
-        if (strcmp(g_screenNames[i], name) == 0) {
-            return i + 1;
+// Index of the name in the names table, hash index is used if it was built when table has been installed
+static int32_t findName(const eez::NameIndex &nameIndex, const char **names, size_t numNames, const char *name) {
+    if (nameIndex.isBuilt()) {
+        return nameIndex.find(name, [names](uint32_t i) { return names[i]; });
+    }
+    for (size_t i = 0; i < numNames; i++) {
+        if (strcmp(names[i], name) == 0) {
+            return i;
         }
     }
     return -1;
 }
 
+static void buildNameIndex(eez::NameIndex &nameIndex, const char **names, size_t numNames) {
+    nameIndex.build(numNames, [names](uint32_t i) { return names[i]; });
+}
+
+static int32_t getLvglScreenByName(const char *name) {
+    int32_t i = findName(g_screenNameIndex, g_screenNames, g_numScreens, name);
+    return i != -1 ? i + 1 : -1;
+}
+
 static int32_t getLvglObjectByName(const char *name) {
-    for (size_t i = 0; i < g_numObjects; i++) {
-        if (strcmp(g_objectNames[i], name) == 0) {
-            return i;
-        }
-    }
-    return -1;
+    return findName(g_objectNameIndex, g_objectNames, g_numObjectNames, name);
 }
 
 static int32_t getLvglGroupByName(const char *name) {
-    for (size_t i = 0; i < g_numGroups; i++) {
-        if (strcmp(g_groupNames[i], name) == 0) {
-            return i;
-        }
-    }
-    return -1;
+    return findName(g_groupNameIndex, g_groupNames, g_numGroupNames, name);
 }
 
 static int32_t getLvglStyleByName(const char *name) {
-    for (size_t i = 0; i < g_numStyles; i++) {
-        if (strcmp(g_styleNames[i], name) == 0) {
-            return i;
-        }
-    }
-    return -1;
+    return findName(g_styleNameIndex, g_styleNames, g_numStyles, name);
 }
 
 static const void *getLvglImageByName(const char *name) {
+    if (g_imageNameIndex.isBuilt()) {
+        int32_t i = g_imageNameIndex.find(name, [](uint32_t i) { return g_images[i].name; });
+        return i != -1 ? g_images[i].img_dsc : 0;
+    }
     for (size_t i = 0; i < g_numImages; i++) {
         if (strcmp(g_images[i].name, name) == 0) {
             return g_images[i].img_dsc;
@@ -169,9 +181,12 @@ static bool isScreenCreated(int screenIndex) {
     return eez::flow::getLvglObjectFromIndexHook(screenIndex) != 0;
 }
 
+static void invalidatePropertyBindings();
+
 static void createScreen(int screenIndex) {
     if (g_createScreenFunc && !isScreenCreated(screenIndex)) {
         g_createScreenFunc(screenIndex);
+        invalidatePropertyBindings();
     }
 }
 
@@ -251,6 +266,8 @@ extern "C" void eez_flow_init(const uint8_t *assets, uint32_t assetsSize, lv_obj
     eez::initOtherMemory();
     eez::initAllocHeap(eez::ALLOC_BUFFER, eez::ALLOC_BUFFER_SIZE);
 
+    g_imageNameIndex.build(g_numImages, [](uint32_t i) { return g_images[i].name; });
+
     eez::flow::replacePageHook = replacePageHook;
     eez::flow::getLvglObjectFromIndexHook = getLvglObjectFromIndex;
     eez::flow::getLvglScreenByNameHook = getLvglScreenByName;
@@ -284,32 +301,40 @@ void eez_flow_init_groups(lv_group_t **groups, size_t numGroups) {
 void eez_flow_init_screen_names(const char **screenNames, size_t numScreens) {
     g_screenNames = screenNames;
     g_numScreens = numScreens;
+    buildNameIndex(g_screenNameIndex, screenNames, numScreens);
 }
 
 void eez_flow_init_object_names(const char **objectNames, size_t numObjects) {
     g_objectNames = objectNames;
-    EEZ_UNUSED(numObjects);
+    g_numObjectNames = numObjects;
+    buildNameIndex(g_objectNameIndex, objectNames, numObjects);
 }
 
 void eez_flow_init_group_names(const char **groupNames, size_t numGroups) {
     g_groupNames = groupNames;
-    EEZ_UNUSED(numGroups);
+    g_numGroupNames = numGroups;
+    buildNameIndex(g_groupNameIndex, groupNames, numGroups);
 }
 
 void eez_flow_init_style_names(const char **styleNames, size_t numStyles) {
     g_styleNames = styleNames;
     g_numStyles = numStyles;
+    buildNameIndex(g_styleNameIndex, styleNames, numStyles);
 }
 
 
-extern "C" void eez_flow_tick() {
-    eez::flow::tick();
+extern "C" uint32_t eez_flow_tick() {
+    return eez::flow::tick();
 }
 
 extern "C" bool eez_flow_is_stopped() {
     return eez::flow::isFlowStopped();
 }
 
+extern "C" void eez_flow_native_variable_changed(int nativeVariableId) {
+    eez::flow::notifyNativeVariableChanged(nativeVariableId);
+}
+
 namespace eez {
 ActionExecFunc g_actionExecFunctions[] = { 0 };
 }
@@ -411,6 +436,10 @@ extern "C" void flowPropagateValueLVGLEvent(void *flowState, unsigned componentI
     }
 }
 
+extern "C" bool flowWakeUpComponent(void *flowState, unsigned componentIndex) {
+    return eez::flow::wakeUpComponent((eez::flow::FlowState *)flowState, componentIndex);
+}
+
 #ifndef EEZ_LVGL_TEMP_STRING_BUFFER_SIZE
 #define EEZ_LVGL_TEMP_STRING_BUFFER_SIZE 1024
 #endif
@@ -426,17 +455,62 @@ extern "C" const char *_evalTextProperty(void *flowState, unsigned componentInde
     return textValue;
 }
 
-extern "C" int32_t _evalIntegerProperty(void *flowState, unsigned componentIndex, unsigned propertyIndex, const char *errorMessage, const char *file, int line) {
-    eez::Value value;
-    if (!eez::flow::evalProperty((eez::flow::FlowState *)flowState, componentIndex, propertyIndex, value, eez::flow::FlowError::Plain(errorMessage, file, line))) {
-        return 0;
+static bool toInt32Property(void *flowState, unsigned componentIndex, const eez::Value &value, const char *errorMessage, int32_t &intValue) {
+    int err;
+    intValue = value.toInt32(&err);
+    if (err) {
+        eez::flow::throwError((eez::flow::FlowState *)flowState, componentIndex, errorMessage);
+        intValue = 0;
+        return false;
     }
+    return true;
+}
+
+static bool toBooleanProperty(void *flowState, unsigned componentIndex, const eez::Value &value, const char *errorMessage, bool &booleanValue) {
     int err;
-    int32_t intValue = value.toInt32(&err);
+    booleanValue = value.toBool(&err);
     if (err) {
         eez::flow::throwError((eez::flow::FlowState *)flowState, componentIndex, errorMessage);
+        booleanValue = false;
+        return false;
+    }
+    return true;
+}
+
+static const char *joinStringArray(const eez::Value &value, const char *separator) {
+    if (value.isArray()) {
+        auto array = value.getArray();
+
+        textValue[0] = 0;
+        size_t textPosition = 0;
+
+        size_t separatorLength = strlen(separator);
+
+        for (uint32_t elementIndex = 0; elementIndex < array->arraySize; elementIndex++) {
+            if (elementIndex > 0) {
+                eez::stringAppendString(textValue + textPosition, sizeof(textValue) - textPosition, separator);
+                textPosition += separatorLength;
+            }
+            array->values[elementIndex].toText(textValue + textPosition, sizeof(textValue) - textPosition);
+            textPosition = strlen(textValue);
+        }
+
+        return textValue;
+    } else if (value.isString()) {
+        value.toText(textValue, sizeof(textValue));
+        return textValue;
+    }
+
+    return "";
+}
+
+extern "C" int32_t _evalIntegerProperty(void *flowState, unsigned componentIndex, unsigned propertyIndex, const char *errorMessage, const char *file, int line) {
+    eez::Value value;
+    if (!eez::flow::evalProperty((eez::flow::FlowState *)flowState, componentIndex, propertyIndex, value, eez::flow::FlowError::Plain(errorMessage, file, line))) {
         return 0;
     }
+    int32_t intValue;
+    toInt32Property(flowState, componentIndex, value, errorMessage, intValue);
     return intValue;
 }
 
@@ -445,13 +519,9 @@ extern "C" uint32_t _evalUnsignedIntegerProperty(void *flowState, unsigned compo
     if (!eez::flow::evalProperty((eez::flow::FlowState *)flowState, componentIndex, propertyIndex, value, eez::flow::FlowError::Plain(errorMessage, file, line))) {
         return 0;
     }
-    int err;
-    uint32_t intValue = (uint32_t)value.toInt32(&err);
-    if (err) {
-        eez::flow::throwError((eez::flow::FlowState *)flowState, componentIndex, errorMessage);
-        return 0;
-    }
-    return intValue;
+    int32_t intValue;
+    toInt32Property(flowState, componentIndex, value, errorMessage, intValue);
+    return (uint32_t)intValue;
 }
 
 
@@ -460,12 +530,8 @@ extern "C" bool _evalBooleanProperty(void *flowState, unsigned componentIndex, u
     if (!eez::flow::evalProperty((eez::flow::FlowState *)flowState, componentIndex, propertyIndex, value, eez::flow::FlowError::Plain(errorMessage, file, line))) {
         return 0;
     }
-    int err;
-    bool booleanValue = value.toBool(&err);
-    if (err) {
-        eez::flow::throwError((eez::flow::FlowState *)flowState, componentIndex, errorMessage);
-        return 0;
-    }
+    bool booleanValue;
+    toBooleanProperty(flowState, componentIndex, value, errorMessage, booleanValue);
     return booleanValue;
 }
 
@@ -474,31 +540,207 @@ const char *_evalStringArrayPropertyAndJoin(void *flowState, unsigned componentI
     if (!eez::flow::evalProperty((eez::flow::FlowState *)flowState, componentIndex, propertyIndex, value, eez::flow::FlowError::Plain(errorMessage, file, line))) {
         return "";
     }
+    return joinStringArray(value, separator);
+}
 
-    if (value.isArray()) {
-        auto array = value.getArray();
+////////////////////////////////////////////////////////////////////////////////
 
-        textValue[0] = 0;
-        size_t textPosition = 0;
+#ifndef EEZ_LVGL_PROPERTY_BINDINGS_HASH_SIZE
+#define EEZ_LVGL_PROPERTY_BINDINGS_HASH_SIZE 64
+#endif
 
-        size_t separatorLength = strlen(separator);
+// Last value of the property returned by the _evalXxxPropertyIfChanged functions
+struct PropertyBinding {
+    eez::flow::FlowState *flowState;
+    unsigned componentIndex;
+    unsigned propertyIndex;
 
-        for (uint32_t elementIndex = 0; elementIndex < array->arraySize; elementIndex++) {
-            if (elementIndex > 0) {
-                eez::stringAppendString(textValue + textPosition, sizeof(textValue) - textPosition, separator);
-                textPosition += separatorLength;
+    // which data is read by the property expression
+    uint8_t dependencies;
+    // data change version at the time of the last evaluation
+    uint32_t version;
+    // g_propertyBindingsGeneration at the time of the last evaluation, 0 if value is not valid
+    uint32_t generation;
+
+    eez::Value value;
+
+    PropertyBinding *next;
+};
+
+static PropertyBinding *g_propertyBindings[EEZ_LVGL_PROPERTY_BINDINGS_HASH_SIZE];
+
+// incremented when screen is created, new LVGL objects must get all the values again
+static uint32_t g_propertyBindingsGeneration = 1;
+
+static void invalidatePropertyBindings() {
+    if (++g_propertyBindingsGeneration == 0) {
+        g_propertyBindingsGeneration = 1;
+    }
+}
+
+static inline uint32_t getPropertyBindingHash(eez::flow::FlowState *flowState, unsigned componentIndex, unsigned propertyIndex) {
+    uint32_t hash = (uint32_t)((uintptr_t)flowState >> 3) * 2654435761u;
+    hash ^= componentIndex * 31 + propertyIndex;
+    return hash % EEZ_LVGL_PROPERTY_BINDINGS_HASH_SIZE;
+}
+
+static PropertyBinding *getPropertyBinding(eez::flow::FlowState *flowState, unsigned componentIndex, unsigned propertyIndex) {
+    auto &first = g_propertyBindings[getPropertyBindingHash(flowState, componentIndex, propertyIndex)];
+
+    for (auto binding = first; binding; binding = binding->next) {
+        if (binding->flowState == flowState && binding->componentIndex == componentIndex && binding->propertyIndex == propertyIndex) {
+            return binding;
+        }
+    }
+
+    auto binding = eez::ObjectAllocator<PropertyBinding>::allocate(0x5c2e9a17);
+    if (!binding) {
+        return nullptr;
+    }
+
+    binding->flowState = flowState;
+    binding->componentIndex = componentIndex;
+    binding->propertyIndex = propertyIndex;
+
+    auto component = flowState->flow->components[componentIndex];
+    if (propertyIndex < component->properties.count) {
+        binding->dependencies = eez::flow::getExpressionDependencies(flowState, component->properties[propertyIndex]->evalInstructions);
+    } else {
+        binding->dependencies = eez::flow::DATA_DEPENDS_ON_EVERYTHING;
+    }
+
+    binding->version = 0;
+    binding->generation = 0;
+
+    binding->next = first;
+    first = binding;
+
+    return binding;
+}
+
+namespace eez {
+namespace flow {
+
+void removePropertyBindingsForFlowState(FlowState *flowState) {
+    for (unsigned i = 0; i < EEZ_LVGL_PROPERTY_BINDINGS_HASH_SIZE; i++) {
+        for (auto pBinding = &g_propertyBindings[i]; *pBinding; ) {
+            auto binding = *pBinding;
+            if (binding->flowState == flowState) {
+                *pBinding = binding->next;
+                binding->~PropertyBinding();
+                eez::free(binding);
+            } else {
+                pBinding = &binding->next;
             }
-            array->values[elementIndex].toText(textValue + textPosition, sizeof(textValue) - textPosition);
-            textPosition = strlen(textValue);
         }
+    }
+}
 
-        return textValue;
-    } else if (value.isString()) {
-        value.toText(textValue, sizeof(textValue));
-        return textValue;
+} // flow
+} // eez
+
+enum PropertyBindingResult {
+    PROPERTY_BINDING_UNCHANGED,
+    PROPERTY_BINDING_CHANGED,
+    PROPERTY_BINDING_ERROR
+};
+
+// Evaluates the property only if some data it reads has been changed and
+// reports the change only if the new value differs from the last one.
+static PropertyBindingResult evalPropertyIfChanged(void *flowState, unsigned componentIndex, unsigned propertyIndex, eez::Value &value, const char *errorMessage, const char *file, int line) {
+    auto binding = getPropertyBinding((eez::flow::FlowState *)flowState, componentIndex, propertyIndex);
+    if (!binding) {
+        // out of memory, evaluate every time as without the binding
+        if (!eez::flow::evalProperty((eez::flow::FlowState *)flowState, componentIndex, propertyIndex, value, eez::flow::FlowError::Plain(errorMessage, file, line))) {
+            return PROPERTY_BINDING_ERROR;
+        }
+        return PROPERTY_BINDING_CHANGED;
     }
 
-    return "";
+    bool valid = binding->generation == g_propertyBindingsGeneration;
+    if (valid && !eez::flow::isDataChangedSince(binding->dependencies, binding->version)) {
+        return PROPERTY_BINDING_UNCHANGED;
+    }
+
+    binding->version = eez::flow::getDataChangeVersion();
+
+    if (!eez::flow::evalProperty((eez::flow::FlowState *)flowState, componentIndex, propertyIndex, value, eez::flow::FlowError::Plain(errorMessage, file, line))) {
+        binding->generation = 0;
+        binding->value = eez::Value();
+        return PROPERTY_BINDING_ERROR;
+    }
+
+    // arrays are compared by reference, element could be changed in place
+    if (valid && !value.isArray() && binding->value == value) {
+        return PROPERTY_BINDING_UNCHANGED;
+    }
+
+    binding->generation = g_propertyBindingsGeneration;
+    binding->value = value;
+
+    return PROPERTY_BINDING_CHANGED;
+}
+
+extern "C" const char *_evalTextPropertyIfChanged(void *flowState, unsigned componentIndex, unsigned propertyIndex, const char *errorMessage, const char *file, int line) {
+    eez::Value value;
+    auto result = evalPropertyIfChanged(flowState, componentIndex, propertyIndex, value, errorMessage, file, line);
+    if (result == PROPERTY_BINDING_UNCHANGED) {
+        return nullptr;
+    }
+    if (result == PROPERTY_BINDING_ERROR) {
+        return "";
+    }
+    value.toText(textValue, sizeof(textValue));
+    return textValue;
+}
+
+extern "C" bool _evalIntegerPropertyIfChanged(void *flowState, unsigned componentIndex, unsigned propertyIndex, int32_t *intValue, const char *errorMessage, const char *file, int line) {
+    eez::Value value;
+    auto result = evalPropertyIfChanged(flowState, componentIndex, propertyIndex, value, errorMessage, file, line);
+    if (result == PROPERTY_BINDING_UNCHANGED) {
+        return false;
+    }
+    if (result == PROPERTY_BINDING_ERROR) {
+        *intValue = 0;
+        return true;
+    }
+    toInt32Property(flowState, componentIndex, value, errorMessage, *intValue);
+    return true;
+}
+
+extern "C" bool _evalUnsignedIntegerPropertyIfChanged(void *flowState, unsigned componentIndex, unsigned propertyIndex, uint32_t *unsignedValue, const char *errorMessage, const char *file, int line) {
+    int32_t intValue;
+    if (!_evalIntegerPropertyIfChanged(flowState, componentIndex, propertyIndex, &intValue, errorMessage, file, line)) {
+        return false;
+    }
+    *unsignedValue = (uint32_t)intValue;
+    return true;
+}
+
+extern "C" bool _evalBooleanPropertyIfChanged(void *flowState, unsigned componentIndex, unsigned propertyIndex, bool *booleanValue, const char *errorMessage, const char *file, int line) {
+    eez::Value value;
+    auto result = evalPropertyIfChanged(flowState, componentIndex, propertyIndex, value, errorMessage, file, line);
+    if (result == PROPERTY_BINDING_UNCHANGED) {
+        return false;
+    }
+    if (result == PROPERTY_BINDING_ERROR) {
+        *booleanValue = false;
+        return true;
+    }
+    toBooleanProperty(flowState, componentIndex, value, errorMessage, *booleanValue);
+    return true;
+}
+
+const char *_evalStringArrayPropertyAndJoinIfChanged(void *flowState, unsigned componentIndex, unsigned propertyIndex, const char *errorMessage, const char *separator, const char *file, int line) {
+    eez::Value value;
+    auto result = evalPropertyIfChanged(flowState, componentIndex, propertyIndex, value, errorMessage, file, line);
+    if (result == PROPERTY_BINDING_UNCHANGED) {
+        return nullptr;
+    }
+    if (result == PROPERTY_BINDING_ERROR) {
+        return "";
+    }
+    return joinStringArray(value, separator);
 }
 
 extern "C" void _assignStringProperty(void *flowState, unsigned componentIndex, unsigned propertyIndex, const char *value, const char *errorMessage, const char *file, int line) {
@@ -70,10 +70,18 @@ void eez_flow_init_themes(const char **themeNames, size_t numThemes, void (*chan
 void eez_flow_set_create_screen_func(void (*createScreenFunc)(int screenIndex));
 void eez_flow_set_delete_screen_func(void (*deleteScreenFunc)(int screenIndex));
 
-void eez_flow_tick();
+#define EEZ_FLOW_TICK_NO_DEADLINE 0xFFFFFFFF
+
+// Returns the number of milliseconds the host can sleep before the next tick if nothing else
+// happens in the meantime: 0 if there is work left, time until the first Delay, Animate, etc.
+// deadline or EEZ_FLOW_TICK_NO_DEADLINE if the flow is waiting only for the external events.
+uint32_t eez_flow_tick();
 
 bool eez_flow_is_stopped();
 
+// notify the flow engine that native variable has been changed (see EEZ_FLOW_NATIVE_VARIABLES_CHANGE_NOTIFY)
+void eez_flow_native_variable_changed(int nativeVariableId);
+
 extern int16_t g_currentScreen;
 
 int16_t eez_flow_get_current_screen();
@@ -98,12 +106,24 @@ void flowPropagateValueInt32(void *flowState, unsigned componentIndex, unsigned
 void flowPropagateValueUint32(void *flowState, unsigned componentIndex, unsigned outputIndex, uint32_t value);
 void flowPropagateValueLVGLEvent(void *flowState, unsigned componentIndex, unsigned outputIndex, lv_event_t *event);
 
+// Component sleeping until its deadline (e.g. Delay) is executed in the next tick instead.
+// Returns false if component is not sleeping.
+bool flowWakeUpComponent(void *flowState, unsigned componentIndex);
+
 #define evalTextProperty(flowState, componentIndex, propertyIndex, errorMessage) _evalTextProperty(flowState, componentIndex, propertyIndex, errorMessage, __FILE__, __LINE__)
 #define evalIntegerProperty(flowState, componentIndex, propertyIndex, errorMessage) _evalIntegerProperty(flowState, componentIndex, propertyIndex, errorMessage, __FILE__, __LINE__)
 #define evalUnsignedIntegerProperty(flowState, componentIndex, propertyIndex, errorMessage) _evalUnsignedIntegerProperty(flowState, componentIndex, propertyIndex, errorMessage, __FILE__, __LINE__)
 #define evalBooleanProperty(flowState, componentIndex, propertyIndex, errorMessage) _evalBooleanProperty(flowState, componentIndex, propertyIndex, errorMessage, __FILE__, __LINE__)
 #define evalStringArrayPropertyAndJoin(flowState, componentIndex, propertyIndex, errorMessage, separator) _evalStringArrayPropertyAndJoin(flowState, componentIndex, propertyIndex, errorMessage, separator, __FILE__, __LINE__)
 
+// Same as above, but returns nullptr / false if the property value is not changed since the last call for
+// the same (flowState, componentIndex, propertyIndex), so tick_screen can skip LVGL calls for that property.
+#define evalTextPropertyIfChanged(flowState, componentIndex, propertyIndex, errorMessage) _evalTextPropertyIfChanged(flowState, componentIndex, propertyIndex, errorMessage, __FILE__, __LINE__)
+#define evalIntegerPropertyIfChanged(flowState, componentIndex, propertyIndex, pValue, errorMessage) _evalIntegerPropertyIfChanged(flowState, componentIndex, propertyIndex, pValue, errorMessage, __FILE__, __LINE__)
+#define evalUnsignedIntegerPropertyIfChanged(flowState, componentIndex, propertyIndex, pValue, errorMessage) _evalUnsignedIntegerPropertyIfChanged(flowState, componentIndex, propertyIndex, pValue, errorMessage, __FILE__, __LINE__)
+#define evalBooleanPropertyIfChanged(flowState, componentIndex, propertyIndex, pValue, errorMessage) _evalBooleanPropertyIfChanged(flowState, componentIndex, propertyIndex, pValue, errorMessage, __FILE__, __LINE__)
+#define evalStringArrayPropertyAndJoinIfChanged(flowState, componentIndex, propertyIndex, errorMessage, separator) _evalStringArrayPropertyAndJoinIfChanged(flowState, componentIndex, propertyIndex, errorMessage, separator, __FILE__, __LINE__)
+
 #define assignStringProperty(flowState, componentIndex, propertyIndex, value, errorMessage) _assignStringProperty(flowState, componentIndex, propertyIndex, value, errorMessage, __FILE__, __LINE__)
 #define assignIntegerProperty(flowState, componentIndex, propertyIndex, value, errorMessage) _assignIntegerProperty(flowState, componentIndex, propertyIndex, value, errorMessage, __FILE__, __LINE__)
 #define assignBooleanProperty(flowState, componentIndex, propertyIndex, value, errorMessage) _assignBooleanProperty(flowState, componentIndex, propertyIndex, value, errorMessage, __FILE__, __LINE__) 
@@ -115,6 +135,12 @@ uint32_t _evalUnsignedIntegerProperty(void *flowState, unsigned componentIndex,
 bool _evalBooleanProperty(void *flowState, unsigned componentIndex, unsigned propertyIndex, const char *errorMessage, const char *file, int line);
 const char *_evalStringArrayPropertyAndJoin(void *flowState, unsigned componentIndex, unsigned propertyIndex, const char *errorMessage, const char *separator, const char *file, int line);
 
+const char *_evalTextPropertyIfChanged(void *flowState, unsigned componentIndex, unsigned propertyIndex, const char *errorMessage, const char *file, int line);
+bool _evalIntegerPropertyIfChanged(void *flowState, unsigned componentIndex, unsigned propertyIndex, int32_t *value, const char *errorMessage, const char *file, int line);
+bool _evalUnsignedIntegerPropertyIfChanged(void *flowState, unsigned componentIndex, unsigned propertyIndex, uint32_t *value, const char *errorMessage, const char *file, int line);
+bool _evalBooleanPropertyIfChanged(void *flowState, unsigned componentIndex, unsigned propertyIndex, bool *value, const char *errorMessage, const char *file, int line);
+const char *_evalStringArrayPropertyAndJoinIfChanged(void *flowState, unsigned componentIndex, unsigned propertyIndex, const char *errorMessage, const char *separator, const char *file, int line);
+
 void _assignStringProperty(void *flowState, unsigned componentIndex, unsigned propertyIndex, const char *value, const char *errorMessage, const char *file, int line);
 void _assignIntegerProperty(void *flowState, unsigned componentIndex, unsigned propertyIndex, int32_t value, const char *errorMessage, const char *file, int line);
 void _assignBooleanProperty(void *flowState, unsigned componentIndex, unsigned propertyIndex, bool value, const char *errorMessage, const char *file, int line);
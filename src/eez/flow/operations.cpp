@@ -2408,6 +2408,40 @@ static void do_OPERATION_TYPE_ARRAY_ALLOCATE(EvalStack &stack) {
     stack.push(resultArrayValue);
 }
 
+// Returns array value, with the same elements as arrayValue, that can be modified in place
+// and has room for at least newSize elements. Array is modified in place only if nobody else
+// holds a reference to it, otherwise it is copied (copy-on-write). When array must be reallocated
+// capacity grows geometrically, so appending to an unshared array is amortized O(1).
+static Value getWritableArray(const Value &arrayValue, uint32_t newSize, uint32_t id) {
+    auto array = arrayValue.getArray();
+
+    bool isUnshared = arrayValue.type == VALUE_TYPE_ARRAY_REF && arrayValue.refValue->refCounter == 1;
+    if (isUnshared && getArrayRefCapacity((ArrayValueRef *)arrayValue.refValue) >= newSize) {
+        return arrayValue;
+    }
+
+    uint32_t capacity = newSize;
+    if (isUnshared) {
+        capacity = array->arraySize + array->arraySize / 2;
+        if (capacity < 4) {
+            capacity = 4;
+        }
+        if (capacity < newSize) {
+            capacity = newSize;
+        }
+    }
+
+    auto resultArrayValue = Value::makeArrayRef(array->arraySize, array->arrayType, id, capacity);
+    if (resultArrayValue.isArray()) {
+        auto resultArray = resultArrayValue.getArray();
+        for (uint32_t elementIndex = 0; elementIndex < array->arraySize; elementIndex++) {
+            resultArray->values[elementIndex] = array->values[elementIndex];
+        }
+    }
+
+    return resultArrayValue;
+}
+
 static void do_OPERATION_TYPE_ARRAY_APPEND(EvalStack &stack) {
     auto arrayValue = stack.pop().getValue();
     if (arrayValue.isError()) {
@@ -2432,15 +2466,14 @@ static void do_OPERATION_TYPE_ARRAY_APPEND(EvalStack &stack) {
         return;
     }
 
-    auto array = arrayValue.getArray();
-    auto resultArrayValue = Value::makeArrayRef(array->arraySize + 1, array->arrayType, 0x664c3199);
-    auto resultArray = resultArrayValue.getArray();
-
-    for (uint32_t elementIndex = 0; elementIndex < array->arraySize; elementIndex++) {
-        resultArray->values[elementIndex] = array->values[elementIndex];
+    auto resultArrayValue = getWritableArray(arrayValue, arrayValue.getArray()->arraySize + 1, 0x664c3199);
+    if (!resultArrayValue.isArray()) {
+        stack.push(Value::makeError());
+        return;
     }
+    auto resultArray = resultArrayValue.getArray();
 
-    resultArray->values[array->arraySize] = value;
+    resultArray->values[resultArray->arraySize++] = value;
 
     stack.push(resultArrayValue);
 }
@@ -2480,25 +2513,26 @@ static void do_OPERATION_TYPE_ARRAY_INSERT(EvalStack &stack) {
         return;
     }
 
-    auto array = arrayValue.getArray();
-    auto resultArrayValue = Value::makeArrayRef(array->arraySize + 1, array->arrayType, 0xc4fa9cd9);
+    auto resultArrayValue = getWritableArray(arrayValue, arrayValue.getArray()->arraySize + 1, 0xc4fa9cd9);
+    if (!resultArrayValue.isArray()) {
+        stack.push(Value::makeError());
+        return;
+    }
     auto resultArray = resultArrayValue.getArray();
 
     if (position < 0) {
         position = 0;
-    } else if ((uint32_t)position > array->arraySize) {
-        position = array->arraySize;
+    } else if ((uint32_t)position > resultArray->arraySize) {
+        position = resultArray->arraySize;
     }
 
-    for (uint32_t elementIndex = 0; (int)elementIndex < position; elementIndex++) {
-        resultArray->values[elementIndex] = array->values[elementIndex];
+    for (uint32_t elementIndex = resultArray->arraySize; (int)elementIndex > position; elementIndex--) {
+        resultArray->values[elementIndex] = resultArray->values[elementIndex - 1];
     }
 
     resultArray->values[position] = value;
 
-    for (uint32_t elementIndex = position; elementIndex < array->arraySize; elementIndex++) {
-        resultArray->values[elementIndex + 1] = array->values[elementIndex];
-    }
+    resultArray->arraySize++;
 
     stack.push(resultArrayValue);
 }
@@ -2537,6 +2571,18 @@ static void do_OPERATION_TYPE_ARRAY_REMOVE(EvalStack &stack) {
     auto array = arrayValue.getArray();
 
     if (position >= 0 && position < (int32_t)array->arraySize) {
+        if (arrayValue.type == VALUE_TYPE_ARRAY_REF && arrayValue.refValue->refCounter == 1) {
+            // not shared, remove in place
+            for (uint32_t elementIndex = position + 1; elementIndex < array->arraySize; elementIndex++) {
+                array->values[elementIndex - 1] = array->values[elementIndex];
+            }
+
+            array->values[--array->arraySize] = Value();
+
+            stack.push(arrayValue);
+            return;
+        }
+
         auto resultArrayValue = Value::makeArrayRef(array->arraySize - 1, array->arrayType, 0x40e9bb4b);
         auto resultArray = resultArrayValue.getArray();
 
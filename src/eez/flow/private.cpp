@@ -27,6 +27,7 @@ using namespace eez::gui;
 #include <eez/flow/flow_defs_v3.h>
 #include <eez/flow/hooks.h>
 #include <eez/flow/watch_list.h>
+#include <eez/flow/timers.h>
 #include <eez/flow/components/call_action.h>
 #include <eez/flow/components/on_event.h>
 
@@ -68,79 +69,119 @@ void initGlobalVariables(Assets *assets) {
         0xcc34ca8e
     );
 
+    g_globalVariables->count = numVars;
+
     for (uint32_t i = 0; i < numVars; i++) {
 		new (g_globalVariables->values + i) Value();
         g_globalVariables->values[i] = flowDefinition->globalVariables[i]->clone();
 	}
 }
 
-static bool isComponentReadyToRun(FlowState *flowState, unsigned componentIndex) {
-	auto component = flowState->flow->components[componentIndex];
+enum ReadyToRunRule {
+    READY_TO_RUN_NEVER,
+    READY_TO_RUN_ALWAYS,
+    READY_TO_RUN_IF_FLOW_INPUT_DEFINED,
+    READY_TO_RUN_IF_INPUTS_DEFINED
+};
 
+static uint8_t getReadyToRunRule(FlowState *flowState, Component *component) {
 	if (component->type == defs_v3::COMPONENT_TYPE_CATCH_ERROR_ACTION) {
-		return false;
+		return READY_TO_RUN_NEVER;
 	}
 
     if (component->type == defs_v3::COMPONENT_TYPE_ON_EVENT_ACTION) {
-        return false;
+        return READY_TO_RUN_NEVER;
     }
 
     if (component->type == defs_v3::COMPONENT_TYPE_LABEL_IN_ACTION) {
-        return false;
+        return READY_TO_RUN_NEVER;
     }
 
     if (component->type > defs_v3::FIRST_LVGL_WIDGET_COMPONENT_TYPE) {
-        return false;
+        return READY_TO_RUN_NEVER;
     }
 
     if ((component->type < defs_v3::COMPONENT_TYPE_START_ACTION && component->type != defs_v3::COMPONENT_TYPE_USER_WIDGET_WIDGET) || component->type >= defs_v3::FIRST_DASHBOARD_WIDGET_COMPONENT_TYPE) {
         // always execute widget
-        return true;
+        return READY_TO_RUN_ALWAYS;
     }
 
     if (component->type == defs_v3::COMPONENT_TYPE_START_ACTION) {
         if (flowState->parentComponent && flowState->parentComponentIndex != -1) {
-            auto flowInputIndex = flowState->parentComponent->inputs[0];
-            auto value = flowState->parentFlowState->values[flowInputIndex];
-            return value.getType() != VALUE_TYPE_UNDEFINED;
+            return READY_TO_RUN_IF_FLOW_INPUT_DEFINED;
         } else {
-            return true;
+            return READY_TO_RUN_ALWAYS;
         }
     }
 
-	// check if required inputs are defined:
-	//   - at least 1 seq input must be defined
-	//   - all non optional data inputs must be defined
-	int numSeqInputs = 0;
-	int numDefinedSeqInputs = 0;
+    return READY_TO_RUN_IF_INPUTS_DEFINED;
+}
+
+static void initComponentInputCounters(FlowState *flowState, unsigned componentIndex) {
+	auto component = flowState->flow->components[componentIndex];
+    auto &counters = flowState->componentInputCounters[componentIndex];
+
+    counters.readyToRunRule = getReadyToRunRule(flowState, component);
+    counters.numSeqInputs = 0;
+    counters.numDefinedSeqInputs = 0;
+    counters.numEmptyRequiredDataInputs = 0;
+
 	for (unsigned inputIndex = 0; inputIndex < component->inputs.count; inputIndex++) {
 		auto inputValueIndex = component->inputs[inputIndex];
 
 		auto input = flowState->flow->componentInputs[inputValueIndex];
 
 		if (input & COMPONENT_INPUT_FLAG_IS_SEQ_INPUT) {
-			numSeqInputs++;
-			auto &value = flowState->values[inputValueIndex];
-			if (!isInputEmpty(value)) {
-				numDefinedSeqInputs++;
+			counters.numSeqInputs++;
+			if (!isInputEmpty(flowState->values[inputValueIndex])) {
+				counters.numDefinedSeqInputs++;
 			}
-		} else {
-			if (!(input & COMPONENT_INPUT_FLAG_IS_OPTIONAL)) {
-				auto &value = flowState->values[inputValueIndex];
-				if (isInputEmpty(value)) {
-					// non optional data input is undefined
-					return false;
-				}
+		} else if (!(input & COMPONENT_INPUT_FLAG_IS_OPTIONAL)) {
+			if (isInputEmpty(flowState->values[inputValueIndex])) {
+				counters.numEmptyRequiredDataInputs++;
 			}
 		}
 	}
+}
 
-	if (numSeqInputs && !numDefinedSeqInputs) {
-		// no seq input is defined
-		return false;
-	}
+// Must be called every time input of the component changes from empty to non empty or vice versa
+static void updateComponentInputCounters(FlowState *flowState, unsigned componentIndex, unsigned inputValueIndex, bool isEmpty) {
+    auto &counters = flowState->componentInputCounters[componentIndex];
 
-	return true;
+    auto input = flowState->flow->componentInputs[inputValueIndex];
+
+    if (input & COMPONENT_INPUT_FLAG_IS_SEQ_INPUT) {
+        if (isEmpty) {
+            counters.numDefinedSeqInputs--;
+        } else {
+            counters.numDefinedSeqInputs++;
+        }
+    } else if (!(input & COMPONENT_INPUT_FLAG_IS_OPTIONAL)) {
+        if (isEmpty) {
+            counters.numEmptyRequiredDataInputs++;
+        } else {
+            counters.numEmptyRequiredDataInputs--;
+        }
+    }
+}
+
+static bool isComponentReadyToRun(FlowState *flowState, unsigned componentIndex) {
+    auto &counters = flowState->componentInputCounters[componentIndex];
+
+    if (counters.readyToRunRule == READY_TO_RUN_IF_INPUTS_DEFINED) {
+        // check if required inputs are defined:
+        //   - at least 1 seq input must be defined
+        //   - all non optional data inputs must be defined
+        return (counters.numSeqInputs == 0 || counters.numDefinedSeqInputs > 0) && counters.numEmptyRequiredDataInputs == 0;
+    }
+
+    if (counters.readyToRunRule == READY_TO_RUN_IF_FLOW_INPUT_DEFINED) {
+        auto flowInputIndex = flowState->parentComponent->inputs[0];
+        auto value = flowState->parentFlowState->values[flowInputIndex];
+        return value.getType() != VALUE_TYPE_UNDEFINED;
+    }
+
+    return counters.readyToRunRule == READY_TO_RUN_ALWAYS;
 }
 
 static bool pingComponent(FlowState *flowState, unsigned componentIndex, int sourceComponentIndex = -1, int sourceOutputIndex = -1, int targetInputIndex = -1) {
@@ -162,6 +203,8 @@ static FlowState *initFlowState(Assets *assets, int flowIndex, FlowState *parent
 			sizeof(FlowState) +
 			nValues * sizeof(Value) +
 			flow->components.count * sizeof(ComponenentExecutionState *) +
+			flow->components.count * sizeof(ComponentInputCounters) +
+			flow->components.count * sizeof(uint16_t) +
 			flow->components.count * sizeof(bool),
 			0x4c3b6ef5
 		)
@@ -221,7 +264,11 @@ static FlowState *initFlowState(Assets *assets, int flowIndex, FlowState *parent
 
 	flowState->values = (Value *)(flowState + 1);
 	flowState->componenentExecutionStates = (ComponenentExecutionState **)(flowState->values + nValues);
-    flowState->componenentAsyncStates = (bool *)(flowState->componenentExecutionStates + flow->components.count);
+    flowState->componentInputCounters = (ComponentInputCounters *)(flowState->componenentExecutionStates + flow->components.count);
+    flowState->numQueueTasksForComponent = (uint16_t *)(flowState->componentInputCounters + flow->components.count);
+    flowState->componenentAsyncStates = (bool *)(flowState->numQueueTasksForComponent + flow->components.count);
+
+    flowState->firstQueueTask = QUEUE_NO_TASK;
 
 	for (unsigned i = 0; i < nValues; i++) {
 		new (flowState->values + i) Value();
@@ -242,6 +289,8 @@ static FlowState *initFlowState(Assets *assets, int flowIndex, FlowState *parent
 	for (unsigned i = 0; i < flow->components.count; i++) {
 		flowState->componenentExecutionStates[i] = nullptr;
 		flowState->componenentAsyncStates[i] = false;
+		flowState->numQueueTasksForComponent[i] = 0;
+		initComponentInputCounters(flowState, i);
 	}
 
 	onFlowStateCreated(flowState);
@@ -342,6 +391,9 @@ void freeFlowState(FlowState *flowState) {
 
     removeTasksFromQueueForFlowState(flowState);
     removeWatchesForFlowState(flowState);
+#if defined(EEZ_FOR_LVGL)
+    removePropertyBindingsForFlowState(flowState);
+#endif
 
     freeAllChildrenFlowStates(flowState->firstChild);
 
@@ -369,6 +421,8 @@ void deallocateComponentExecutionState(FlowState *flowState, unsigned componentI
             decRefCounterForFlowState(flowState);
         }
 
+        removeTimer(flowState, componentIndex);
+
         flowState->componenentExecutionStates[componentIndex] = nullptr;
         onComponentExecutionStateChanged(flowState, componentIndex);
         ObjectAllocator<ComponenentExecutionState>::deallocate(executionState);
@@ -377,7 +431,8 @@ void deallocateComponentExecutionState(FlowState *flowState, unsigned componentI
 
 void resetSequenceInputs(FlowState *flowState) {
     if (flowState->executingComponentIndex != NO_COMPONENT_INDEX) {
-		auto component = flowState->flow->components[flowState->executingComponentIndex];
+        auto componentIndex = flowState->executingComponentIndex;
+		auto component = flowState->flow->components[componentIndex];
         flowState->executingComponentIndex = NO_COMPONENT_INDEX;
 
         if (component->type != defs_v3::COMPONENT_TYPE_OUTPUT_ACTION) {
@@ -387,6 +442,10 @@ void resetSequenceInputs(FlowState *flowState) {
                     auto pValue = &flowState->values[inputIndex];
                     if (!isInputEmpty(*pValue)) {
                         *pValue = getEmptyInputValue();
+                        updateComponentInputCounters(flowState, componentIndex, inputIndex, true);
+#if EEZ_FLOW_TRACK_INPUT_CHANGES
+                        markValueChanged(flowState, pValue);
+#endif
                         onValueChanged(pValue);
                     }
                 }
@@ -417,7 +476,14 @@ void propagateValue(FlowState *flowState, unsigned componentIndex, unsigned outp
 		auto pValue = &flowState->values[connection->targetInputIndex];
 
 		if (*pValue != value2) {
+			bool wasEmpty = isInputEmpty(*pValue);
 			*pValue = value2;
+			if (isInputEmpty(*pValue) != wasEmpty) {
+				updateComponentInputCounters(flowState, connection->targetComponentIndex, connection->targetInputIndex, !wasEmpty);
+			}
+#if EEZ_FLOW_TRACK_INPUT_CHANGES
+			markValueChanged(flowState, pValue);
+#endif
 
 			//if (!(flowState->flow->componentInputs[connection->targetInputIndex] & COMPONENT_INPUT_FLAG_IS_SEQ_INPUT)) {
 				onValueChanged(pValue);
@@ -489,6 +555,7 @@ void assignValue(FlowState *flowState, int componentIndex, Value &dstValue, cons
 #else
 		setVar(dstValue.getInt(), srcValue);
 #endif
+        markNativeVariableChanged(dstValue.getInt());
 	} else {
 		Value *pDstValue;
         uint32_t dstValueType = VALUE_TYPE_UNDEFINED;
@@ -512,6 +579,7 @@ void assignValue(FlowState *flowState, int componentIndex, Value &dstValue, cons
                     throwError(flowState, componentIndex, FlowError::Plain(errorMessage));
                 } else {
                     blobRef->blob[arrayElementValue->elementIndex] = elementValue;
+                    markValueChanged(flowState, nullptr);
                     // TODO: onValueChanged
                 }
                 return;
@@ -533,6 +601,7 @@ void assignValue(FlowState *flowState, int componentIndex, Value &dstValue, cons
             if (err) {
                 throwError(flowState, componentIndex, FlowError::Plain("Can not assign to JSON member"));
             }
+            markValueChanged(flowState, nullptr);
             return;
         }
 #endif
@@ -578,6 +647,7 @@ void assignValue(FlowState *flowState, int componentIndex, Value &dstValue, cons
 
         if (assignValue(*pDstValue, srcValue, dstValueType)) {
             onValueChanged(pDstValue);
+            markValueChanged(flowState, pDstValue);
         } else {
             char errorMessage[100];
             snprintf(errorMessage, sizeof(errorMessage), "Can not assign %s to %s\n",
@@ -590,8 +660,32 @@ void assignValue(FlowState *flowState, int componentIndex, Value &dstValue, cons
 
 ////////////////////////////////////////////////////////////////////////////////
 
+static int findInputComponentIndex(FlowState *flowState, unsigned inputValueIndex) {
+    auto flow = flowState->flow;
+    for (unsigned componentIndex = 0; componentIndex < flow->components.count; componentIndex++) {
+        auto component = flow->components[componentIndex];
+        for (unsigned inputIndex = 0; inputIndex < component->inputs.count; inputIndex++) {
+            if (component->inputs[inputIndex] == inputValueIndex) {
+                return (int)componentIndex;
+            }
+        }
+    }
+    return -1;
+}
+
 void clearInputValue(FlowState *flowState, int inputIndex) {
+    bool wasEmpty = isInputEmpty(flowState->values[inputIndex]);
     flowState->values[inputIndex] = Value();
+    if (isInputEmpty(flowState->values[inputIndex]) != wasEmpty) {
+        // rare, usually input is cleared after it was used
+        auto componentIndex = findInputComponentIndex(flowState, inputIndex);
+        if (componentIndex != -1) {
+            updateComponentInputCounters(flowState, componentIndex, inputIndex, !wasEmpty);
+        }
+    }
+#if EEZ_FLOW_TRACK_INPUT_CHANGES
+    markValueChanged(flowState, flowState->values + inputIndex);
+#endif
     onValueChanged(flowState->values + inputIndex);
 }
 
@@ -42,14 +42,29 @@ static const int NULL_VALUE_INDEX = 1;
         component->type == defs_v3::COMPONENT_TYPE_WATCH_VARIABLE_ACTION \
     )
 
+static const uint32_t NO_TIMER = 0xFFFFFFFF;
+
 struct ComponenentExecutionState {
 	virtual ~ComponenentExecutionState() {}
+
+	// position in the timers heap (see timers.h) or NO_TIMER
+	uint32_t timerIndex = NO_TIMER;
 };
 
 struct CatchErrorComponenentExecutionState : public ComponenentExecutionState {
 	Value message;
 };
 
+// Computed for each component when flow state is created and then updated whenever some input
+// changes between empty and non empty, so checking if component is ready to run doesn't have to
+// go through all of its inputs.
+struct ComponentInputCounters {
+    uint16_t numSeqInputs;
+    uint16_t numDefinedSeqInputs;
+    uint16_t numEmptyRequiredDataInputs;
+    uint8_t readyToRunRule;
+};
+
 struct FlowState {
 	uint32_t flowStateIndex;
 	Assets *assets;
@@ -77,8 +92,14 @@ struct FlowState {
 
     Value *values;
 	ComponenentExecutionState **componenentExecutionStates;
+    ComponentInputCounters *componentInputCounters;
     bool *componenentAsyncStates;
     unsigned executingComponentIndex;
+
+    // queue index: first queue task of this flow state and number of queue tasks per component
+    uint32_t firstQueueTask;
+    uint16_t *numQueueTasksForComponent;
+
     float timelinePosition;
 #if defined(EEZ_FOR_LVGL)
     int32_t lvglWidgetStartIndex;
@@ -105,6 +126,11 @@ bool canFreeFlowState(FlowState *flowState);
 void freeFlowState(FlowState *flowState);
 void freeAllChildrenFlowStates(FlowState *flowState);
 
+#if defined(EEZ_FOR_LVGL)
+// implemented in lvgl_api.cpp
+void removePropertyBindingsForFlowState(FlowState *flowState);
+#endif
+
 void deallocateComponentExecutionState(FlowState *flowState, unsigned componentIndex);
 
 extern void onComponentExecutionStateChanged(FlowState *flowState, int componentIndex);
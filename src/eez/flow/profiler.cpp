@@ -0,0 +1,159 @@
+/*
+ * eez-framework
+ *
+ * MIT License
+ * Copyright 2024 Envox d.o.o.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <eez/conf-internal.h>
+
+#include <string.h>
+
+#include <eez/core/os.h>
+
+#include <eez/flow/profiler.h>
+
+#if EEZ_FLOW_PROFILER
+
+namespace eez {
+namespace flow {
+
+static eez_flow_profiler_component_stats_t g_componentStats[EEZ_FLOW_PROFILER_MAX_COMPONENT_STATS];
+static uint32_t g_numComponentStats;
+static eez_flow_profiler_tick_stats_t g_tickStats;
+static uint32_t g_queueSizeHistoryIndex;
+
+static uint32_t g_tickStartTime;
+static uint32_t g_watchListStartTime;
+
+static inline unsigned getHistogramBucket(uint32_t duration) {
+    unsigned bucket = 0;
+    while (duration > 0 && bucket < EEZ_FLOW_PROFILER_HISTOGRAM_SIZE - 1) {
+        duration >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+static eez_flow_profiler_component_stats_t *findComponentStats(uint16_t flowIndex, uint16_t componentType) {
+    // open addressing with linear probing, entries are never removed (except on reset)
+    uint32_t key = ((uint32_t)flowIndex << 16) | componentType;
+    uint32_t i = (key * 2654435761u) % EEZ_FLOW_PROFILER_MAX_COMPONENT_STATS;
+    for (uint32_t n = 0; n < EEZ_FLOW_PROFILER_MAX_COMPONENT_STATS; n++) {
+        auto stats = g_componentStats + i;
+        if (stats->count == 0) {
+            stats->flowIndex = flowIndex;
+            stats->componentType = componentType;
+            g_numComponentStats++;
+            return stats;
+        }
+        if (stats->flowIndex == flowIndex && stats->componentType == componentType) {
+            return stats;
+        }
+        if (++i == EEZ_FLOW_PROFILER_MAX_COMPONENT_STATS) {
+            i = 0;
+        }
+    }
+    return nullptr;
+}
+
+void profilerReset() {
+    memset(g_componentStats, 0, sizeof(g_componentStats));
+    g_numComponentStats = 0;
+    memset(&g_tickStats, 0, sizeof(g_tickStats));
+    g_queueSizeHistoryIndex = 0;
+}
+
+void profilerTickBegin() {
+    g_tickStartTime = micros();
+    g_watchListStartTime = g_tickStartTime;
+}
+
+void profilerWatchListEnd(uint32_t queueSize) {
+    uint32_t duration = micros() - g_watchListStartTime;
+    g_tickStats.totalWatchListTime += duration;
+    if (duration > g_tickStats.maxWatchListTime) {
+        g_tickStats.maxWatchListTime = duration;
+    }
+
+    if (queueSize > g_tickStats.maxQueueSize) {
+        g_tickStats.maxQueueSize = queueSize;
+    }
+    g_tickStats.queueSizeHistory[g_queueSizeHistoryIndex] = queueSize;
+    if (++g_queueSizeHistoryIndex == EEZ_FLOW_PROFILER_QUEUE_SIZE_HISTORY) {
+        g_queueSizeHistoryIndex = 0;
+    }
+    if (g_tickStats.numQueueSizeHistory < EEZ_FLOW_PROFILER_QUEUE_SIZE_HISTORY) {
+        g_tickStats.numQueueSizeHistory++;
+    }
+}
+
+void profilerComponentExecuted(uint16_t flowIndex, uint16_t componentType, uint32_t duration) {
+    auto stats = findComponentStats(flowIndex, componentType);
+    if (!stats) {
+        g_tickStats.numUntrackedComponentExecutions++;
+        return;
+    }
+
+    stats->count++;
+    stats->totalTime += duration;
+    if (duration > stats->maxTime) {
+        stats->maxTime = duration;
+    }
+    stats->histogram[getHistogramBucket(duration)]++;
+}
+
+void profilerTickEnd(bool overBudget) {
+    uint32_t duration = micros() - g_tickStartTime;
+
+    g_tickStats.numTicks++;
+    if (overBudget) {
+        g_tickStats.numTicksOverBudget++;
+    }
+    g_tickStats.totalTickTime += duration;
+    if (duration > g_tickStats.maxTickTime) {
+        g_tickStats.maxTickTime = duration;
+    }
+}
+
+} // flow
+} // eez
+
+using namespace eez::flow;
+
+extern "C" void eez_flow_profiler_reset() {
+    profilerReset();
+}
+
+extern "C" uint32_t eez_flow_profiler_get_num_component_stats() {
+    return g_numComponentStats;
+}
+
+extern "C" bool eez_flow_profiler_get_component_stats(uint32_t index, eez_flow_profiler_component_stats_t *stats) {
+    for (uint32_t i = 0; i < EEZ_FLOW_PROFILER_MAX_COMPONENT_STATS; i++) {
+        if (g_componentStats[i].count > 0) {
+            if (index == 0) {
+                *stats = g_componentStats[i];
+                return true;
+            }
+            index--;
+        }
+    }
+    return false;
+}
+
+extern "C" void eez_flow_profiler_get_tick_stats(eez_flow_profiler_tick_stats_t *stats) {
+    *stats = g_tickStats;
+
+    // reorder queue size history so that the oldest sample is first
+    if (g_tickStats.numQueueSizeHistory == EEZ_FLOW_PROFILER_QUEUE_SIZE_HISTORY) {
+        for (uint32_t i = 0; i < EEZ_FLOW_PROFILER_QUEUE_SIZE_HISTORY; i++) {
+            stats->queueSizeHistory[i] = g_tickStats.queueSizeHistory[(g_queueSizeHistoryIndex + i) % EEZ_FLOW_PROFILER_QUEUE_SIZE_HISTORY];
+        }
+    }
+}
+
+#endif // EEZ_FLOW_PROFILER
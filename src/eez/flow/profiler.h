@@ -0,0 +1,87 @@
+/*
+ * eez-framework
+ *
+ * MIT License
+ * Copyright 2024 Envox d.o.o.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Set to 1 to collect execution time statistics for the flow components, tick and watch list.
+// When disabled, profiler is compiled out completely.
+#if !defined(EEZ_FLOW_PROFILER)
+#define EEZ_FLOW_PROFILER 0
+#endif
+
+#if EEZ_FLOW_PROFILER
+
+// Max. number of different (flow, component type) pairs for which statistics is collected
+#if !defined(EEZ_FLOW_PROFILER_MAX_COMPONENT_STATS)
+#define EEZ_FLOW_PROFILER_MAX_COMPONENT_STATS 64
+#endif
+
+// Queue size is sampled at the start of each tick, this is how many last samples are kept
+#if !defined(EEZ_FLOW_PROFILER_QUEUE_SIZE_HISTORY)
+#define EEZ_FLOW_PROFILER_QUEUE_SIZE_HISTORY 64
+#endif
+
+// Latency histogram: bucket 0 counts durations < 1 us, bucket i counts durations in [2^(i-1), 2^i) us
+// and the last bucket counts everything above.
+#define EEZ_FLOW_PROFILER_HISTOGRAM_SIZE 16
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint16_t flowIndex;
+    uint16_t componentType;
+    uint32_t count;
+    uint64_t totalTime; // us
+    uint32_t maxTime; // us
+    uint32_t histogram[EEZ_FLOW_PROFILER_HISTOGRAM_SIZE];
+} eez_flow_profiler_component_stats_t;
+
+typedef struct {
+    uint32_t numTicks;
+    uint32_t numTicksOverBudget; // ticks that were interrupted because of EEZ_FLOW_TICK_MAX_DURATION_MS
+    uint64_t totalTickTime; // us
+    uint32_t maxTickTime; // us
+    uint64_t totalWatchListTime; // us
+    uint32_t maxWatchListTime; // us
+    uint32_t maxQueueSize;
+    uint32_t numUntrackedComponentExecutions; // not tracked because EEZ_FLOW_PROFILER_MAX_COMPONENT_STATS is reached
+    uint32_t numQueueSizeHistory;
+    uint32_t queueSizeHistory[EEZ_FLOW_PROFILER_QUEUE_SIZE_HISTORY]; // oldest first
+} eez_flow_profiler_tick_stats_t;
+
+void eez_flow_profiler_reset();
+uint32_t eez_flow_profiler_get_num_component_stats();
+bool eez_flow_profiler_get_component_stats(uint32_t index, eez_flow_profiler_component_stats_t *stats);
+void eez_flow_profiler_get_tick_stats(eez_flow_profiler_tick_stats_t *stats);
+
+#ifdef __cplusplus
+}
+
+namespace eez {
+namespace flow {
+
+void profilerReset();
+
+void profilerTickBegin();
+void profilerWatchListEnd(uint32_t queueSize);
+void profilerComponentExecuted(uint16_t flowIndex, uint16_t componentType, uint32_t duration);
+void profilerTickEnd(bool overBudget);
+
+} // flow
+} // eez
+
+#endif // __cplusplus
+
+#endif // EEZ_FLOW_PROFILER
@@ -8,6 +8,8 @@
  * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <string.h>
+
 #include <eez/conf-internal.h>
 
 #include <eez/flow/queue.h>
@@ -21,62 +23,219 @@ namespace flow {
 #define EEZ_FLOW_QUEUE_SIZE 1000
 #endif
 static const unsigned QUEUE_SIZE = EEZ_FLOW_QUEUE_SIZE;
-static struct {
+
+// Queue is allowed to grow beyond QUEUE_SIZE (using heap) up to this number of tasks,
+// 0 means there is no limit other than available heap memory.
+#if !defined(EEZ_FLOW_QUEUE_MAX_SIZE)
+#define EEZ_FLOW_QUEUE_MAX_SIZE 0
+#endif
+static const unsigned QUEUE_MAX_SIZE = EEZ_FLOW_QUEUE_MAX_SIZE;
+
+// Tasks are stored in a pool of slots. Slots are linked in FIFO order and, additionally,
+// all the slots belonging to the same FlowState are linked together, so we can find
+// all the tasks of some FlowState without scanning the whole queue.
+struct QueueTask {
 	FlowState *flowState;
 	unsigned componentIndex;
     bool continuousTask;
-} g_queue[QUEUE_SIZE];
-static unsigned g_queueHead;
-static unsigned g_queueTail;
+
+    uint32_t next; // next task in FIFO order (in the same lane), or next free slot
+    uint32_t prevInFlowState;
+    uint32_t nextInFlowState;
+
+#if EEZ_FLOW_SCHEDULER
+    uint8_t lane;
+    uint32_t seq; // global FIFO order
+#endif
+};
+
+static QueueTask g_staticTasks[QUEUE_SIZE];
+static QueueTask *g_tasks = g_staticTasks;
+static uint32_t g_tasksCapacity = QUEUE_SIZE;
+static uint32_t g_numUsedSlots;
+static uint32_t g_firstFreeSlot = QUEUE_NO_TASK;
+
+struct QueueLaneState {
+    uint32_t head;
+    uint32_t tail;
+    unsigned size;
+#if EEZ_FLOW_SCHEDULER
+    unsigned ticksWaiting;
+    bool served;
+#endif
+};
+
+static QueueLaneState g_lanes[NUM_QUEUE_LANES];
+static unsigned g_queueSize;
 static unsigned g_queueMax;
-static bool g_queueIsFull = false;
 unsigned g_numNonContinuousTaskInQueue;
 
+// task returned by peekNextTaskFromQueue and removed by removeNextTaskFromQueue
+static int g_selectedLane;
+static uint32_t g_selectedTask = QUEUE_NO_TASK;
+static uint32_t g_selectedTaskPrev = QUEUE_NO_TASK; // previous task in the lane
+
+#if EEZ_FLOW_SCHEDULER
+static uint32_t g_nextSeq;
+static int g_priorityLane = -1; // lane promoted to the highest priority in the current tick
+static unsigned g_continuousTasksLeft; // continuous tasks that can still be executed in the current tick
+static FlowState *g_lastExecutedFlowState;
+static unsigned g_numTasksFromLastExecutedFlowState;
+#endif
+
 void queueReset() {
-	g_queueHead = 0;
-	g_queueTail = 0;
+    if (g_tasks != g_staticTasks) {
+        eez::free(g_tasks);
+        g_tasks = g_staticTasks;
+        g_tasksCapacity = QUEUE_SIZE;
+    }
+    g_numUsedSlots = 0;
+    g_firstFreeSlot = QUEUE_NO_TASK;
+
+    for (int lane = 0; lane < NUM_QUEUE_LANES; lane++) {
+        g_lanes[lane].head = QUEUE_NO_TASK;
+        g_lanes[lane].tail = QUEUE_NO_TASK;
+        g_lanes[lane].size = 0;
+#if EEZ_FLOW_SCHEDULER
+        g_lanes[lane].ticksWaiting = 0;
+        g_lanes[lane].served = false;
+#endif
+    }
+    g_queueSize = 0;
 	g_queueMax  = 0;
-	g_queueIsFull = false;
     g_numNonContinuousTaskInQueue = 0;
-}
 
-size_t getQueueSize() {
-	if (g_queueHead == g_queueTail) {
-		if (g_queueIsFull) {
-			return QUEUE_SIZE;
-		}
-		return 0;
-	}
+    g_selectedTask = QUEUE_NO_TASK;
+    g_selectedTaskPrev = QUEUE_NO_TASK;
 
-	if (g_queueHead < g_queueTail) {
-		return g_queueTail - g_queueHead;
-	}
+#if EEZ_FLOW_SCHEDULER
+    g_nextSeq = 0;
+    g_priorityLane = -1;
+    g_continuousTasksLeft = 0;
+    g_lastExecutedFlowState = nullptr;
+    g_numTasksFromLastExecutedFlowState = 0;
+#endif
+}
 
-	return QUEUE_SIZE - g_queueHead + g_queueTail;
+size_t getQueueSize() {
+	return g_queueSize;
 }
 
 size_t getMaxQueueSize() {
 	return g_queueMax;
 }
 
+static bool growQueue() {
+    if (QUEUE_MAX_SIZE > 0 && g_tasksCapacity >= QUEUE_MAX_SIZE) {
+        return false;
+    }
+
+    uint32_t newCapacity = 2 * g_tasksCapacity;
+    if (QUEUE_MAX_SIZE > 0 && newCapacity > QUEUE_MAX_SIZE) {
+        newCapacity = QUEUE_MAX_SIZE;
+    }
+
+    auto newTasks = (QueueTask *)alloc(newCapacity * sizeof(QueueTask), 0x5e3b8a1c);
+    if (!newTasks) {
+        return false;
+    }
+
+    // slot indexes are preserved, so all the links are still valid after the copy
+    memcpy(newTasks, g_tasks, g_numUsedSlots * sizeof(QueueTask));
+
+    if (g_tasks != g_staticTasks) {
+        eez::free(g_tasks);
+    }
+
+    g_tasks = newTasks;
+    g_tasksCapacity = newCapacity;
+
+    return true;
+}
+
+static uint32_t allocTaskSlot() {
+    if (g_firstFreeSlot != QUEUE_NO_TASK) {
+        auto slotIndex = g_firstFreeSlot;
+        g_firstFreeSlot = g_tasks[slotIndex].next;
+        return slotIndex;
+    }
+
+    if (g_numUsedSlots == g_tasksCapacity && !growQueue()) {
+        return QUEUE_NO_TASK;
+    }
+
+    return g_numUsedSlots++;
+}
+
+static void freeTaskSlot(uint32_t slotIndex) {
+    g_tasks[slotIndex].next = g_firstFreeSlot;
+    g_firstFreeSlot = slotIndex;
+}
+
+static void unlinkTaskFromFlowState(uint32_t slotIndex) {
+    auto &task = g_tasks[slotIndex];
+    auto flowState = task.flowState;
+
+    if (task.prevInFlowState != QUEUE_NO_TASK) {
+        g_tasks[task.prevInFlowState].nextInFlowState = task.nextInFlowState;
+    } else {
+        flowState->firstQueueTask = task.nextInFlowState;
+    }
+
+    if (task.nextInFlowState != QUEUE_NO_TASK) {
+        g_tasks[task.nextInFlowState].prevInFlowState = task.prevInFlowState;
+    }
+
+    flowState->numQueueTasksForComponent[task.componentIndex]--;
+}
+
 bool addToQueue(FlowState *flowState, unsigned componentIndex, int sourceComponentIndex, int sourceOutputIndex, int targetInputIndex, bool continuousTask) {
-	if (g_queueIsFull) {
+    if (flowState->numQueueTasksForComponent[componentIndex] == UINT16_MAX) {
+        throwError(flowState, componentIndex, "Execution queue is full\n");
+		return false;
+    }
+
+    auto slotIndex = allocTaskSlot();
+	if (slotIndex == QUEUE_NO_TASK) {
         throwError(flowState, componentIndex, "Execution queue is full\n");
 		return false;
 	}
 
-	g_queue[g_queueTail].flowState = flowState;
-	g_queue[g_queueTail].componentIndex = componentIndex;
-    g_queue[g_queueTail].continuousTask = continuousTask;
+    auto &task = g_tasks[slotIndex];
 
-	g_queueTail = (g_queueTail + 1) % QUEUE_SIZE;
+	task.flowState = flowState;
+	task.componentIndex = componentIndex;
+    task.continuousTask = continuousTask;
 
-	if (g_queueHead == g_queueTail) {
-		g_queueIsFull = true;
-	}
+#if EEZ_FLOW_SCHEDULER
+    int laneIndex = continuousTask ? QUEUE_LANE_CONTINUOUS : flowState->isAction ? QUEUE_LANE_ACTION : QUEUE_LANE_UI;
+    task.lane = laneIndex;
+    task.seq = g_nextSeq++;
+#else
+    int laneIndex = 0;
+#endif
+    auto &lane = g_lanes[laneIndex];
+
+    task.next = QUEUE_NO_TASK;
+    if (lane.tail != QUEUE_NO_TASK) {
+        g_tasks[lane.tail].next = slotIndex;
+    } else {
+        lane.head = slotIndex;
+    }
+    lane.tail = slotIndex;
+    lane.size++;
 
-	size_t queueSize = getQueueSize();
-	g_queueMax = g_queueMax < queueSize ? queueSize : g_queueMax;
+    task.prevInFlowState = QUEUE_NO_TASK;
+    task.nextInFlowState = flowState->firstQueueTask;
+    if (flowState->firstQueueTask != QUEUE_NO_TASK) {
+        g_tasks[flowState->firstQueueTask].prevInFlowState = slotIndex;
+    }
+    flowState->firstQueueTask = slotIndex;
+
+    flowState->numQueueTasksForComponent[componentIndex]++;
+
+	g_queueSize++;
+	g_queueMax = g_queueMax < g_queueSize ? g_queueSize : g_queueMax;
 
     if (!continuousTask) {
         ++g_numNonContinuousTaskInQueue;
@@ -88,26 +247,138 @@ bool addToQueue(FlowState *flowState, unsigned componentIndex, int sourceCompone
 	return true;
 }
 
+#if EEZ_FLOW_SCHEDULER
+
+static bool isLaneRunnable(int lane) {
+    if (g_lanes[lane].head == QUEUE_NO_TASK) {
+        return false;
+    }
+    if (lane == QUEUE_LANE_CONTINUOUS && g_continuousTasksLeft == 0) {
+        return false;
+    }
+    return true;
+}
+
+static void selectTaskInLane(int lane) {
+    g_selectedLane = lane;
+    g_selectedTask = g_lanes[lane].head;
+    g_selectedTaskPrev = QUEUE_NO_TASK;
+
+    if (g_debuggerIsConnected) {
+        // debugger mirrors the queue in FIFO order, do not reorder
+        return;
+    }
+
+    if (g_tasks[g_selectedTask].flowState != g_lastExecutedFlowState || g_numTasksFromLastExecutedFlowState < EEZ_FLOW_SCHEDULER_QUANTUM) {
+        return;
+    }
+
+    // Last flow state used its quantum, give a turn to the next flow state waiting in this lane.
+    // All the skipped tasks belong to the last flow state, so the order of tasks inside
+    // each flow state is preserved.
+    uint32_t prev = g_selectedTask;
+    for (uint32_t slotIndex = g_tasks[prev].next; slotIndex != QUEUE_NO_TASK; prev = slotIndex, slotIndex = g_tasks[slotIndex].next) {
+        if (g_tasks[slotIndex].flowState != g_lastExecutedFlowState) {
+            g_selectedTask = slotIndex;
+            g_selectedTaskPrev = prev;
+            return;
+        }
+    }
+}
+
+#endif
+
 bool peekNextTaskFromQueue(FlowState *&flowState, unsigned &componentIndex, bool &continuousTask) {
-	if (g_queueHead == g_queueTail && !g_queueIsFull) {
+#if EEZ_FLOW_SCHEDULER
+    int selectedLane = -1;
+
+    if (g_debuggerIsConnected) {
+        // global FIFO order: lane head with the lowest sequence number
+        for (int lane = 0; lane < NUM_QUEUE_LANES; lane++) {
+            if (isLaneRunnable(lane) && (selectedLane == -1 || (int32_t)(g_tasks[g_lanes[lane].head].seq - g_tasks[g_lanes[selectedLane].head].seq) < 0)) {
+                selectedLane = lane;
+            }
+        }
+    } else if (g_priorityLane != -1 && isLaneRunnable(g_priorityLane)) {
+        selectedLane = g_priorityLane;
+    } else {
+        for (int lane = 0; lane < NUM_QUEUE_LANES; lane++) {
+            if (isLaneRunnable(lane)) {
+                selectedLane = lane;
+                break;
+            }
+        }
+    }
+
+    if (selectedLane == -1) {
+        g_selectedTask = QUEUE_NO_TASK;
+        return false;
+    }
+
+    selectTaskInLane(selectedLane);
+#else
+	if (g_lanes[0].head == QUEUE_NO_TASK) {
+		g_selectedTask = QUEUE_NO_TASK;
 		return false;
 	}
 
-	flowState = g_queue[g_queueHead].flowState;
-	componentIndex = g_queue[g_queueHead].componentIndex;
-    continuousTask = g_queue[g_queueHead].continuousTask;
+    g_selectedLane = 0;
+    g_selectedTask = g_lanes[0].head;
+    g_selectedTaskPrev = QUEUE_NO_TASK;
+#endif
+
+    auto &task = g_tasks[g_selectedTask];
+
+	flowState = task.flowState;
+	componentIndex = task.componentIndex;
+    continuousTask = task.continuousTask;
 
 	return true;
 }
 
 void removeNextTaskFromQueue() {
-	auto flowState = g_queue[g_queueHead].flowState;
-    decRefCounterForFlowState(flowState);
+    auto slotIndex = g_selectedTask;
+    auto &task = g_tasks[slotIndex];
+
+	auto flowState = task.flowState;
+    if (flowState) {
+        unlinkTaskFromFlowState(slotIndex);
+        decRefCounterForFlowState(flowState);
+    }
+
+    auto continuousTask = task.continuousTask;
+
+    auto &lane = g_lanes[g_selectedLane];
+    if (g_selectedTaskPrev == QUEUE_NO_TASK) {
+        lane.head = task.next;
+    } else {
+        g_tasks[g_selectedTaskPrev].next = task.next;
+    }
+    if (lane.tail == slotIndex) {
+        lane.tail = g_selectedTaskPrev;
+    }
+    lane.size--;
+    g_queueSize--;
 
-    auto continuousTask = g_queue[g_queueHead].continuousTask;
+#if EEZ_FLOW_SCHEDULER
+    lane.served = true;
 
-	g_queueHead = (g_queueHead + 1) % QUEUE_SIZE;
-	g_queueIsFull = false;
+    if (g_selectedLane == QUEUE_LANE_CONTINUOUS && g_continuousTasksLeft > 0) {
+        g_continuousTasksLeft--;
+    }
+
+    if (flowState) {
+        if (flowState == g_lastExecutedFlowState) {
+            g_numTasksFromLastExecutedFlowState++;
+        } else {
+            g_lastExecutedFlowState = flowState;
+            g_numTasksFromLastExecutedFlowState = 1;
+        }
+    }
+#endif
+
+    freeTaskSlot(slotIndex);
+    g_selectedTask = QUEUE_NO_TASK;
 
     if (!continuousTask) {
         --g_numNonContinuousTaskInQueue;
@@ -116,42 +387,76 @@ void removeNextTaskFromQueue() {
 }
 
 bool isInQueue(FlowState *flowState, unsigned componentIndex) {
-	if (g_queueHead == g_queueTail && !g_queueIsFull) {
-		return false;
-	}
+    return flowState->numQueueTasksForComponent[componentIndex] > 0;
+}
+
+void removeTasksFromQueueForFlowState(FlowState *flowState) {
+    // Tasks are not removed from the FIFO, only marked as removed by clearing flowState,
+    // so that debugger still receives onRemoveFromQueue for each task it was notified about.
+    auto slotIndex = flowState->firstQueueTask;
+    while (slotIndex != QUEUE_NO_TASK) {
+        auto &task = g_tasks[slotIndex];
+        auto nextSlotIndex = task.nextInFlowState;
 
-    unsigned int it = g_queueHead;
-    while (true) {
-		if (g_queue[it].flowState == flowState && g_queue[it].componentIndex == componentIndex) {
-            return true;
-		}
+        flowState->numQueueTasksForComponent[task.componentIndex]--;
+        decRefCounterForFlowState(flowState);
 
-        it = (it + 1) % QUEUE_SIZE;
-        if (it == g_queueTail) {
-            break;
-        }
+        task.flowState = nullptr;
+        task.prevInFlowState = QUEUE_NO_TASK;
+        task.nextInFlowState = QUEUE_NO_TASK;
+
+        slotIndex = nextSlotIndex;
 	}
+    flowState->firstQueueTask = QUEUE_NO_TASK;
+
+#if EEZ_FLOW_SCHEDULER
+    if (g_lastExecutedFlowState == flowState) {
+        g_lastExecutedFlowState = nullptr;
+        g_numTasksFromLastExecutedFlowState = 0;
+    }
+#endif
+}
+
+#if EEZ_FLOW_SCHEDULER
+
+void queueTickBegin() {
+    g_continuousTasksLeft = g_lanes[QUEUE_LANE_CONTINUOUS].size;
 
-    return false;
+    // promote the lane that waits the longest, so lower priority lanes are not starved
+    g_priorityLane = -1;
+    unsigned maxTicksWaiting = 0;
+    for (int lane = 0; lane < NUM_QUEUE_LANES; lane++) {
+        g_lanes[lane].served = false;
+        if (g_lanes[lane].ticksWaiting >= EEZ_FLOW_SCHEDULER_MAX_LANE_WAIT_TICKS && g_lanes[lane].ticksWaiting > maxTicksWaiting) {
+            g_priorityLane = lane;
+            maxTicksWaiting = g_lanes[lane].ticksWaiting;
+        }
+    }
 }
 
-void removeTasksFromQueueForFlowState(FlowState *flowState) {
-	if (g_queueHead == g_queueTail && !g_queueIsFull) {
-		return;
-	}
+bool queueTickEnd() {
+    bool workLeft = false;
 
-    unsigned int it = g_queueHead;
-    while (true) {
-		if (g_queue[it].flowState == flowState) {
-            g_queue[it].flowState = 0;
-		}
+    for (int lane = 0; lane < NUM_QUEUE_LANES; lane++) {
+        if (g_lanes[lane].served || g_lanes[lane].head == QUEUE_NO_TASK) {
+            g_lanes[lane].ticksWaiting = 0;
+        } else {
+            g_lanes[lane].ticksWaiting++;
+        }
 
-        it = (it + 1) % QUEUE_SIZE;
-        if (it == g_queueTail) {
-            break;
+        if (isLaneRunnable(lane)) {
+            workLeft = true;
         }
-	}
+    }
+
+    return workLeft;
 }
 
+size_t getQueueLaneSize(int lane) {
+    return g_lanes[lane].size;
+}
+
+#endif // EEZ_FLOW_SCHEDULER
+
 } // namespace flow
 } // namespace eez
@@ -12,9 +12,49 @@
 
 #include <eez/flow/private.h>
 
+// Set to 1 to enable the scheduler: tick time budget is measured in microseconds and checked
+// after each component, tasks are split into priority lanes and, inside a lane, flow states
+// take turns (round-robin) instead of one flow state being able to occupy the whole tick.
+#if !defined(EEZ_FLOW_SCHEDULER)
+#define EEZ_FLOW_SCHEDULER 0
+#endif
+
+#if EEZ_FLOW_SCHEDULER
+
+// Default tick time budget in microseconds, can be changed at runtime with setSchedulerTickBudget
+#if !defined(EEZ_FLOW_SCHEDULER_TICK_BUDGET_US)
+#define EEZ_FLOW_SCHEDULER_TICK_BUDGET_US 5000
+#endif
+
+// Max. number of tasks in a row from the same flow state if other flow states are waiting in the same lane
+#if !defined(EEZ_FLOW_SCHEDULER_QUANTUM)
+#define EEZ_FLOW_SCHEDULER_QUANTUM 4
+#endif
+
+// Lane that wasn't served for this many ticks gets the highest priority in the next tick
+#if !defined(EEZ_FLOW_SCHEDULER_MAX_LANE_WAIT_TICKS)
+#define EEZ_FLOW_SCHEDULER_MAX_LANE_WAIT_TICKS 8
+#endif
+
+#endif // EEZ_FLOW_SCHEDULER
+
 namespace eez {
 namespace flow {
 
+static const uint32_t QUEUE_NO_TASK = 0xFFFFFFFF;
+
+#if EEZ_FLOW_SCHEDULER
+// In order of priority
+enum QueueLane {
+    QUEUE_LANE_UI, // page and user widget flows
+    QUEUE_LANE_ACTION, // action flows
+    QUEUE_LANE_CONTINUOUS, // continuous tasks, executed at most once per tick
+    NUM_QUEUE_LANES
+};
+#else
+static const int NUM_QUEUE_LANES = 1;
+#endif
+
 void queueReset();
 size_t getQueueSize();
 size_t getMaxQueueSize();
@@ -29,5 +69,13 @@ bool isInQueue(FlowState *flowState, unsigned componentIndex);
 
 void removeTasksFromQueueForFlowState(FlowState *flowState);
 
+#if EEZ_FLOW_SCHEDULER
+// Called at the beginning of each tick, before the first peekNextTaskFromQueue
+void queueTickBegin();
+// Called at the end of each tick, returns true if there are tasks left that could have been executed in this tick
+bool queueTickEnd();
+size_t getQueueLaneSize(int lane);
+#endif
+
 } // flow
 } // eez
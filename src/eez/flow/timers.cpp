@@ -0,0 +1,195 @@
+/*
+ * eez-framework
+ *
+ * MIT License
+ * Copyright 2024 Envox d.o.o.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <eez/conf-internal.h>
+
+#include <string.h>
+
+#include <eez/core/os.h>
+
+#include <eez/flow/timers.h>
+#include <eez/flow/queue.h>
+
+namespace eez {
+namespace flow {
+
+struct Timer {
+    ComponenentExecutionState *executionState;
+    FlowState *flowState;
+    unsigned componentIndex;
+    uint32_t deadline;
+};
+
+// min-heap ordered by deadline, execution state of each timer knows its position in the heap
+static Timer *g_timers;
+static unsigned g_numTimers;
+static unsigned g_timersCapacity;
+
+static const unsigned TIMERS_INITIAL_CAPACITY = 16;
+
+static inline bool isBefore(const Timer &a, const Timer &b) {
+    return (int32_t)(a.deadline - b.deadline) < 0;
+}
+
+static inline void setTimer(unsigned i, const Timer &timer) {
+    g_timers[i] = timer;
+    timer.executionState->timerIndex = i;
+}
+
+static void siftUp(unsigned i) {
+    Timer timer = g_timers[i];
+    while (i > 0) {
+        unsigned parent = (i - 1) / 2;
+        if (!isBefore(timer, g_timers[parent])) {
+            break;
+        }
+        setTimer(i, g_timers[parent]);
+        i = parent;
+    }
+    setTimer(i, timer);
+}
+
+static void siftDown(unsigned i) {
+    Timer timer = g_timers[i];
+    while (true) {
+        unsigned child = 2 * i + 1;
+        if (child >= g_numTimers) {
+            break;
+        }
+        if (child + 1 < g_numTimers && isBefore(g_timers[child + 1], g_timers[child])) {
+            child++;
+        }
+        if (!isBefore(g_timers[child], timer)) {
+            break;
+        }
+        setTimer(i, g_timers[child]);
+        i = child;
+    }
+    setTimer(i, timer);
+}
+
+static void removeTimerAt(unsigned i) {
+    g_timers[i].executionState->timerIndex = NO_TIMER;
+    g_numTimers--;
+    if (i < g_numTimers) {
+        auto movedExecutionState = g_timers[g_numTimers].executionState;
+        g_timers[i] = g_timers[g_numTimers];
+        siftDown(i);
+        siftUp(movedExecutionState->timerIndex);
+    }
+}
+
+static bool growTimers() {
+    unsigned newCapacity = g_timersCapacity > 0 ? 2 * g_timersCapacity : TIMERS_INITIAL_CAPACITY;
+
+    auto newTimers = (Timer *)alloc(newCapacity * sizeof(Timer), 0x2f6c9e31);
+    if (!newTimers) {
+        return false;
+    }
+
+    if (g_timers) {
+        memcpy(newTimers, g_timers, g_numTimers * sizeof(Timer));
+        eez::free(g_timers);
+    }
+
+    g_timers = newTimers;
+    g_timersCapacity = newCapacity;
+
+    return true;
+}
+
+bool addTimer(FlowState *flowState, unsigned componentIndex, uint32_t deadline) {
+    auto executionState = flowState->componenentExecutionStates[componentIndex];
+    if (!executionState) {
+        // timer would never fire
+        return false;
+    }
+
+    if (executionState->timerIndex != NO_TIMER) {
+        // reschedule in place
+        auto i = executionState->timerIndex;
+        g_timers[i].deadline = deadline;
+        siftDown(i);
+        siftUp(executionState->timerIndex);
+        return true;
+    }
+
+    if (g_numTimers == g_timersCapacity && !growTimers()) {
+        throwError(flowState, componentIndex, "Out of memory for timers\n");
+        return false;
+    }
+
+    auto &timer = g_timers[g_numTimers];
+    timer.executionState = executionState;
+    timer.flowState = flowState;
+    timer.componentIndex = componentIndex;
+    timer.deadline = deadline;
+
+    siftUp(g_numTimers++);
+
+    return true;
+}
+
+void removeTimer(FlowState *flowState, unsigned componentIndex) {
+    auto executionState = flowState->componenentExecutionStates[componentIndex];
+    if (executionState && executionState->timerIndex != NO_TIMER) {
+        removeTimerAt(executionState->timerIndex);
+    }
+}
+
+bool wakeUpComponent(FlowState *flowState, unsigned componentIndex) {
+    auto executionState = flowState->componenentExecutionStates[componentIndex];
+    if (!executionState || executionState->timerIndex == NO_TIMER) {
+        return false;
+    }
+
+    removeTimerAt(executionState->timerIndex);
+    addToQueue(flowState, componentIndex, -1, -1, -1, true);
+
+    return true;
+}
+
+void visitTimers() {
+    uint32_t time = millis();
+
+    while (g_numTimers > 0 && isDeadlineReached(g_timers[0].deadline, time)) {
+        Timer timer = g_timers[0];
+        removeTimerAt(0);
+        addToQueue(timer.flowState, timer.componentIndex, -1, -1, -1, true);
+    }
+}
+
+void timersReset() {
+    for (unsigned i = 0; i < g_numTimers; i++) {
+        g_timers[i].executionState->timerIndex = NO_TIMER;
+    }
+
+    if (g_timers) {
+        eez::free(g_timers);
+        g_timers = nullptr;
+    }
+    g_numTimers = 0;
+    g_timersCapacity = 0;
+}
+
+bool getNextTimerDeadline(uint32_t &deadline) {
+    if (g_numTimers == 0) {
+        return false;
+    }
+    deadline = g_timers[0].deadline;
+    return true;
+}
+
+unsigned getNumTimers() {
+    return g_numTimers;
+}
+
+} // namespace flow
+} // namespace eez
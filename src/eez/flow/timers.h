@@ -0,0 +1,45 @@
+/*
+ * eez-framework
+ *
+ * MIT License
+ * Copyright 2024 Envox d.o.o.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <eez/flow/private.h>
+
+namespace eez {
+namespace flow {
+
+// Components waiting for some time to pass (e.g. Delay) are put here instead of being
+// re-added to the queue on every tick. When the deadline (in millis) is reached component
+// is added to the queue as continuous task.
+// Timer belongs to the component execution state, which must exist when the timer is added,
+// and is removed when the execution state is deallocated. There is at most one timer per
+// component, adding a new one replaces the old one.
+bool addTimer(FlowState *flowState, unsigned componentIndex, uint32_t deadline);
+void removeTimer(FlowState *flowState, unsigned componentIndex);
+
+// Adds sleeping component to the queue now instead of at its deadline, e.g. when the event
+// it was waiting for has arrived. Returns false if component has no timer.
+bool wakeUpComponent(FlowState *flowState, unsigned componentIndex);
+
+// Adds components with expired timers to the queue, called at the start of each tick
+void visitTimers();
+void timersReset();
+
+// Returns false if there are no timers
+bool getNextTimerDeadline(uint32_t &deadline);
+unsigned getNumTimers();
+
+// Time comparison that works across millis() wrap around
+inline bool isDeadlineReached(uint32_t deadline, uint32_t time) {
+    return (int32_t)(time - deadline) >= 0;
+}
+
+} // flow
+} // eez
@@ -10,21 +10,33 @@
 
 #include <eez/conf-internal.h>
 
+#include <string.h>
+
 #include <eez/flow/watch_list.h>
 #include <eez/flow/components.h>
 #include <eez/flow/debugger.h>
+#include <eez/flow/flow_defs_v3.h>
 
 namespace eez {
 namespace flow {
 
 void executeWatchVariableComponent(FlowState *flowState, unsigned componentIndex);
 
+static const unsigned WATCH_MAX_GLOBAL_VARIABLES = 4;
+
 struct WatchListNode {
     FlowState *flowState;
     unsigned componentIndex;
 
     WatchListNode *prev;
     WatchListNode *next;
+
+    // value of g_changeVersion at the time of the last evaluation
+    uint32_t version;
+
+    uint8_t dependsOn;
+    uint8_t numGlobalVariables;
+    uint16_t globalVariables[WATCH_MAX_GLOBAL_VARIABLES];
 };
 
 struct WatchList {
@@ -34,6 +46,199 @@ struct WatchList {
 };
 
 static WatchList g_watchList;
+static unsigned g_numWatchesEvaluatedOnEveryTick;
+
+// Incremented on every change, each tracked variable remembers the version of its last change
+static uint32_t g_changeVersion;
+
+static uint32_t *g_globalVariableVersions;
+static uint32_t g_numGlobalVariableVersions;
+static uint32_t g_anyGlobalVariableVersion;
+static uint32_t g_nativeVariablesVersion;
+// changes that can't be attributed to a single global variable, e.g. array element or struct member assignment
+static uint32_t g_indirectChangeVersion;
+// component input or local variable of some flow state
+static uint32_t g_flowStateValuesVersion;
+
+#if EEZ_OPTION_GUI
+uint8_t g_widgetDataDependencies;
+#endif
+
+static inline bool isChangedSince(uint32_t version, uint32_t sinceVersion) {
+    return (int32_t)(version - sinceVersion) > 0;
+}
+
+static bool isPureOperation(uint16_t operation) {
+    using namespace defs_v3;
+
+    return
+        operation <= OPERATION_TYPE_CONDITIONAL ||
+        (operation >= OPERATION_TYPE_FLOW_PARSE_INTEGER && operation <= OPERATION_TYPE_FLOW_PARSE_DOUBLE) ||
+        (operation >= OPERATION_TYPE_MATH_SIN && operation <= OPERATION_TYPE_ARRAY_SLICE) ||
+        operation == OPERATION_TYPE_MATH_POW ||
+        operation == OPERATION_TYPE_FLOW_TO_INTEGER ||
+        operation == OPERATION_TYPE_STRING_FROM_CODE_POINT ||
+        operation == OPERATION_TYPE_STRING_CODE_POINT_AT ||
+        operation == OPERATION_TYPE_STRING_FORMAT ||
+        operation == OPERATION_TYPE_STRING_FORMAT_PREFIX;
+}
+
+// Find out which data is read by the expression. Indexes of the global variables read are stored
+// into globalVariables, numGlobalVariables is set to 0xFF if there is more than maxGlobalVariables.
+static uint8_t findExpressionDependencies(
+    FlowDefinition *flowDefinition, const uint8_t *instructions,
+    uint16_t *globalVariables, uint8_t &numGlobalVariables, unsigned maxGlobalVariables
+) {
+    numGlobalVariables = 0;
+
+#if EEZ_FLOW_WATCH_CHANGE_TRACKING
+    uint8_t dependsOn = 0;
+
+	for (int i = 0; ; i += 2) {
+		uint16_t instruction = instructions[i] + (instructions[i + 1] << 8);
+		auto instructionType = instruction & EXPR_EVAL_INSTRUCTION_TYPE_MASK;
+		auto instructionArg = instruction & EXPR_EVAL_INSTRUCTION_PARAM_MASK;
+
+		if (instructionType == EXPR_EVAL_INSTRUCTION_TYPE_PUSH_CONSTANT) {
+		} else if (instructionType == EXPR_EVAL_INSTRUCTION_TYPE_PUSH_GLOBAL_VAR) {
+			if ((uint32_t)instructionArg < flowDefinition->globalVariables.count) {
+                // array elements and struct members of the global variable can also be changed
+                dependsOn |= DATA_DEPENDS_ON_GLOBAL_VARIABLES;
+                if (numGlobalVariables < maxGlobalVariables) {
+                    globalVariables[numGlobalVariables++] = instructionArg;
+                } else {
+                    // too many variables, any global variable change will trigger evaluation
+                    numGlobalVariables = 0xFF;
+                }
+			} else {
+#if EEZ_FLOW_NATIVE_VARIABLES_CHANGE_NOTIFY
+                dependsOn |= DATA_DEPENDS_ON_NATIVE_VARIABLES;
+#else
+                return DATA_DEPENDS_ON_EVERYTHING;
+#endif
+			}
+		} else if (instructionType == EXPR_EVAL_INSTRUCTION_ARRAY_ELEMENT) {
+		} else if (instructionType == EXPR_EVAL_INSTRUCTION_TYPE_OPERATION) {
+            if (!isPureOperation(instructionArg)) {
+                return DATA_DEPENDS_ON_EVERYTHING;
+            }
+		} else if (
+            instructionType == EXPR_EVAL_INSTRUCTION_TYPE_PUSH_INPUT ||
+            instructionType == EXPR_EVAL_INSTRUCTION_TYPE_PUSH_LOCAL_VAR
+        ) {
+            dependsOn |= DATA_DEPENDS_ON_FLOW_STATE_VALUES;
+        } else if (instructionType == EXPR_EVAL_INSTRUCTION_TYPE_PUSH_OUTPUT) {
+            return DATA_DEPENDS_ON_EVERYTHING;
+        } else {
+            break;
+		}
+	}
+
+    return dependsOn;
+#else
+    return DATA_DEPENDS_ON_EVERYTHING;
+#endif
+}
+
+// Find out which variables are read by the watched expression
+static void findWatchDependencies(WatchListNode *node) {
+    auto component = node->flowState->flow->components[node->componentIndex];
+    if (component->properties.count <= defs_v3::WATCH_VARIABLE_ACTION_COMPONENT_PROPERTY_VARIABLE) {
+        node->dependsOn = DATA_DEPENDS_ON_EVERYTHING;
+        node->numGlobalVariables = 0;
+        return;
+    }
+
+    node->dependsOn = findExpressionDependencies(
+        node->flowState->flowDefinition,
+        component->properties[defs_v3::WATCH_VARIABLE_ACTION_COMPONENT_PROPERTY_VARIABLE]->evalInstructions,
+        node->globalVariables, node->numGlobalVariables, WATCH_MAX_GLOBAL_VARIABLES
+    );
+
+    if (node->dependsOn & DATA_DEPENDS_ON_FLOW_STATE_VALUES) {
+        // watches that read inputs or local variables are evaluated on every tick
+        node->dependsOn = DATA_DEPENDS_ON_EVERYTHING;
+    }
+}
+
+static bool isWatchChanged(WatchListNode *node) {
+    if (node->dependsOn & DATA_DEPENDS_ON_EVERYTHING) {
+        return true;
+    }
+
+    if (node->dependsOn & DATA_DEPENDS_ON_NATIVE_VARIABLES) {
+        if (isChangedSince(g_nativeVariablesVersion, node->version)) {
+            return true;
+        }
+    }
+
+    if (node->dependsOn & DATA_DEPENDS_ON_GLOBAL_VARIABLES) {
+        if (isChangedSince(g_indirectChangeVersion, node->version)) {
+            return true;
+        }
+
+        if (!isChangedSince(g_anyGlobalVariableVersion, node->version)) {
+            return false;
+        }
+
+        if (node->numGlobalVariables > WATCH_MAX_GLOBAL_VARIABLES || !g_globalVariableVersions) {
+            return true;
+        }
+
+        for (unsigned i = 0; i < node->numGlobalVariables; i++) {
+            auto globalVariableIndex = node->globalVariables[i];
+            if (globalVariableIndex >= g_numGlobalVariableVersions || isChangedSince(g_globalVariableVersions[globalVariableIndex], node->version)) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+uint8_t getExpressionDependencies(FlowState *flowState, const uint8_t *instructions) {
+    uint8_t numGlobalVariables;
+    return findExpressionDependencies(flowState->flowDefinition, instructions, nullptr, numGlobalVariables, 0);
+}
+
+uint32_t getDataChangeVersion() {
+    return g_changeVersion;
+}
+
+bool isDataChangedSince(uint8_t dependencies, uint32_t version) {
+    return
+        (dependencies & DATA_DEPENDS_ON_EVERYTHING) ||
+        ((dependencies & DATA_DEPENDS_ON_GLOBAL_VARIABLES) && (isChangedSince(g_anyGlobalVariableVersion, version) || isChangedSince(g_indirectChangeVersion, version))) ||
+        ((dependencies & DATA_DEPENDS_ON_NATIVE_VARIABLES) && isChangedSince(g_nativeVariablesVersion, version)) ||
+        ((dependencies & DATA_DEPENDS_ON_FLOW_STATE_VALUES) && (isChangedSince(g_flowStateValuesVersion, version) || isChangedSince(g_indirectChangeVersion, version)));
+}
+
+void markGlobalVariableChanged(uint32_t globalVariableIndex) {
+    g_anyGlobalVariableVersion = ++g_changeVersion;
+    if (globalVariableIndex < g_numGlobalVariableVersions) {
+        g_globalVariableVersions[globalVariableIndex] = g_changeVersion;
+    }
+}
+
+void markNativeVariableChanged(int nativeVariableId) {
+    EEZ_UNUSED(nativeVariableId);
+    g_nativeVariablesVersion = ++g_changeVersion;
+}
+
+void markValueChanged(FlowState *flowState, const Value *pValue) {
+    if (g_globalVariables && pValue >= g_globalVariables->values && pValue < g_globalVariables->values + g_globalVariables->count) {
+        markGlobalVariableChanged(pValue - g_globalVariables->values);
+        return;
+    }
+
+    if (flowState && pValue >= flowState->values && pValue < flowState->values + flowState->flow->componentInputs.count + flowState->flow->localVariables.count) {
+        // input or local variable of the flow state, watches that read those are not tracked
+        g_flowStateValuesVersion = ++g_changeVersion;
+        return;
+    }
+
+    g_indirectChangeVersion = ++g_changeVersion;
+}
 
 WatchListNode *watchListAdd(FlowState *flowState, unsigned componentIndex) {
     auto node = (WatchListNode *)alloc(sizeof(WatchListNode), 0x00864d67);
@@ -53,6 +258,12 @@ WatchListNode *watchListAdd(FlowState *flowState, unsigned componentIndex) {
     node->flowState = flowState;
     node->componentIndex = componentIndex;
 
+    findWatchDependencies(node);
+    node->version = g_changeVersion;
+    if (node->dependsOn & DATA_DEPENDS_ON_EVERYTHING) {
+        g_numWatchesEvaluatedOnEveryTick++;
+    }
+
     incRefCounterForFlowState(flowState);
     (g_watchList.size)++;
 
@@ -72,6 +283,10 @@ void watchListRemove(WatchListNode *node) {
         g_watchList.last = node->prev;
     }
 
+    if (node->dependsOn & DATA_DEPENDS_ON_EVERYTHING) {
+        g_numWatchesEvaluatedOnEveryTick--;
+    }
+
     free(node);
     g_watchList.size > 0 ? (g_watchList.size)-- : 0;
 }
@@ -80,7 +295,8 @@ void visitWatchList() {
     for (auto node = g_watchList.first; node; ) {
         auto nextNode = node->next;
 
-        if (canExecuteStep(node->flowState, node->componentIndex)) {
+        if (isWatchChanged(node) && canExecuteStep(node->flowState, node->componentIndex)) {
+            node->version = g_changeVersion;
             executeWatchVariableComponent(node->flowState, node->componentIndex);
         }
 
@@ -104,6 +320,28 @@ void watchListReset() {
         watchListRemove(node);
         node = nextNode;
     }
+
+    if (g_globalVariableVersions) {
+        free(g_globalVariableVersions);
+        g_globalVariableVersions = nullptr;
+        g_numGlobalVariableVersions = 0;
+    }
+
+    if (g_globalVariables && g_globalVariables->count > 0) {
+        g_globalVariableVersions = (uint32_t *)alloc(g_globalVariables->count * sizeof(uint32_t), 0x7d2e51b4);
+        if (g_globalVariableVersions) {
+            memset(g_globalVariableVersions, 0, g_globalVariables->count * sizeof(uint32_t));
+            g_numGlobalVariableVersions = g_globalVariables->count;
+        }
+    }
+
+    // g_changeVersion is not reset because versions remembered outside of the watch list
+    // (see isDataChangedSince) must see this as a change of everything
+    ++g_changeVersion;
+    g_anyGlobalVariableVersion = g_changeVersion;
+    g_nativeVariablesVersion = g_changeVersion;
+    g_indirectChangeVersion = g_changeVersion;
+    g_flowStateValuesVersion = g_changeVersion;
 }
 
 void removeWatchesForFlowState(FlowState *flowState) {
@@ -120,5 +358,9 @@ unsigned getWatchListSize() {
     return g_watchList.size;
 }
 
+bool hasWatchesEvaluatedOnEveryTick() {
+    return g_numWatchesEvaluatedOnEveryTick > 0;
+}
+
 } // namespace flow
 } // namespace eez
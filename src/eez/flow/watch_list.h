@@ -12,6 +12,32 @@
 
 #include <eez/flow/private.h>
 
+// When enabled, WatchVariable expression is evaluated only when some of the variables
+// it reads has been changed since the last evaluation, instead of on every tick.
+// Expressions that read inputs, local variables or use operations with a result not
+// determined only by the operands (for example System.getTick) are still evaluated on every tick.
+// GUI subtree skipping and LVGL property bindings use the same tracking, without it they assume
+// that everything has changed. When enabled, native code (custom components, adapters) that writes
+// flow values or array elements in place must call markValueChanged, otherwise watches will not fire.
+#if !defined(EEZ_FLOW_WATCH_CHANGE_TRACKING)
+#define EEZ_FLOW_WATCH_CHANGE_TRACKING 0
+#endif
+
+// Changes of component inputs are tracked only if something checks them with isDataChangedSince
+// (GUI subtree skipping and LVGL property bindings), because inputs are written in the hottest
+// paths of the flow execution (propagateValue, clearInputValue, resetSequenceInputs).
+#if EEZ_FLOW_WATCH_CHANGE_TRACKING && (EEZ_OPTION_GUI_SUBTREE_SKIPPING || defined(EEZ_FOR_LVGL))
+#define EEZ_FLOW_TRACK_INPUT_CHANGES 1
+#else
+#define EEZ_FLOW_TRACK_INPUT_CHANGES 0
+#endif
+
+// When enabled, native variables are considered unchanged until notifyNativeVariableChanged is called,
+// otherwise WatchVariable expressions that read native variables are evaluated on every tick.
+#if !defined(EEZ_FLOW_NATIVE_VARIABLES_CHANGE_NOTIFY)
+#define EEZ_FLOW_NATIVE_VARIABLES_CHANGE_NOTIFY 0
+#endif
+
 namespace eez {
 namespace flow {
 
@@ -24,6 +50,33 @@ void watchListReset();
 
 void removeWatchesForFlowState(FlowState *flowState);
 unsigned getWatchListSize();
+// Some watched expression can't be tracked, so the watch list must be visited on every tick
+bool hasWatchesEvaluatedOnEveryTick();
+
+// Change tracking
+void markGlobalVariableChanged(uint32_t globalVariableIndex);
+void markNativeVariableChanged(int nativeVariableId);
+// Called after value at pValue has been assigned from the flowState.
+// Use nullptr for pValue if it is not known which value has been changed.
+// Native code that modifies array elements in place must also call this, otherwise
+// watches, widgets and LVGL bindings reading that array are not updated.
+void markValueChanged(FlowState *flowState, const Value *pValue);
+
+// Which data, that can be changed, is read by the expression
+static const uint8_t DATA_DEPENDS_ON_EVERYTHING = 1; // not tracked, consider it changed on every tick
+static const uint8_t DATA_DEPENDS_ON_GLOBAL_VARIABLES = 2;
+static const uint8_t DATA_DEPENDS_ON_NATIVE_VARIABLES = 4;
+static const uint8_t DATA_DEPENDS_ON_FLOW_STATE_VALUES = 8; // component inputs and local variables
+
+uint8_t getExpressionDependencies(FlowState *flowState, const uint8_t *instructions);
+uint32_t getDataChangeVersion();
+// Returns true if some of the data given by dependencies has been changed since getDataChangeVersion returned version
+bool isDataChangedSince(uint8_t dependencies, uint32_t version);
+
+#if EEZ_OPTION_GUI
+// dataOperation adds here dependencies of the widget data it reads
+extern uint8_t g_widgetDataDependencies;
+#endif
 
 } // flow
 } // eez
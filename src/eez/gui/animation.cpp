@@ -128,8 +128,9 @@ void animateOpenCloseCallback(float t, VideoBuffer bufferOld, VideoBuffer buffer
         }
     }
 
-    bitBlt(bufferOld, bufferDst, 0, 0, getDisplayWidth() - 1, getDisplayHeight() - 1);
+    bitBltAnimationBackground(bufferOld, bufferDst);
     bitBlt(bufferNew, bufferDst, x1, y1, x2, y2);
+    addAnimationDamage(x1, y1, x2, y2);
 }
 
 void animateOpenClose(const Rect &srcRect, const Rect &dstRect, bool direction) {
@@ -152,7 +153,7 @@ static int g_numRects;
 AnimRect g_animRects[MAX_ANIM_RECTS];
 
 void animateRectsStep(float t, VideoBuffer bufferOld, VideoBuffer bufferNew, VideoBuffer bufferDst) {
-    bitBlt(g_animationState.startBuffer == BUFFER_OLD ? bufferOld : bufferNew, bufferDst, 0, 0, getDisplayWidth() - 1, getDisplayHeight() - 1);
+    bitBltAnimationBackground(g_animationState.startBuffer == BUFFER_OLD ? bufferOld : bufferNew, bufferDst);
 
     float t1 = g_animationState.easingRects(t, 0, 0, 1, 1); // rects
     float t2 = g_animationState.easingOpacity(t, 0, 0, 1, 1); // opacity
@@ -222,6 +223,7 @@ void animateRectsStep(float t, VideoBuffer bufferOld, VideoBuffer bufferNew, Vid
             }
 
             fillRect(bufferDst, x, y, x + w - 1, y + h - 1);
+            addAnimationDamage(x, y, x + w - 1, y + h - 1);
 
             setOpacity(savedOpacity);
         } else {
@@ -326,6 +328,7 @@ void animateRectsStep(float t, VideoBuffer bufferOld, VideoBuffer bufferNew, Vid
             }
 
             bitBlt(buffer, bufferDst, sx, sy, sw, sh, dx, dy, opacity);
+            addAnimationDamage(dx, dy, dx + sw - 1, dy + sh - 1);
         }
     }
 }
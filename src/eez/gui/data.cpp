@@ -26,6 +26,8 @@
 
 #include <eez/gui/gui.h>
 
+#include <eez/flow/watch_list.h>
+
 namespace eez {
 namespace gui {
 
@@ -183,6 +185,12 @@ void setEncoderMode(const WidgetCursor &widgetCursor, int16_t id, EncoderMode en
 
 Value get(const WidgetCursor &widgetCursor, int16_t id) {
     Value value;
+#if EEZ_OPTION_GUI_SUBTREE_SKIPPING
+    if (id > 0) {
+        // native data is not change tracked
+        flow::g_widgetDataDependencies |= flow::DATA_DEPENDS_ON_EVERYTHING;
+    }
+#endif
     DATA_OPERATION_FUNCTION(id, DATA_OPERATION_GET, widgetCursor, value);
     return value;
 }
@@ -392,6 +400,16 @@ Value::YtDataGetValueFunctionPointer ytDataGetGetValueFunc(const WidgetCursor &w
     return value.getYtDataGetValueFunctionPointer();
 }
 
+// optional, data should return Value((void *)func, VALUE_TYPE_POINTER) if it supports batched fetching
+Value::YtDataGetValuesFunctionPointer ytDataGetGetValuesFunc(const WidgetCursor &widgetCursor, int16_t id) {
+    Value value;
+    DATA_OPERATION_FUNCTION(id, DATA_OPERATION_YT_DATA_GET_GET_VALUES_FUNC, widgetCursor, value);
+    if (value.getType() != VALUE_TYPE_POINTER) {
+        return nullptr;
+    }
+    return (Value::YtDataGetValuesFunctionPointer)value.getVoidPointer();
+}
+
 uint8_t ytDataGetGraphUpdateMethod(const WidgetCursor &widgetCursor, int16_t id) {
     Value value;
     DATA_OPERATION_FUNCTION(id, DATA_OPERATION_YT_DATA_GET_GRAPH_UPDATE_METHOD, widgetCursor, value);
@@ -125,7 +125,8 @@ enum DataOperationEnum {
     DATA_OPERATION_GET_X_SCROLL,
 	DATA_OPERATION_GET_SLOT_AND_SUBCHANNEL_INDEX,
 	DATA_OPERATION_IS_MICRO_AMPER_ALLOWED,
-	DATA_OPERATION_IS_AMPER_ALLOWED
+	DATA_OPERATION_IS_AMPER_ALLOWED,
+    DATA_OPERATION_YT_DATA_GET_GET_VALUES_FUNC
 };
 
 int count(const WidgetCursor &widgetCursor, int16_t id);
@@ -194,6 +195,7 @@ struct YtDataGetLabelParams {
 };
 void ytDataGetLabel(const WidgetCursor &widgetCursor, int16_t id, uint8_t valueIndex, char *text, int count);
 Value::YtDataGetValueFunctionPointer ytDataGetGetValueFunc(const WidgetCursor &widgetCursor, int16_t id);
+Value::YtDataGetValuesFunctionPointer ytDataGetGetValuesFunc(const WidgetCursor &widgetCursor, int16_t id);
 uint8_t ytDataGetGraphUpdateMethod(const WidgetCursor &widgetCursor, int16_t id);
 float ytDataGetPeriod(const WidgetCursor &widgetCursor, int16_t id);
 uint8_t *ytDataGetBookmarks(const WidgetCursor &widgetCursor, int16_t id);
@@ -51,6 +51,8 @@ void drawGlyph(const uint8_t *src, uint32_t srcLineOffset, int x, int y, int wid
 
 static const int NUM_BUFFERS = 6;
 
+// Page buffers are full screen sized, page is rendered in absolute coordinates
+// with display stride and only the page rect is composed into the main buffer.
 struct RenderBuffer {
     VideoBuffer bufferPointer;
     VideoBuffer previousBuffer;
@@ -73,6 +75,54 @@ inline void clearDirty() { g_dirty = false; }
 inline void setDirty() { g_dirty = true; }
 inline bool isDirty() { return g_dirty; }
 
+// List of disjoint rectangles (inclusive coordinates) covering changed areas.
+// When there is no more room, rectangle is merged with the one that grows the least.
+struct DamageRegion {
+    static const int MAX_RECTS = 8;
+
+    struct DamageRect {
+        int x1;
+        int y1;
+        int x2;
+        int y2;
+    };
+
+    DamageRect rects[MAX_RECTS];
+    int numRects;
+
+    void clear() { numRects = 0; }
+    void add(int x1, int y1, int x2, int y2);
+    void add(const DamageRegion &region);
+    bool intersects(int x1, int y1, int x2, int y2) const;
+    bool contains(int x1, int y1, int x2, int y2) const;
+};
+
+// Areas drawn in the current frame, in display coordinates
+// (page buffers share display coordinates with the main buffer).
+extern DamageRegion g_damage;
+
+// Areas of g_syncedBuffer changed since the last syncBuffer call,
+// platform can use it to present only what has changed.
+extern DamageRegion g_syncedDamage;
+
+void addDamage(int x1, int y1, int x2, int y2);
+
+// bounding box of the pixels drawn between startPixelsDraw and endPixelsDraw
+extern DamageRegion::DamageRect g_pixelsDamage;
+inline void clearPixelsDamage() {
+    g_pixelsDamage.x1 = g_pixelsDamage.y1 = 0x7FFFFFFF;
+    g_pixelsDamage.x2 = g_pixelsDamage.y2 = -1;
+}
+inline void addPixelDamage(int x, int y) {
+    if (x < g_pixelsDamage.x1) g_pixelsDamage.x1 = x;
+    if (x > g_pixelsDamage.x2) g_pixelsDamage.x2 = x;
+    if (y < g_pixelsDamage.y1) g_pixelsDamage.y1 = y;
+    if (y > g_pixelsDamage.y2) g_pixelsDamage.y2 = y;
+}
+inline void addPixelsDamage() {
+    addDamage(g_pixelsDamage.x1, g_pixelsDamage.y1, g_pixelsDamage.x2, g_pixelsDamage.y2);
+}
+
 extern bool g_screenshotAllocated;
 
 #ifdef GUI_CALC_FPS
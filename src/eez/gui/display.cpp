@@ -52,6 +52,14 @@ VideoBuffer g_renderBuffer;
 VideoBuffer g_animationBuffer1;
 VideoBuffer g_animationBuffer2;
 VideoBuffer g_animationBuffer;
+
+// per animation buffer: areas where the background is out of date
+// and areas drawn over the background in the last step
+static DamageRegion g_animationStaleDamage[2];
+static DamageRegion g_animationDrawnDamage[2];
+static DamageRegion g_animationStepDamage;
+static bool g_animationBackgroundCopied;
+static VideoBuffer g_animationRenderBuffer;
 #endif
 
 bool g_takeScreenshot;
@@ -73,10 +81,23 @@ static const uint16_t *g_colors;
 
 bool g_dirty;
 
+DamageRegion g_damage;
+DamageRegion g_syncedDamage;
+DamageRegion::DamageRect g_pixelsDamage;
+
+// areas changed in the previous frame, i.e. where the buffer we are
+// about to render into is out of date compared to g_syncedBuffer
+static DamageRegion g_previousDamage;
+
 RenderBuffer g_renderBuffers[NUM_BUFFERS];
 static VideoBuffer g_mainBufferPointer;
 static int g_numBuffersToDraw;
 
+// page buffers composed in the previous frame
+static RenderBuffer g_composedBuffers[NUM_BUFFERS];
+static Rect g_composedBackdrops[NUM_BUFFERS];
+static int g_numComposedBuffers;
+
 bool g_screenshotAllocated;
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -111,6 +132,9 @@ void init() {
 #endif
 
     g_syncedBuffer = g_renderBuffer1;
+    g_previousDamage.clear();
+    g_syncedDamage.clear();
+    g_syncedDamage.add(0, 0, getDisplayWidth() - 1, getDisplayHeight() - 1);
     syncBuffer();
 }
 
@@ -214,9 +238,35 @@ static void finishAnimation() {
         bitBlt(g_renderBuffer2, 0, 0, getDisplayWidth() - 1, getDisplayHeight() - 1);
     }
 
+    // both render buffers are now the same
+    g_previousDamage.clear();
+
     g_syncedBuffer = g_renderBuffer1;
+    g_syncedDamage.clear();
+    g_syncedDamage.add(0, 0, getDisplayWidth() - 1, getDisplayHeight() - 1);
     syncBuffer();
 }
+
+static void invalidateAnimationBuffers() {
+    for (int i = 0; i < 2; i++) {
+        g_animationStaleDamage[i].clear();
+        g_animationStaleDamage[i].add(0, 0, getDisplayWidth() - 1, getDisplayHeight() - 1);
+        g_animationDrawnDamage[i].clear();
+    }
+}
+
+void bitBltAnimationBackground(VideoBuffer bufferSrc, VideoBuffer bufferDst) {
+    DamageRegion &staleDamage = g_animationStaleDamage[bufferDst == g_animationBuffer1 ? 0 : 1];
+    for (int i = 0; i < staleDamage.numRects; i++) {
+        auto &rect = staleDamage.rects[i];
+        bitBlt(bufferSrc, bufferDst, rect.x1, rect.y1, rect.x2, rect.y2);
+    }
+    g_animationBackgroundCopied = true;
+}
+
+void addAnimationDamage(int x1, int y1, int x2, int y2) {
+    g_animationStepDamage.add(MAX(x1, 0), MAX(y1, 0), MIN(x2, getDisplayWidth() - 1), MIN(y2, getDisplayHeight() - 1));
+}
 #endif
 
 #if EEZ_OPTION_GUI_ANIMATIONS
@@ -232,6 +282,9 @@ void animate(Buffer startBuffer, void (*callback)(float t, VideoBuffer bufferOld
     g_animationState.callback = callback;
     g_animationState.easingRects = remapOutQuad;
     g_animationState.easingOpacity = remapOutCubic;
+
+    invalidateAnimationBuffers();
+    g_animationRenderBuffer = g_renderBuffer;
 }
 
 static void animateStep() {
@@ -250,12 +303,44 @@ static void animateStep() {
 			g_animationBuffer = g_animationBuffer1;
 		}
 
+        int dstIndex = g_animationBuffer == g_animationBuffer1 ? 0 : 1;
+
+        if (g_renderBuffer != g_animationRenderBuffer) {
+            // render buffers swapped roles (e.g. while screenshot was taken)
+            invalidateAnimationBuffers();
+            g_animationRenderBuffer = g_renderBuffer;
+        } else {
+            // whatever was rendered in this frame is out of date in both animation buffers
+            g_animationStaleDamage[0].add(g_previousDamage);
+            g_animationStaleDamage[1].add(g_previousDamage);
+        }
+
+        g_animationStepDamage.clear();
+        g_animationBackgroundCopied = false;
+
         if (g_renderBuffer == g_renderBuffer1) {
             g_animationState.callback(t, g_renderBuffer2, g_renderBuffer1, g_animationBuffer);
         } else {
             g_animationState.callback(t, g_renderBuffer1, g_renderBuffer2, g_animationBuffer);
         }
 
+        if (g_animationBackgroundCopied) {
+            // changed since the other animation buffer was synced
+            g_syncedDamage = g_animationStaleDamage[dstIndex];
+            g_syncedDamage.add(g_animationDrawnDamage[1 - dstIndex]);
+            g_syncedDamage.add(g_animationStepDamage);
+
+            g_animationStaleDamage[dstIndex] = g_animationStepDamage;
+            g_animationDrawnDamage[dstIndex] = g_animationStepDamage;
+        } else {
+            invalidateAnimationBuffers();
+            g_syncedDamage.clear();
+            g_syncedDamage.add(0, 0, getDisplayWidth() - 1, getDisplayHeight() - 1);
+        }
+
+        // render buffer is not synced during the animation, so it is not out of date
+        g_previousDamage.clear();
+
         g_syncedBuffer = g_animationBuffer;
         syncBuffer();
     } else {
@@ -300,6 +385,7 @@ void update() {
     } else {
 #endif
         g_syncedBuffer = g_renderBuffer;
+        g_syncedDamage = g_previousDamage;
 		syncBuffer();
 
         if (g_takeScreenshot) {
@@ -337,6 +423,93 @@ void releaseScreenshot() {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+static inline bool rectsOverlap(const DamageRegion::DamageRect &a, const DamageRegion::DamageRect &b) {
+    return a.x1 <= b.x2 && b.x1 <= a.x2 && a.y1 <= b.y2 && b.y1 <= a.y2;
+}
+
+static inline DamageRegion::DamageRect rectsUnion(const DamageRegion::DamageRect &a, const DamageRegion::DamageRect &b) {
+    DamageRegion::DamageRect r;
+    r.x1 = MIN(a.x1, b.x1);
+    r.y1 = MIN(a.y1, b.y1);
+    r.x2 = MAX(a.x2, b.x2);
+    r.y2 = MAX(a.y2, b.y2);
+    return r;
+}
+
+static inline int rectArea(const DamageRegion::DamageRect &r) {
+    return (r.x2 - r.x1 + 1) * (r.y2 - r.y1 + 1);
+}
+
+void DamageRegion::add(int x1, int y1, int x2, int y2) {
+    if (x1 > x2 || y1 > y2) {
+        return;
+    }
+
+    DamageRect rect = { x1, y1, x2, y2 };
+
+    // merge with overlapping rects until rect is disjoint with all of them
+    while (true) {
+        int i;
+        for (i = 0; i < numRects; i++) {
+            if (rectsOverlap(rects[i], rect)) {
+                break;
+            }
+        }
+
+        if (i == numRects) {
+            if (numRects < MAX_RECTS) {
+                rects[numRects++] = rect;
+                return;
+            }
+
+            // no more room, merge with the rect which grows the least
+            int minGrowth = 0;
+            for (int j = 0; j < numRects; j++) {
+                int growth = rectArea(rectsUnion(rects[j], rect)) - rectArea(rects[j]);
+                if (j == 0 || growth < minGrowth) {
+                    minGrowth = growth;
+                    i = j;
+                }
+            }
+        }
+
+        rect = rectsUnion(rects[i], rect);
+        rects[i] = rects[--numRects];
+    }
+}
+
+void DamageRegion::add(const DamageRegion &region) {
+    for (int i = 0; i < region.numRects; i++) {
+        add(region.rects[i].x1, region.rects[i].y1, region.rects[i].x2, region.rects[i].y2);
+    }
+}
+
+bool DamageRegion::intersects(int x1, int y1, int x2, int y2) const {
+    DamageRect rect = { x1, y1, x2, y2 };
+    for (int i = 0; i < numRects; i++) {
+        if (rectsOverlap(rects[i], rect)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DamageRegion::contains(int x1, int y1, int x2, int y2) const {
+    for (int i = 0; i < numRects; i++) {
+        if (rects[i].x1 <= x1 && rects[i].y1 <= y1 && rects[i].x2 >= x2 && rects[i].y2 >= y2) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void addDamage(int x1, int y1, int x2, int y2) {
+    g_damage.add(MAX(x1, 0), MAX(y1, 0), MIN(x2, getDisplayWidth() - 1), MIN(y2, getDisplayHeight() - 1));
+    setDirty();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 VideoBuffer getBufferPointer() {
     return g_renderBuffer;
 }
@@ -353,6 +526,7 @@ void beginRendering() {
     }
 
     clearDirty();
+    g_damage.clear();
 
     g_mainBufferPointer = getBufferPointer();
     g_numBuffersToDraw = 0;
@@ -387,6 +561,80 @@ void endBufferRendering(int bufferIndex, int x, int y, int width, int height, bo
     setBufferPointer(renderBuffer.previousBuffer);
 }
 
+static bool isCompositionChanged() {
+    if (g_numBuffersToDraw != g_numComposedBuffers) {
+        return true;
+    }
+
+    for (int bufferIndex = 0; bufferIndex < g_numBuffersToDraw; bufferIndex++) {
+        RenderBuffer &renderBuffer = g_renderBuffers[bufferIndex];
+        RenderBuffer &composedBuffer = g_composedBuffers[bufferIndex];
+
+        if (
+            renderBuffer.x != composedBuffer.x ||
+            renderBuffer.y != composedBuffer.y ||
+            renderBuffer.width != composedBuffer.width ||
+            renderBuffer.height != composedBuffer.height ||
+            renderBuffer.withShadow != composedBuffer.withShadow ||
+            renderBuffer.opacity != composedBuffer.opacity ||
+            renderBuffer.xOffset != composedBuffer.xOffset ||
+            renderBuffer.yOffset != composedBuffer.yOffset ||
+            (renderBuffer.backdrop != nullptr) != (composedBuffer.backdrop != nullptr) ||
+            (renderBuffer.backdrop && *renderBuffer.backdrop != g_composedBackdrops[bufferIndex])
+        ) {
+            return true;
+        }
+
+        // page content is drawn in display coordinates, so damage can't be
+        // tracked for the page buffer moved by the offset
+        if (renderBuffer.xOffset != 0 || renderBuffer.yOffset != 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void getCompositionRegion(DamageRegion &region) {
+    if (isCompositionChanged()) {
+        region.clear();
+        region.add(0, 0, getDisplayWidth() - 1, getDisplayHeight() - 1);
+
+        g_numComposedBuffers = g_numBuffersToDraw;
+        for (int bufferIndex = 0; bufferIndex < g_numBuffersToDraw; bufferIndex++) {
+            g_composedBuffers[bufferIndex] = g_renderBuffers[bufferIndex];
+            if (g_renderBuffers[bufferIndex].backdrop) {
+                g_composedBackdrops[bufferIndex] = *g_renderBuffers[bufferIndex].backdrop;
+            }
+        }
+        return;
+    }
+
+    // changed in this frame or in the previous frame (not yet in this buffer)
+    region = g_damage;
+    region.add(g_previousDamage);
+
+    // shadow is drawn as a whole, so if it needs to be redrawn then everything
+    // below it must be composed again
+    for (bool added = true; added; ) {
+        added = false;
+        for (int bufferIndex = 0; bufferIndex < g_numBuffersToDraw; bufferIndex++) {
+            RenderBuffer &renderBuffer = g_renderBuffers[bufferIndex];
+            if (renderBuffer.withShadow) {
+                int x1 = renderBuffer.x;
+                int y1 = renderBuffer.y;
+                int x2 = x1 + renderBuffer.width - 1;
+                int y2 = y1 + renderBuffer.height - 1;
+                expandRectWithShadow(x1, y1, x2, y2);
+                if (region.intersects(x1, y1, x2, y2) && !region.contains(x1, y1, x2, y2)) {
+                    region.add(x1, y1, x2, y2);
+                    added = true;
+                }
+            }
+        }
+    }
+}
+
 void endRendering() {
     setBufferPointer(g_mainBufferPointer);
 
@@ -409,6 +657,10 @@ void endRendering() {
 #endif
 
     if (isDirty()) {
+        // compose page buffers only inside the damaged region
+        DamageRegion region;
+        getCompositionRegion(region);
+
         for (int bufferIndex = 0; bufferIndex < g_numBuffersToDraw; bufferIndex++) {
             RenderBuffer &renderBuffer = g_renderBuffers[bufferIndex];
 
@@ -424,15 +676,36 @@ void endRendering() {
                 // opacity backdrop
                 auto savedOpacity = setOpacity(CONF_BACKDROP_OPACITY);
                 setColor(COLOR_ID_BACKDROP);
-                fillRect(renderBuffer.backdrop->x, renderBuffer.backdrop->y, renderBuffer.backdrop->x + renderBuffer.backdrop->w - 1, renderBuffer.backdrop->y + renderBuffer.backdrop->h - 1);
+                for (int i = 0; i < region.numRects; i++) {
+                    auto &rect = region.rects[i];
+                    fillRect(
+                        MAX(renderBuffer.backdrop->x, rect.x1),
+                        MAX(renderBuffer.backdrop->y, rect.y1),
+                        MIN(renderBuffer.backdrop->x + renderBuffer.backdrop->w - 1, rect.x2),
+                        MIN(renderBuffer.backdrop->y + renderBuffer.backdrop->h - 1, rect.y2)
+                    );
+                }
                 setOpacity(savedOpacity);
             }
 
             if (renderBuffer.withShadow) {
-                drawShadow(x1, y1, x2, y2);
+                int sx1 = x1, sy1 = y1, sx2 = x2, sy2 = y2;
+                expandRectWithShadow(sx1, sy1, sx2, sy2);
+                if (region.intersects(sx1, sy1, sx2, sy2)) {
+                    drawShadow(x1, y1, x2, y2);
+                }
             }
 
-            bitBlt(g_renderBuffers[bufferIndex].bufferPointer, nullptr, sx, sy, x2 - x1 + 1, y2 - y1 + 1, x1, y1, renderBuffer.opacity);
+            for (int i = 0; i < region.numRects; i++) {
+                auto &rect = region.rects[i];
+                int bx1 = MAX(x1, rect.x1);
+                int by1 = MAX(y1, rect.y1);
+                int bx2 = MIN(x2, rect.x2);
+                int by2 = MIN(y2, rect.y2);
+                if (bx1 <= bx2 && by1 <= by2) {
+                    bitBlt(g_renderBuffers[bufferIndex].bufferPointer, nullptr, sx + bx1 - x1, sy + by1 - y1, bx2 - bx1 + 1, by2 - by1 + 1, bx1, by1, renderBuffer.opacity);
+                }
+            }
         }
 
 #if defined(GUI_CALC_FPS)
@@ -448,12 +721,21 @@ void endRendering() {
 #if OPTION_MOUSE
         mouse::updateDisplay();
 #endif
+
+        // keyboard and mouse cursor are drawn directly into the main buffer
+        region.add(g_damage);
+        g_previousDamage = region;
     } else {
-        if (g_syncedBuffer == g_renderBuffer1) {
-            bitBlt(g_renderBuffer1, 0, 0, getDisplayWidth() - 1, getDisplayHeight() - 1);
-        } else if (g_syncedBuffer == g_renderBuffer2) {
-            bitBlt(g_renderBuffer2, 0, 0, getDisplayWidth() - 1, getDisplayHeight() - 1);
+        // bring render buffer up to date with the synced buffer
+        if (g_syncedBuffer == g_renderBuffer1 || g_syncedBuffer == g_renderBuffer2) {
+            for (int i = 0; i < g_previousDamage.numRects; i++) {
+                auto &rect = g_previousDamage.rects[i];
+                bitBlt(g_syncedBuffer, rect.x1, rect.y1, rect.x2, rect.y2);
+            }
         }
+        g_previousDamage.clear();
+        g_damage.clear();
+        clearDirty();
     }
 }
 
@@ -932,6 +1214,8 @@ void fillRoundedRect(
 #ifdef CONF_FAST_ROUND_RECT
     }
 #endif
+
+    addDamage(x1, y1, x2, y2);
 }
 
 void fillRoundedRect(
@@ -963,9 +1247,7 @@ int8_t measureGlyph(int32_t encoding, gui::font::Font &font) {
     return glyph->dx;
 }
 
-int measureStr(const char *text, int textLength, gui::font::Font &font, int max_width) {
-    g_font = font;
-
+static int measureStrUncached(const char *text, int textLength, int max_width) {
     int width = 0;
 
     if (textLength == -1) {
@@ -999,6 +1281,23 @@ int measureStr(const char *text, int textLength, gui::font::Font &font, int max_
     return width;
 }
 
+int measureStr(const char *text, int textLength, gui::font::Font &font, int max_width) {
+    g_font = font;
+
+#if EEZ_OPTION_GUI_TEXT_MEASURE_CACHE > 0
+    gui::font::TextMeasureCacheKey key;
+    int width;
+    if (gui::font::getCachedTextWidth(font, text, textLength, max_width, key, width)) {
+        return width;
+    }
+    width = measureStrUncached(text, textLength, max_width);
+    gui::font::setCachedTextWidth(key, width);
+    return width;
+#else
+    return measureStrUncached(text, textLength, max_width);
+#endif
+}
+
 void drawStr(const char *text, int textLength, int x, int y, int clip_x1, int clip_y1, int clip_x2, int clip_y2, gui::font::Font &font, int cursorPosition) {
     g_font = font;
 
@@ -1081,7 +1380,7 @@ void drawStr(const char *text, int textLength, int x, int y, int clip_x1, int cl
         fillRect(xCursor - CURSOR_WIDTH / 2, clip_y1 + d, xCursor + CURSOR_WIDTH / 2 - 1, clip_y2 - d);
     }
 
-    setDirty();
+    addDamage(clip_x1, clip_y1, clip_x2, clip_y2);
 }
 
 int getCharIndexAtPosition(int xPos, const char *text, int textLength, int x, int y, int clip_x1, int clip_y1, int clip_x2,int clip_y2, gui::font::Font &font) {
@@ -67,6 +67,13 @@ void update();
 
 #if EEZ_OPTION_GUI_ANIMATIONS
 void animate(Buffer startBuffer, void (*callback)(float t, VideoBuffer bufferOld, VideoBuffer bufferNew, VideoBuffer bufferDst), float duration = -1);
+
+// For use inside the animation callback: copy from bufferSrc only the parts of
+// bufferDst which are out of date, instead of the whole frame, and report every
+// rect the callback draws on top of it. Callbacks that don't call
+// bitBltAnimationBackground are assumed to redraw the whole frame.
+void bitBltAnimationBackground(VideoBuffer bufferSrc, VideoBuffer bufferDst);
+void addAnimationDamage(int x1, int y1, int x2, int y2);
 #endif
 
 void beginRendering();
@@ -114,6 +121,7 @@ void getPixel(int x, int y, uint8_t *r, uint8_t *g, uint8_t *b);
 void startPixelsDraw();
 void drawPixel(int x, int y);
 void drawPixel(int x, int y, uint8_t opacity);
+void drawPixelsVSpan(int x, int y1, int y2); // same as drawPixel(x, y) for y1 <= y <= y2
 void endPixelsDraw();
 void fillRect(int x1, int y1, int x2, int y2);
 void bitBlt(int x1, int y1, int x2, int y2, int x, int y);
@@ -12,20 +12,187 @@
 
 #if EEZ_OPTION_GUI
 
+#include <stdlib.h>
+#include <string.h>
+
+#include <eez/core/alloc.h>
+
 #include <eez/gui/font.h>
 
 namespace eez {
 namespace gui {
 namespace font {
 
+struct GlyphIndex {
+    const FontData *fontData;
+    const GlyphsGroup **sortedGroups;
+    bool groupsSorted;
+};
+
+// Open addressing (linear probing) hash table keyed by font data address,
+// so Font constructor finds the index without going through all the fonts.
+static GlyphIndex *g_glyphIndexes;
+static uint32_t g_glyphIndexesMask;
+static uint32_t g_numGlyphIndexes;
+
+static int compareGroups(const void *a, const void *b) {
+    auto groupA = *(const GlyphsGroup **)a;
+    auto groupB = *(const GlyphsGroup **)b;
+    return groupA->encoding < groupB->encoding ? -1 : groupA->encoding > groupB->encoding ? 1 : 0;
+}
+
+static inline uint32_t getGlyphIndexHash(const FontData *fontData) {
+    auto hash = (uint32_t)((uintptr_t)fontData >> 2) * 2654435761u;
+    return hash ^ (hash >> 16);
+}
+
+// Returns the slot with fontData or the empty slot where it should be added
+static GlyphIndex *findGlyphIndexSlot(GlyphIndex *glyphIndexes, uint32_t mask, const FontData *fontData) {
+    for (uint32_t i = getGlyphIndexHash(fontData) & mask; ; i = (i + 1) & mask) {
+        if (!glyphIndexes[i].fontData || glyphIndexes[i].fontData == fontData) {
+            return glyphIndexes + i;
+        }
+    }
+}
+
+static bool growGlyphIndexes() {
+    uint32_t numSlots = g_glyphIndexes ? 2 * (g_glyphIndexesMask + 1) : 16;
+
+    auto glyphIndexes = (GlyphIndex *)alloc(numSlots * sizeof(GlyphIndex), 0x4b3e9d27);
+    if (!glyphIndexes) {
+        return false;
+    }
+    memset(glyphIndexes, 0, numSlots * sizeof(GlyphIndex));
+
+    if (g_glyphIndexes) {
+        for (uint32_t i = 0; i <= g_glyphIndexesMask; i++) {
+            if (g_glyphIndexes[i].fontData) {
+                *findGlyphIndexSlot(glyphIndexes, numSlots - 1, g_glyphIndexes[i].fontData) = g_glyphIndexes[i];
+            }
+        }
+        free(g_glyphIndexes);
+    }
+
+    g_glyphIndexes = glyphIndexes;
+    g_glyphIndexesMask = numSlots - 1;
+
+    return true;
+}
+
+static GlyphIndex *findGlyphIndex(const FontData *fontData) {
+    if (!g_numGlyphIndexes) {
+        return nullptr;
+    }
+    auto index = findGlyphIndexSlot(g_glyphIndexes, g_glyphIndexesMask, fontData);
+    return index->fontData ? index : nullptr;
+}
+
+// fontData must not be already in the table
+static GlyphIndex *addGlyphIndex(const FontData *fontData) {
+    if (2 * (g_numGlyphIndexes + 1) > (g_glyphIndexes ? g_glyphIndexesMask + 1 : 0) && !growGlyphIndexes()) {
+        return nullptr;
+    }
+
+    auto &index = *findGlyphIndexSlot(g_glyphIndexes, g_glyphIndexesMask, fontData);
+    g_numGlyphIndexes++;
+
+    index.fontData = fontData;
+    index.sortedGroups = nullptr;
+    index.groupsSorted = true;
+
+    auto &groups = fontData->groups;
+    for (uint32_t i = 1; i < groups.count; i++) {
+        if (groups[i]->encoding < groups[i - 1]->encoding) {
+            index.groupsSorted = false;
+            break;
+        }
+    }
+
+    if (!index.groupsSorted) {
+        index.sortedGroups = (const GlyphsGroup **)alloc(groups.count * sizeof(const GlyphsGroup *), 0x91c0f25a);
+        if (index.sortedGroups) {
+            for (uint32_t i = 0; i < groups.count; i++) {
+                index.sortedGroups[i] = groups[i];
+            }
+            qsort(index.sortedGroups, groups.count, sizeof(const GlyphsGroup *), compareGroups);
+        }
+        // else linear search is used
+    }
+
+    return &index;
+}
+
+static void removeGlyphIndex(GlyphIndex *index) {
+    auto mask = g_glyphIndexesMask;
+    uint32_t i = index - g_glyphIndexes;
+
+    // backward shift deletion, so there is no need for tombstones
+    for (uint32_t j = (i + 1) & mask; g_glyphIndexes[j].fontData; j = (j + 1) & mask) {
+        uint32_t k = getGlyphIndexHash(g_glyphIndexes[j].fontData) & mask;
+        if (i <= j ? (k <= i || k > j) : (k <= i && k > j)) {
+            g_glyphIndexes[i] = g_glyphIndexes[j];
+            i = j;
+        }
+    }
+    g_glyphIndexes[i].fontData = nullptr;
+
+    g_numGlyphIndexes--;
+}
+
+void buildGlyphIndex(Assets *assets) {
+    for (uint32_t i = 0; i < assets->fonts.count; i++) {
+        auto fontData = assets->fonts[i];
+        if (!findGlyphIndex(fontData)) {
+            addGlyphIndex(fontData);
+        }
+    }
+}
+
+#if EEZ_OPTION_GUI_TEXT_MEASURE_CACHE > 0
+static void clearTextMeasureCache();
+#endif
+
+void freeGlyphIndex(Assets *assets) {
+    for (uint32_t i = 0; i < assets->fonts.count; i++) {
+        auto index = findGlyphIndex(assets->fonts[i]);
+        if (index) {
+            if (index->sortedGroups) {
+                free(index->sortedGroups);
+            }
+            removeGlyphIndex(index);
+        }
+    }
+
+#if EEZ_OPTION_GUI_TEXT_MEASURE_CACHE > 0
+    // font data memory can be reused by some other font
+    clearTextMeasureCache();
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 Font::Font()
 	: fontData(0)
+	, sortedGroups(nullptr)
+	, groupsSorted(false)
 {
 }
 
 Font::Font(const FontData *fontData_)
 	: fontData(fontData_)
+	, sortedGroups(nullptr)
+	, groupsSorted(false)
 {
+    if (fontData) {
+        auto index = findGlyphIndex(fontData);
+        if (!index) {
+            index = addGlyphIndex(fontData);
+        }
+        if (index) {
+            sortedGroups = index->sortedGroups;
+            groupsSorted = index->groupsSorted;
+        }
+    }
 }
 
 uint8_t Font::getAscent() {
@@ -40,24 +207,48 @@ uint8_t Font::getHeight() {
     return fontData->ascent + fontData->descent;
 }
 
+template<typename Groups>
+static const GlyphsGroup *findGroup(const Groups &groups, uint32_t count, uint32_t encoding) {
+    uint32_t low = 0;
+    uint32_t high = count;
+    while (low < high) {
+        uint32_t mid = (low + high) / 2;
+        auto group = groups[mid];
+        if (encoding < group->encoding) {
+            high = mid;
+        } else if (encoding >= group->encoding + group->length) {
+            low = mid + 1;
+        } else {
+            return group;
+        }
+    }
+    return nullptr;
+}
+
 const GlyphData *Font::getGlyph(int32_t encoding) {
 	auto start = fontData->encodingStart;
 	auto end = fontData->encodingEnd;
 
     uint32_t glyphIndex = 0;
 	if ((uint32_t)encoding < start || (uint32_t)encoding > end) {
-        // TODO use binary search
-        uint32_t i;
-		for (i = 0; i < fontData->groups.count; i++) {
-            auto group = fontData->groups[i];
-            if ((uint32_t)encoding >= group->encoding && (uint32_t)encoding < group->encoding + group->length) {
-                glyphIndex = group->glyphIndex + (encoding - group->encoding);
-                break;
+        const GlyphsGroup *group = nullptr;
+        if (sortedGroups) {
+            group = findGroup(sortedGroups, fontData->groups.count, (uint32_t)encoding);
+        } else if (groupsSorted) {
+            group = findGroup(fontData->groups, fontData->groups.count, (uint32_t)encoding);
+        } else {
+            for (uint32_t i = 0; i < fontData->groups.count; i++) {
+                auto g = fontData->groups[i];
+                if ((uint32_t)encoding >= g->encoding && (uint32_t)encoding < g->encoding + g->length) {
+                    group = g;
+                    break;
+                }
             }
         }
-        if (i == fontData->groups.count) {
+        if (!group) {
             return nullptr;
         }
+        glyphIndex = group->glyphIndex + (encoding - group->encoding);
 	} else {
         glyphIndex = encoding - start;
     }
@@ -72,6 +263,103 @@ const GlyphData *Font::getGlyph(int32_t encoding) {
 	return glyphData;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+
+#if EEZ_OPTION_GUI_TEXT_MEASURE_CACHE > 0
+
+struct TextMeasureCacheEntry {
+    const FontData *fontData;
+    uint32_t hash;
+    int length;
+    int maxWidth;
+    int width;
+    uint32_t lastUsed;
+    char text[TEXT_MEASURE_CACHE_MAX_TEXT_LENGTH];
+};
+
+static TextMeasureCacheEntry g_textMeasureCache[EEZ_OPTION_GUI_TEXT_MEASURE_CACHE];
+static uint32_t g_textMeasureCacheCounter;
+
+static void clearTextMeasureCache() {
+    for (int i = 0; i < EEZ_OPTION_GUI_TEXT_MEASURE_CACHE; i++) {
+        g_textMeasureCache[i].fontData = nullptr;
+    }
+}
+
+bool getCachedTextWidth(Font &font, const char *text, int textLength, int maxWidth, TextMeasureCacheKey &key, int &width) {
+    key.fontData = font.fontData;
+    key.text = text;
+    key.maxWidth = maxWidth;
+
+    // length in bytes and FNV-1a hash, textLength is in code points
+    uint32_t hash = 2166136261u;
+    int length = 0;
+    int numCodePoints = 0;
+    for (; text[length]; length++) {
+        uint8_t c = (uint8_t)text[length];
+        if ((c & 0xC0) != 0x80) {
+            if (numCodePoints == textLength) {
+                break;
+            }
+            numCodePoints++;
+        }
+        if (length == TEXT_MEASURE_CACHE_MAX_TEXT_LENGTH) {
+            key.length = -1;
+            return false;
+        }
+        hash = (hash ^ c) * 16777619u;
+    }
+    key.length = length;
+    key.hash = hash;
+
+    for (int i = 0; i < EEZ_OPTION_GUI_TEXT_MEASURE_CACHE; i++) {
+        auto &entry = g_textMeasureCache[i];
+        if (
+            entry.fontData == key.fontData &&
+            entry.hash == hash &&
+            entry.length == length &&
+            entry.maxWidth == maxWidth &&
+            memcmp(entry.text, text, length) == 0
+        ) {
+            entry.lastUsed = ++g_textMeasureCacheCounter;
+            width = entry.width;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void setCachedTextWidth(const TextMeasureCacheKey &key, int width) {
+    if (key.length == -1) {
+        return;
+    }
+
+    // replace least recently used entry
+    int lruIndex = 0;
+    for (int i = 0; i < EEZ_OPTION_GUI_TEXT_MEASURE_CACHE; i++) {
+        auto &entry = g_textMeasureCache[i];
+        if (!entry.fontData) {
+            lruIndex = i;
+            break;
+        }
+        if ((int32_t)(entry.lastUsed - g_textMeasureCache[lruIndex].lastUsed) < 0) {
+            lruIndex = i;
+        }
+    }
+
+    auto &entry = g_textMeasureCache[lruIndex];
+    entry.fontData = key.fontData;
+    entry.hash = key.hash;
+    entry.length = key.length;
+    entry.maxWidth = key.maxWidth;
+    entry.width = width;
+    entry.lastUsed = ++g_textMeasureCacheCounter;
+    memcpy(entry.text, key.text, key.length);
+}
+
+#endif // EEZ_OPTION_GUI_TEXT_MEASURE_CACHE
+
 } // namespace font
 } // namespace gui
 } // namespace eez
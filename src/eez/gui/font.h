@@ -21,6 +21,11 @@ namespace font {
 struct Font {
     const FontData *fontData;
 
+    // glyph groups sorted by encoding, used for binary search when
+    // fontData->groups are not already sorted
+    const GlyphsGroup *const *sortedGroups;
+    bool groupsSorted;
+
     Font();
     Font(const FontData *fontData_);
 
@@ -35,6 +40,30 @@ struct Font {
     uint8_t getHeight();
 };
 
+// Glyph lookup index is built once per font, for main assets at GUI init
+// and for other fonts (external assets) on first use.
+void buildGlyphIndex(Assets *assets);
+void freeGlyphIndex(Assets *assets);
+
+#if EEZ_OPTION_GUI_TEXT_MEASURE_CACHE > 0
+
+static const int TEXT_MEASURE_CACHE_MAX_TEXT_LENGTH = 32;
+
+struct TextMeasureCacheKey {
+    const FontData *fontData;
+    const char *text;
+    int length; // in bytes, -1 if text is too long to be cached
+    int maxWidth;
+    uint32_t hash;
+};
+
+// LRU cache of (font, text, max width) -> width, so unchanged labels are not
+// measured again in every frame. textLength is number of code points or -1.
+bool getCachedTextWidth(Font &font, const char *text, int textLength, int maxWidth, TextMeasureCacheKey &key, int &width);
+void setCachedTextWidth(const TextMeasureCacheKey &key, int width);
+
+#endif
+
 } // namespace font
 } // namespace gui
 } // namespace eez
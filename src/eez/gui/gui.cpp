@@ -54,6 +54,8 @@ void guiInit() {
     }
 #endif
 
+    font::buildGlyphIndex(g_mainAssets);
+
     if (g_mainAssets->flowDefinition) {
         flow::start(g_mainAssets);
     }
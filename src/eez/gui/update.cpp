@@ -35,6 +35,9 @@ WidgetCursor g_widgetCursor;
 
 void refreshScreen() {
 	g_refreshScreen = true;
+#if EEZ_OPTION_GUI_TOUCH_INDEX
+	invalidateTouchIndex();
+#endif
 }
 
 void updateScreen() {
@@ -89,7 +92,16 @@ void updateScreen() {
     g_widgetCursor.h = g_rootWidget->height;
 
     if (g_mainAssets->assetsType != ASSETS_TYPE_DASHBOARD) {
+#if EEZ_OPTION_GUI_SUBTREE_SKIPPING
+        updateGuiStateVersion();
+#endif
+#if EEZ_OPTION_GUI_TOUCH_INDEX
+        beginTouchIndex();
         enumWidget();
+        endTouchIndex();
+#else
+        enumWidget();
+#endif
     }
 
 	g_widgetStateEnd = g_widgetCursor.currentState;
@@ -24,6 +24,7 @@
 #include <eez/core/assets.h>
 
 #include <eez/gui/draw.h>
+#include <eez/gui/display-private.h>
 
 #include <eez/gui/widgets/containers/app_view.h>
 #include <eez/gui/widgets/containers/container.h>
@@ -56,6 +57,8 @@
 #include <eez/gui/widgets/line_chart.h>
 #include <eez/gui/widgets/qr_code.h>
 
+#include <eez/flow/watch_list.h>
+
 namespace eez {
 namespace gui {
 
@@ -158,7 +161,99 @@ void WidgetCursor::popBackground() {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+#if EEZ_OPTION_GUI_TOUCH_INDEX
+static const uint16_t TOUCH_INDEX_NONE = 0xFFFF;
+static int getTouchIndexSize();
+static void addToTouchIndex(const WidgetCursor &widgetCursor);
+static void addSkippedToTouchIndex(int first, int count);
+#endif
+
+#if EEZ_OPTION_GUI_SUBTREE_SKIPPING
+
+// Container subtree is skipped, i.e. neither updateState nor render is called for its widgets,
+// if it wasn't changed since it was enumerated last time. This is the case if:
+//   - subtree contains only the widgets whose state depends only on the data and
+//     g_activeWidget/g_isBlinkTime (see isSkippableWidgetType),
+//   - all the data read is flow data which is change tracked (see flow::isDataChangedSince),
+//     nothing of it is changed, and g_activeWidget/g_isBlinkTime are also not changed,
+//   - container position, size and flow timeline position are the same.
+// Focus and style overrides done by the hooks are not tracked, refreshScreen() must be called when those are changed.
+
+static uint32_t g_guiStateVersion;
+
+void updateGuiStateVersion() {
+    static WidgetCursor g_lastActiveWidget;
+    static bool g_lastIsBlinkTime;
+
+    if (g_activeWidget != g_lastActiveWidget || g_isBlinkTime != g_lastIsBlinkTime) {
+        g_lastActiveWidget = g_activeWidget;
+        g_lastIsBlinkTime = g_isBlinkTime;
+        g_guiStateVersion++;
+    }
+}
+
+static bool isSkippableWidgetType(const Widget *widget) {
+    switch (widget->type) {
+    case WIDGET_TYPE_CONTAINER:
+        return ((const ContainerWidget *)widget)->overlay == DATA_ID_NONE;
+    case WIDGET_TYPE_TEXT:
+    case WIDGET_TYPE_MULTILINE_TEXT:
+    case WIDGET_TYPE_RECTANGLE:
+    case WIDGET_TYPE_BITMAP:
+    case WIDGET_TYPE_BUTTON:
+    case WIDGET_TYPE_TOGGLE_BUTTON:
+    case WIDGET_TYPE_PROGRESS:
+    case WIDGET_TYPE_GAUGE:
+    case WIDGET_TYPE_QR_CODE:
+        // native data is not change tracked
+        return widget->data <= 0;
+    default:
+        return false;
+    }
+}
+
+static float getTimelinePosition(const WidgetCursor &widgetCursor) {
+    return widgetCursor.flowState ? widgetCursor.flowState->timelinePosition : 0;
+}
+
+static bool canSkipSubtree(const WidgetCursor &widgetCursor, ContainerWidgetState *containerState) {
+    if (containerState->subtreeStateSize == 0 || widgetCursor.refreshed) {
+        return false;
+    }
+
+    if (
+        containerState->widget != widgetCursor.widget ||
+        containerState->flowState != widgetCursor.flowState ||
+        containerState->cursor != widgetCursor.cursor
+    ) {
+        return false;
+    }
+
+    for (size_t i = 0; i < MAX_ITERATORS; i++) {
+        if (containerState->iterators[i] != widgetCursor.iterators[i]) {
+            return false;
+        }
+    }
+
+#if EEZ_OPTION_GUI_TOUCH_INDEX
+    // entries of the skipped subtree must stay at the same position in the touch index
+    if (getTouchIndexSize() != -1 && getTouchIndexSize() != containerState->touchIndexFirst) {
+        return false;
+    }
+#endif
+
+    return
+        containerState->guiStateVersion == g_guiStateVersion &&
+        containerState->x == widgetCursor.x && containerState->y == widgetCursor.y &&
+        containerState->w == widgetCursor.w && containerState->h == widgetCursor.h &&
+        containerState->timelinePosition == getTimelinePosition(widgetCursor) &&
+        !flow::isDataChangedSince(containerState->dataDependencies, containerState->dataChangeVersion);
+}
+
+#endif // EEZ_OPTION_GUI_SUBTREE_SKIPPING
+
 #define RENDER_WIDGET() \
+    display::addDamage(widgetCursor.x, widgetCursor.y, widgetCursor.x + widgetCursor.w - 1, widgetCursor.y + widgetCursor.h - 1); \
     if ((!widget->visible || widgetState->isVisible.toBool()) && widgetCursor.opacity > 0) { \
         auto savedOpacity = display::setOpacity(widgetCursor.opacity); \
         widgetState->render(); \
@@ -180,11 +275,47 @@ void enumWidget() {
 	bool savedIsActiveWidget = g_isActiveWidget;
 	g_isActiveWidget = g_isActiveWidget || widgetCursor == g_activeWidget;
 
+#if EEZ_OPTION_GUI_SUBTREE_SKIPPING
+    bool isContainer = false;
+	uint8_t savedDataDependencies = 0;
+    uint32_t dataChangeVersion = 0;
+#if EEZ_OPTION_GUI_TOUCH_INDEX
+    int touchIndexFirst = 0;
+#endif
+#endif
+
 	if (g_findCallback) {
         if (!widget->visible || widgetState->isVisible.toBool()) {
     		g_findCallback();
         }
 	} else {
+#if EEZ_OPTION_GUI_SUBTREE_SKIPPING
+        if (!isSkippableWidgetType(widget)) {
+            flow::g_widgetDataDependencies |= flow::DATA_DEPENDS_ON_EVERYTHING;
+        } else if (widget->type == WIDGET_TYPE_CONTAINER) {
+            auto containerState = (ContainerWidgetState *)widgetState;
+
+            if (widgetCursor.hasPreviousState && widget->type == widgetState->type && canSkipSubtree(widgetCursor, containerState)) {
+                widgetCursor.currentState = (WidgetState *)((uint8_t *)widgetState + containerState->subtreeStateSize);
+                flow::g_widgetDataDependencies |= containerState->dataDependencies;
+#if EEZ_OPTION_GUI_TOUCH_INDEX
+                addSkippedToTouchIndex(containerState->touchIndexFirst, containerState->touchIndexCount);
+#endif
+                g_isActiveWidget = savedIsActiveWidget;
+                return;
+            }
+
+            // collect dependencies of this subtree
+            isContainer = true;
+            savedDataDependencies = flow::g_widgetDataDependencies;
+            flow::g_widgetDataDependencies = 0;
+            dataChangeVersion = flow::getDataChangeVersion();
+#if EEZ_OPTION_GUI_TOUCH_INDEX
+            touchIndexFirst = getTouchIndexSize();
+#endif
+        }
+#endif
+
 		if (widgetCursor.hasPreviousState && widget->type == widgetState->type) {
             // reuse existing widget state
             bool refresh = widgetState->updateState();
@@ -215,17 +346,62 @@ void enumWidget() {
 				}
 			}
 		}
+
+#if EEZ_OPTION_GUI_TOUCH_INDEX
+        if (!widget->visible || widgetState->isVisible.toBool()) {
+            addToTouchIndex(widgetCursor);
+        }
+#endif
 	}
 
 	widgetCursor.currentState = (WidgetState *)((uint8_t *)widgetCursor.currentState + g_widgetStateSizes[widget->type]);
 
 	uint32_t stateSize = (uint8_t *)widgetCursor.currentState - (uint8_t *)g_widgetStateStart;
 	if (stateSize > GUI_STATE_BUFFER_SIZE) {
+#if EEZ_OPTION_GUI_SUBTREE_SKIPPING
+        flow::g_widgetDataDependencies = flow::DATA_DEPENDS_ON_EVERYTHING;
+#endif
         return;
     }
 
 	widgetState->enumChildren();
 
+#if EEZ_OPTION_GUI_SUBTREE_SKIPPING
+    if (isContainer) {
+        auto containerState = (ContainerWidgetState *)widgetState;
+        auto dataDependencies = flow::g_widgetDataDependencies;
+
+        if (dataDependencies & flow::DATA_DEPENDS_ON_EVERYTHING) {
+            containerState->subtreeStateSize = 0;
+        } else {
+            containerState->subtreeStateSize = (uint8_t *)widgetCursor.currentState - (uint8_t *)widgetState;
+            containerState->widget = widget;
+            containerState->flowState = widgetCursor.flowState;
+            containerState->cursor = widgetCursor.cursor;
+            for (size_t i = 0; i < MAX_ITERATORS; i++) {
+                containerState->iterators[i] = widgetCursor.iterators[i];
+            }
+            containerState->dataChangeVersion = dataChangeVersion;
+            containerState->guiStateVersion = g_guiStateVersion;
+            containerState->timelinePosition = getTimelinePosition(widgetCursor);
+            containerState->dataDependencies = dataDependencies;
+#if EEZ_OPTION_GUI_TOUCH_INDEX
+            int touchIndexSize = getTouchIndexSize();
+            if (touchIndexFirst >= 0 && touchIndexSize >= 0) {
+                containerState->touchIndexFirst = touchIndexFirst;
+                containerState->touchIndexCount = touchIndexSize - touchIndexFirst;
+            } else {
+                // touch index will be invalid if this subtree is skipped
+                containerState->touchIndexFirst = TOUCH_INDEX_NONE;
+                containerState->touchIndexCount = 0;
+            }
+#endif
+        }
+
+        flow::g_widgetDataDependencies = dataDependencies | savedDataDependencies;
+    }
+#endif
+
 	g_isActiveWidget = savedIsActiveWidget;
 }
 
@@ -285,6 +461,21 @@ int g_yOverlayOffset = 0;
 
 static AppContext *g_popPageAppContext;
 
+// small widgets are easier to hit if touch area is at least MIN_SIZE x MIN_SIZE
+static void expandTouchArea(int &x, int &y, int &w, int &h) {
+    static const int MIN_SIZE = 50;
+
+    if (w < MIN_SIZE) {
+        x = x - (MIN_SIZE - w) / 2;
+        w = MIN_SIZE;
+    }
+
+    if (h < MIN_SIZE) {
+        y = y - (MIN_SIZE - h) / 2;
+        h = MIN_SIZE;
+    }
+}
+
 static void findWidgetStep() {
 	if (g_found) {
 		return;
@@ -339,19 +530,9 @@ static void findWidgetStep() {
 		g_yOverlayOffset = 0;
 	}
 
-    static const int MIN_SIZE = 50;
-
     int w = overlay ? overlay->width : widgetCursor.w;
-    if (w < MIN_SIZE) {
-        x = x - (MIN_SIZE - w) / 2;
-        w = MIN_SIZE;
-    }
-
     int h = overlay ? overlay->height : widgetCursor.h;
-    if (h < MIN_SIZE) {
-        y = y - (MIN_SIZE - h) / 2;
-        h = MIN_SIZE;
-    }
+    expandTouchArea(x, y, w, h);
 
     bool inside =
         g_findWidgetAtX >= x && g_findWidgetAtX < x + w &&
@@ -392,6 +573,218 @@ static void findWidgetStep() {
     }
 }
 
+#if EEZ_OPTION_GUI_TOUCH_INDEX
+
+// Visible widgets are recorded in enumeration order during the render pass and
+// bucketed by their touch area into a uniform grid. findWidget then replays
+// findWidgetStep only for the widgets in the grid cell under the touch point,
+// so the result is the same as with the full widget tree walk. Pages, overlays
+// and the first widget of each AppContext are always replayed because
+// findWidgetStep uses them regardless of the touch point.
+
+static const int TOUCH_INDEX_GRID_SIZE = 8;
+static const int TOUCH_INDEX_MASK_SIZE = (EEZ_OPTION_GUI_TOUCH_INDEX + 31) / 32;
+
+struct TouchIndexEntry {
+	Assets *assets;
+	AppContext *appContext;
+    const Widget *widget;
+    Cursor cursor;
+	int32_t iterators[MAX_ITERATORS];
+    flow::FlowState *flowState;
+    int16_t x;
+    int16_t y;
+    int16_t w;
+    int16_t h;
+    uint8_t opacity;
+	WidgetState *currentState;
+};
+
+struct TouchIndex {
+    TouchIndexEntry entries[EEZ_OPTION_GUI_TOUCH_INDEX];
+    uint32_t cells[TOUCH_INDEX_GRID_SIZE * TOUCH_INDEX_GRID_SIZE][TOUCH_INDEX_MASK_SIZE];
+    uint32_t always[TOUCH_INDEX_MASK_SIZE];
+    int numEntries;
+    int cellWidth;
+    int cellHeight;
+};
+
+static TouchIndex *g_touchIndex;
+static bool g_touchIndexRecording;
+static bool g_touchIndexValid;
+
+void beginTouchIndex() {
+    g_touchIndexValid = false;
+
+    if (!g_touchIndex) {
+        g_touchIndex = (TouchIndex *)alloc(sizeof(TouchIndex), 0x7c2e5a91);
+        if (!g_touchIndex) {
+            g_touchIndexRecording = false;
+            return;
+        }
+    }
+
+    g_touchIndex->numEntries = 0;
+    g_touchIndex->cellWidth = (display::getDisplayWidth() + TOUCH_INDEX_GRID_SIZE - 1) / TOUCH_INDEX_GRID_SIZE;
+    g_touchIndex->cellHeight = (display::getDisplayHeight() + TOUCH_INDEX_GRID_SIZE - 1) / TOUCH_INDEX_GRID_SIZE;
+    memset(g_touchIndex->cells, 0, sizeof(g_touchIndex->cells));
+    memset(g_touchIndex->always, 0, sizeof(g_touchIndex->always));
+
+    g_touchIndexRecording = true;
+}
+
+void endTouchIndex() {
+    // not valid if some widget didn't fit into the index
+    g_touchIndexValid = g_touchIndexRecording;
+    g_touchIndexRecording = false;
+}
+
+void invalidateTouchIndex() {
+    g_touchIndexValid = false;
+}
+
+static int getTouchIndexCell(int value, int cellSize) {
+    int cell = value / cellSize;
+    return value < 0 ? 0 : cell >= TOUCH_INDEX_GRID_SIZE ? TOUCH_INDEX_GRID_SIZE - 1 : cell;
+}
+
+static void addTouchIndexEntryToGrid(int i) {
+    auto touchIndex = g_touchIndex;
+    auto &entry = touchIndex->entries[i];
+
+    uint32_t bit = 1u << (i % 32);
+    int word = i / 32;
+
+    auto widget = entry.widget;
+    if (
+        (widget->type == WIDGET_TYPE_CONTAINER && (((const ContainerWidget *)widget)->flags & PAGE_CONTAINER) != 0) ||
+        (widget->type == WIDGET_TYPE_CONTAINER && ((const ContainerWidget *)widget)->overlay != DATA_ID_NONE) ||
+        i == 0 ||
+        touchIndex->entries[i - 1].appContext != entry.appContext
+    ) {
+        touchIndex->always[word] |= bit;
+        return;
+    }
+
+    int x = entry.x;
+    int y = entry.y;
+    int w = entry.w;
+    int h = entry.h;
+    expandTouchArea(x, y, w, h);
+
+    int col1 = getTouchIndexCell(x, touchIndex->cellWidth);
+    int col2 = getTouchIndexCell(x + w - 1, touchIndex->cellWidth);
+    int row1 = getTouchIndexCell(y, touchIndex->cellHeight);
+    int row2 = getTouchIndexCell(y + h - 1, touchIndex->cellHeight);
+
+    for (int row = row1; row <= row2; row++) {
+        for (int col = col1; col <= col2; col++) {
+            touchIndex->cells[row * TOUCH_INDEX_GRID_SIZE + col][word] |= bit;
+        }
+    }
+}
+
+static void addToTouchIndex(const WidgetCursor &widgetCursor) {
+    if (!g_touchIndexRecording) {
+        return;
+    }
+
+    auto touchIndex = g_touchIndex;
+
+    int i = touchIndex->numEntries;
+    if (i == EEZ_OPTION_GUI_TOUCH_INDEX) {
+        g_touchIndexRecording = false;
+        return;
+    }
+    touchIndex->numEntries++;
+
+    auto &entry = touchIndex->entries[i];
+    entry.assets = widgetCursor.assets;
+    entry.appContext = widgetCursor.appContext;
+    entry.widget = widgetCursor.widget;
+    entry.cursor = widgetCursor.cursor;
+    for (size_t j = 0; j < MAX_ITERATORS; j++) {
+        entry.iterators[j] = widgetCursor.iterators[j];
+    }
+    entry.flowState = widgetCursor.flowState;
+    entry.x = widgetCursor.x;
+    entry.y = widgetCursor.y;
+    entry.w = widgetCursor.w;
+    entry.h = widgetCursor.h;
+    entry.opacity = widgetCursor.opacity;
+    entry.currentState = widgetCursor.currentState;
+
+    addTouchIndexEntryToGrid(i);
+}
+
+static int getTouchIndexSize() {
+    return g_touchIndexRecording ? g_touchIndex->numEntries : -1;
+}
+
+// Entries of the skipped subtree recorded in some previous frame are still valid
+// if they are at the same position in the index
+static void addSkippedToTouchIndex(int first, int count) {
+    if (!g_touchIndexRecording) {
+        return;
+    }
+
+    auto touchIndex = g_touchIndex;
+
+    if (first != touchIndex->numEntries) {
+        g_touchIndexRecording = false;
+        return;
+    }
+
+    touchIndex->numEntries += count;
+
+    for (int i = first; i < first + count; i++) {
+        addTouchIndexEntryToGrid(i);
+    }
+}
+
+static void findWidgetInTouchIndex() {
+    auto touchIndex = g_touchIndex;
+
+    int col = getTouchIndexCell(g_findWidgetAtX, touchIndex->cellWidth);
+    int row = getTouchIndexCell(g_findWidgetAtY, touchIndex->cellHeight);
+    auto cell = touchIndex->cells[row * TOUCH_INDEX_GRID_SIZE + col];
+
+    WidgetCursor &widgetCursor = g_widgetCursor;
+
+    for (int word = 0; word < TOUCH_INDEX_MASK_SIZE && !g_found; word++) {
+        uint32_t mask = cell[word] | touchIndex->always[word];
+        for (int i = word * 32; mask && !g_found; i++, mask >>= 1) {
+            if (!(mask & 1)) {
+                continue;
+            }
+
+            auto &entry = touchIndex->entries[i];
+
+            widgetCursor = WidgetCursor();
+            widgetCursor.assets = entry.assets;
+            widgetCursor.appContext = entry.appContext;
+            widgetCursor.widget = entry.widget;
+            widgetCursor.cursor = entry.cursor;
+            for (size_t j = 0; j < MAX_ITERATORS; j++) {
+                widgetCursor.iterators[j] = entry.iterators[j];
+            }
+            widgetCursor.flowState = entry.flowState;
+            widgetCursor.x = entry.x;
+            widgetCursor.y = entry.y;
+            widgetCursor.w = entry.w;
+            widgetCursor.h = entry.h;
+            widgetCursor.opacity = entry.opacity;
+            widgetCursor.currentState = entry.currentState;
+            widgetCursor.refreshed = false;
+            widgetCursor.hasPreviousState = true;
+
+            findWidgetStep();
+        }
+    }
+}
+
+#endif // EEZ_OPTION_GUI_TOUCH_INDEX
+
 WidgetCursor findWidget(int16_t x, int16_t y, bool clicked) {
 	g_found = false;
     g_foundWidget = 0;
@@ -405,7 +798,15 @@ WidgetCursor findWidget(int16_t x, int16_t y, bool clicked) {
 
     g_popPageAppContext = nullptr;
 
+#if EEZ_OPTION_GUI_TOUCH_INDEX
+    if (g_touchIndexValid) {
+        findWidgetInTouchIndex();
+    } else {
+        forEachWidget(findWidgetStep);
+    }
+#else
     forEachWidget(findWidgetStep);
+#endif
 
     if (g_popPageAppContext) {
         g_popPageAppContext->popPage();
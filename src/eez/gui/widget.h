@@ -271,6 +271,16 @@ void forEachWidget(EnumWidgetsCallback callback);
 
 WidgetCursor findWidget(int16_t x, int16_t y, bool clicked = true);
 
+#if EEZ_OPTION_GUI_SUBTREE_SKIPPING
+void updateGuiStateVersion();
+#endif
+
+#if EEZ_OPTION_GUI_TOUCH_INDEX
+void beginTouchIndex();
+void endTouchIndex();
+void invalidateTouchIndex();
+#endif
+
 typedef void (*OnTouchFunctionType)(const WidgetCursor &widgetCursor, Event &touchEvent);
 OnTouchFunctionType getWidgetTouchFunction(const WidgetCursor &widgetCursor);
 
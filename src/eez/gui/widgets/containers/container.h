@@ -43,6 +43,24 @@ struct ContainerWidgetState : public WidgetState {
 	bool repainted;
     int offsetPrevious;
 
+#if EEZ_OPTION_GUI_SUBTREE_SKIPPING
+    // recorded by enumWidget when subtree was enumerated, used to skip it while nothing it depends on is changed
+    uint32_t subtreeStateSize; // 0 if subtree can't be skipped
+    // widget state can be reused for the different widget or list item
+    const Widget *widget;
+    flow::FlowState *flowState;
+    Cursor cursor;
+    int32_t iterators[MAX_ITERATORS];
+    uint32_t dataChangeVersion;
+    uint32_t guiStateVersion;
+    float timelinePosition;
+    uint8_t dataDependencies;
+#if EEZ_OPTION_GUI_TOUCH_INDEX
+    uint16_t touchIndexFirst;
+    uint16_t touchIndexCount;
+#endif
+#endif
+
     bool updateState() override;
 	void render() override;
 	void enumChildren() override;
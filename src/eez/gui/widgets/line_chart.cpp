@@ -83,6 +83,23 @@ void calcAutoTicks(Axis &axis) {
     axis.ticksDelta = delta;
 }
 
+// Visits chart points in order. If block callback returns true, all points of the block
+// are considered as visited, otherwise each point of the block is visited individually.
+template <typename PointCallback, typename BlockCallback>
+static void forEachPoint(flow::LineChartWidgetComponenentExecutionState *executionState, PointCallback pointCallback, BlockCallback blockCallback) {
+    for (uint32_t i = 0; i < executionState->numPoints; ) {
+        uint32_t pointIndex = (executionState->startPointIndex + i) % executionState->maxPoints;
+
+        auto blockIndex = executionState->getBlockIndex(pointIndex, executionState->numPoints - i);
+        if (blockIndex != -1 && blockCallback(blockIndex, pointIndex)) {
+            i += executionState->getBlockLength(blockIndex);
+        } else {
+            pointCallback(pointIndex);
+            i++;
+        }
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 bool LineChartWidgetState::updateState() {
@@ -162,25 +179,42 @@ void LineChartWidgetState::render() {
         chart.yAxis.min = FLT_MAX;
         chart.yAxis.max = -FLT_MAX;
 
-        for (uint32_t i = 0; i < executionState->numPoints; i++) {
-            uint32_t pointIndex = (executionState->startPointIndex + i) % executionState->maxPoints;
+        chart.xAxis.valueType = executionState->getXType(executionState->startPointIndex) == VALUE_TYPE_DATE ? AXIS_VALUE_TYPE_DATE : AXIS_VALUE_TYPE_NUMBER;
 
-            Value xValue = executionState->getX(pointIndex);
-            auto x = xValue.toDouble(nullptr);
-            if (x < chart.xAxis.min) chart.xAxis.min = x;
-            if (x > chart.xAxis.max) chart.xAxis.max = x;
-            if (i == 0) {
-                chart.xAxis.valueType = xValue.getType() == VALUE_TYPE_DATE ? AXIS_VALUE_TYPE_DATE : AXIS_VALUE_TYPE_NUMBER;
-            }
+        bool yAxisFloating = widget->yAxisRangeOption == Y_AXIS_RANGE_OPTION_FLOATING;
+
+        forEachPoint(
+            executionState,
+            [&](uint32_t pointIndex) {
+                auto x = executionState->getXDouble(pointIndex);
+                if (x < chart.xAxis.min) chart.xAxis.min = x;
+                if (x > chart.xAxis.max) chart.xAxis.max = x;
 
-            if (widget->yAxisRangeOption == Y_AXIS_RANGE_OPTION_FLOATING) {
-                for (uint32_t lineIndex = 0; lineIndex < executionState->numLines; lineIndex++) {
-                    auto y = executionState->getY(pointIndex, lineIndex);
-                    if (y < chart.yAxis.min) chart.yAxis.min = y;
-                    if (y > chart.yAxis.max) chart.yAxis.max = y;
+                if (yAxisFloating) {
+                    for (uint32_t lineIndex = 0; lineIndex < executionState->numLines; lineIndex++) {
+                        auto y = executionState->getY(pointIndex, lineIndex);
+                        if (y < chart.yAxis.min) chart.yAxis.min = y;
+                        if (y > chart.yAxis.max) chart.yAxis.max = y;
+                    }
+                }
+            },
+            [&](int blockIndex, uint32_t) {
+                auto &block = executionState->getBlock(blockIndex);
+                if (block.xMin < chart.xAxis.min) chart.xAxis.min = block.xMin;
+                if (block.xMax > chart.xAxis.max) chart.xAxis.max = block.xMax;
+
+                if (yAxisFloating) {
+                    for (uint32_t lineIndex = 0; lineIndex < executionState->numLines; lineIndex++) {
+                        auto yMin = executionState->getBlockYMin(blockIndex, lineIndex);
+                        auto yMax = executionState->getBlockYMax(blockIndex, lineIndex);
+                        if (yMin < chart.yAxis.min) chart.yAxis.min = yMin;
+                        if (yMax > chart.yAxis.max) chart.yAxis.max = yMax;
+                    }
                 }
+
+                return true;
             }
-        }
+        );
 
         if (widget->yAxisRangeOption == Y_AXIS_RANGE_OPTION_FIXED) {
             chart.yAxis.min = yAxisRangeFrom.toDouble();
@@ -557,21 +591,98 @@ void LineChartWidgetState::render() {
 
     	startPixelsDraw();
 
+        // When there are much more points than pixels and points are sorted by x,
+        // only first, min, max and last value of each pixel column is drawn.
+        bool decimate = executionState->numXDescents == 0 && executionState->numPoints > 2 * (uint32_t)MAX(gridRect.w, 1);
+
         for (uint32_t lineIndex = 0; lineIndex < executionState->numLines; lineIndex++) {
             graphics.resetPath();
 
-            for (uint32_t i = 0; i < executionState->numPoints; i++) {
-                uint32_t pointIndex = (executionState->startPointIndex + i) % executionState->maxPoints;
+            if (decimate) {
+                bool firstVertex = true;
+                auto addVertex = [&](double x, float value) {
+                    auto y = chart.yAxis.offset + value * chart.yAxis.scale;
+                    if (firstVertex) {
+                        graphics.moveTo(x, y);
+                        firstVertex = false;
+                    } else {
+                        graphics.lineTo(x, y);
+                    }
+                };
+
+                bool hasColumn = false;
+                int column = 0;
+                float columnFirst = 0, columnMin = 0, columnMax = 0, columnLast = 0;
+
+                auto flushColumn = [&]() {
+                    auto x = column + 0.5;
+                    addVertex(x, columnFirst);
+                    addVertex(x, columnMin);
+                    addVertex(x, columnMax);
+                    addVertex(x, columnLast);
+                };
+
+                auto addToColumn = [&](int newColumn, float first, float min, float max, float last) {
+                    if (!hasColumn || newColumn != column) {
+                        if (hasColumn) {
+                            flushColumn();
+                        }
+                        hasColumn = true;
+                        column = newColumn;
+                        columnFirst = first;
+                        columnMin = min;
+                        columnMax = max;
+                    } else {
+                        if (min < columnMin) columnMin = min;
+                        if (max > columnMax) columnMax = max;
+                    }
+                    columnLast = last;
+                };
+
+                auto getColumn = [&](double x) {
+                    return (int)floor(chart.xAxis.offset + x * chart.xAxis.scale);
+                };
+
+                forEachPoint(
+                    executionState,
+                    [&](uint32_t pointIndex) {
+                        auto y = executionState->getY(pointIndex, lineIndex);
+                        addToColumn(getColumn(executionState->getXDouble(pointIndex)), y, y, y, y);
+                    },
+                    [&](int blockIndex, uint32_t pointIndex) {
+                        auto &block = executionState->getBlock(blockIndex);
+                        auto blockColumn = getColumn(block.xMin);
+                        if (getColumn(block.xMax) != blockColumn) {
+                            return false;
+                        }
 
-                Value xValue = executionState->getX(pointIndex);
-                auto x = chart.xAxis.offset + xValue.toDouble(nullptr) * chart.xAxis.scale;
+                        auto lastPointIndex = pointIndex + executionState->getBlockLength(blockIndex) - 1;
+                        addToColumn(
+                            blockColumn,
+                            executionState->getY(pointIndex, lineIndex),
+                            executionState->getBlockYMin(blockIndex, lineIndex),
+                            executionState->getBlockYMax(blockIndex, lineIndex),
+                            executionState->getY(lastPointIndex, lineIndex)
+                        );
+                        return true;
+                    }
+                );
+
+                if (hasColumn) {
+                    flushColumn();
+                }
+            } else {
+                for (uint32_t i = 0; i < executionState->numPoints; i++) {
+                    uint32_t pointIndex = (executionState->startPointIndex + i) % executionState->maxPoints;
 
-                auto y = chart.yAxis.offset + executionState->getY(pointIndex, lineIndex) * chart.yAxis.scale;
+                    auto x = chart.xAxis.offset + executionState->getXDouble(pointIndex) * chart.xAxis.scale;
+                    auto y = chart.yAxis.offset + executionState->getY(pointIndex, lineIndex) * chart.yAxis.scale;
 
-                if (i == 0) {
-                    graphics.moveTo(x, y);
-                } else {
-                    graphics.lineTo(x, y);
+                    if (i == 0) {
+                        graphics.moveTo(x, y);
+                    } else {
+                        graphics.lineTo(x, y);
+                    }
                 }
             }
 
@@ -25,6 +25,42 @@
 namespace eez {
 namespace gui {
 
+// number of values fetched from the data at once
+static const uint32_t YT_GRAPH_VALUES_BATCH_SIZE = 64;
+
+// Fetches count values (and max values if max is not nullptr) starting from position,
+// values at positions >= numPositions are set to NaN.
+static void ytGraphGetValues(
+    Value::YtDataGetValueFunctionPointer ytDataGetValue, Value::YtDataGetValuesFunctionPointer ytDataGetValues,
+    uint32_t numPositions, uint32_t position, uint32_t count, uint8_t valueIndex, float *values, float *max
+) {
+    for (uint32_t i = 0; i < count; ) {
+        // position can wrap around, so valid positions are not necessarily at the start
+        uint32_t p = position + i;
+
+        if (p >= numPositions) {
+            values[i] = NAN;
+            if (max) {
+                max[i] = NAN;
+            }
+            i++;
+            continue;
+        }
+
+        uint32_t n = MIN(count - i, numPositions - p);
+
+        if (ytDataGetValues) {
+            ytDataGetValues(p, n, valueIndex, values + i, max ? max + i : nullptr);
+        } else {
+            for (uint32_t j = 0; j < n; j++) {
+                values[i + j] = ytDataGetValue(p + j, valueIndex, max ? max + i + j : nullptr);
+            }
+        }
+
+        i += n;
+    }
+}
+
 // used for YT_GRAPH_UPDATE_METHOD_SCROLL and YT_GRAPH_UPDATE_METHOD_SCAN_LINE
 struct YTGraphDrawHelper {
     const WidgetCursor &widgetCursor;
@@ -44,7 +80,11 @@ struct YTGraphDrawHelper {
     int yPrev[2];
     int y[2];
 
+    // y values of the last fetched batch
+    int yValues[2][YT_GRAPH_VALUES_BATCH_SIZE];
+
     Value::YtDataGetValueFunctionPointer ytDataGetValue;
+    Value::YtDataGetValuesFunctionPointer ytDataGetValues;
 
     YTGraphDrawHelper(const WidgetCursor &widgetCursor_) : widgetCursor(widgetCursor_), widget(widgetCursor.widget) {
         min[0] = ytDataGetMin(widgetCursor, widget->data, 0).getFloat();
@@ -59,21 +99,25 @@ struct YTGraphDrawHelper {
         dataColor16[1] = display::getColor16FromIndex(y2Style->color);
 
         ytDataGetValue = ytDataGetGetValueFunc(widgetCursor, widget->data);
+        ytDataGetValues = ytDataGetGetValuesFunc(widgetCursor, widget->data);
     }
 
-    int getYValue(int valueIndex, uint32_t position) {
-        if (position >= numPositions) {
-            return INT_MIN;
-        }
+    // fills yValues for count (<= YT_GRAPH_VALUES_BATCH_SIZE) positions starting from position
+    void getYValues(uint32_t position, uint32_t count) {
+        float values[YT_GRAPH_VALUES_BATCH_SIZE];
 
-        float value = ytDataGetValue(position, valueIndex, nullptr);
+        for (int valueIndex = 0; valueIndex < 2; valueIndex++) {
+            ytGraphGetValues(ytDataGetValue, ytDataGetValues, numPositions, position, count, valueIndex, values, nullptr);
 
-        if (isNaN(value)) {
-            return INT_MIN;
+            for (uint32_t i = 0; i < count; i++) {
+                if (isNaN(values[i])) {
+                    yValues[valueIndex][i] = INT_MIN;
+                } else {
+                    int y = (int)round((widgetCursor.h - 1) * (values[i] - min[valueIndex]) / (max[valueIndex] - min[valueIndex]));
+                    yValues[valueIndex][i] = widgetCursor.h - 1 - y;
+                }
+            }
         }
-
-        int y = (int)round((widgetCursor.h - 1) * (value - min[valueIndex]) / (max[valueIndex] - min[valueIndex]));
-        return widgetCursor.h - 1 - y;
     }
 
     void drawValue(int valueIndex) {
@@ -103,21 +147,10 @@ struct YTGraphDrawHelper {
 
         if (yPrevValue == INT_MIN || abs(yPrevValue - yValue) <= 1) {
             display::drawPixel(x, widgetCursor.y + yValue);
+        } else if (yPrevValue < yValue) {
+            display::drawPixelsVSpan(x, widgetCursor.y + yPrevValue + 1, widgetCursor.y + yValue);
         } else {
-            int y1;
-            int y2;
-            if (yPrevValue < yValue) {
-                //display::drawVLine(x, widgetCursor.y + yPrevValue + 1, yValue - yPrevValue - 1);
-                y1 = widgetCursor.y + yPrevValue + 1;
-                y2 = y1 + yValue - yPrevValue;
-            } else {
-                //display::drawVLine(x, widgetCursor.y + yValue, yPrevValue - yValue - 1);
-                y1 = widgetCursor.y + yValue;
-                y2 = y1 + yPrevValue - yValue;
-            }
-            for (int y = y1; y < y2; y++) {
-                display::drawPixel(x, y);
-            }
+            display::drawPixelsVSpan(x, widgetCursor.y + yValue, widgetCursor.y + yPrevValue - 1);
         }
     }
 
@@ -147,17 +180,35 @@ struct YTGraphDrawHelper {
         }
 
         display::startPixelsDraw();
-        for (position = startPosition; position < endPosition; ++position) {
-            x = widgetCursor.x + position % graphWidth;
 
-            y[0] = getYValue(0, position);
-            yPrev[0] = getYValue(0, position == 0 ? position : position - 1);
+        if (startPosition > 0 && startPosition < endPosition) {
+            getYValues(startPosition - 1, 1);
+            yPrev[0] = yValues[0][0];
+            yPrev[1] = yValues[1][0];
+        }
+
+        for (position = startPosition; position < endPosition; ) {
+            uint32_t count = MIN(endPosition - position, YT_GRAPH_VALUES_BATCH_SIZE);
+            getYValues(position, count);
+
+            for (uint32_t i = 0; i < count; i++, position++) {
+                x = widgetCursor.x + position % graphWidth;
 
-            y[1] = getYValue(1, position);
-            yPrev[1] = getYValue(1, position == 0 ? position : position - 1);
+                y[0] = yValues[0][i];
+                y[1] = yValues[1][i];
 
-            drawStep();
+                if (position == 0) {
+                    yPrev[0] = y[0];
+                    yPrev[1] = y[1];
+                }
+
+                drawStep();
+
+                yPrev[0] = y[0];
+                yPrev[1] = y[1];
+            }
         }
+
         display::endPixelsDraw();
     }
 
@@ -184,21 +235,27 @@ struct YTGraphDrawHelper {
 
         numPositions = position + numPointsToDraw;
 
-        yPrev[0] = getYValue(0, previousHistoryValuePosition);
-        yPrev[1] = getYValue(1, previousHistoryValuePosition);
+        getYValues(previousHistoryValuePosition, 1);
+        yPrev[0] = yValues[0][0];
+        yPrev[1] = yValues[1][0];
 
         display::setColor16(color16);
         display::fillRect(startX, widgetCursor.y, endX - 1, widgetCursor.y + widgetCursor.h - 1);
 
         display::startPixelsDraw();
-        for (x = startX; x < endX; x++, position++) {
-            y[0] = getYValue(0, position);
-            y[1] = getYValue(1, position);
+        for (x = startX; x < endX; ) {
+            uint32_t count = MIN((uint32_t)(endX - x), YT_GRAPH_VALUES_BATCH_SIZE);
+            getYValues(position, count);
+
+            for (uint32_t i = 0; i < count; i++, x++, position++) {
+                y[0] = yValues[0][i];
+                y[1] = yValues[1][i];
 
-            drawStep();
+                drawStep();
 
-            yPrev[0] = y[0];
-            yPrev[1] = y[1];
+                yPrev[0] = y[0];
+                yPrev[1] = y[1];
+            }
         }
         display::endPixelsDraw();
     }
@@ -232,6 +289,11 @@ struct YTGraphStaticDrawHelper {
     int yMax;
 
     Value::YtDataGetValueFunctionPointer ytDataGetValue;
+    Value::YtDataGetValuesFunctionPointer ytDataGetValues;
+
+    // values of the last fetched batch
+    float fMinValues[YT_GRAPH_VALUES_BATCH_SIZE];
+    float fMaxValues[YT_GRAPH_VALUES_BATCH_SIZE];
 
     int xLabels[MAX_NUM_OF_Y_VALUES];
     int yLabels[MAX_NUM_OF_Y_VALUES];
@@ -240,27 +302,25 @@ struct YTGraphStaticDrawHelper {
         : widgetState(widgetState_), widgetCursor(widgetCursor_), widget(widgetCursor.widget)
     {
         ytDataGetValue = ytDataGetGetValueFunc(widgetCursor, widget->data);
+        ytDataGetValues = ytDataGetGetValuesFunc(widgetCursor, widget->data);
     }
 
-    void getYValue(uint32_t position, int &min, int &max) {
-        if (position >= numPositions) {
+    // fills fMinValues and fMaxValues for count (<= YT_GRAPH_VALUES_BATCH_SIZE) positions starting from position
+    void getValues(uint32_t position, uint32_t count) {
+        ytGraphGetValues(ytDataGetValue, ytDataGetValues, numPositions, position, count, m_valueIndex, fMinValues, fMaxValues);
+    }
+
+    void getYValue(float fMin, float fMax, int &min, int &max) {
+        if (isNaN(fMin)) {
             max = INT_MIN;
-            min = INT_MIN;
         } else {
-            float fMax;
-            float fMin = ytDataGetValue(position, m_valueIndex, &fMax);
-
-            if (isNaN(fMin)) {
-                max = INT_MIN;
-            } else {
-                max = widgetCursor.h - 1 - (int)floor(widgetCursor.h / 2.0f + (fMin + offset) * scale);
-            }
+            max = widgetCursor.h - 1 - (int)floor(widgetCursor.h / 2.0f + (fMin + offset) * scale);
+        }
 
-            if (isNaN(fMax)) {
-                min = INT_MIN;
-            } else {
-                min = widgetCursor.h - 1 - (int)floor(widgetCursor.h / 2.0f + (fMax + offset) * scale);
-            }
+        if (isNaN(fMax)) {
+            min = INT_MIN;
+        } else {
+            min = widgetCursor.h - 1 - (int)floor(widgetCursor.h / 2.0f + (fMax + offset) * scale);
         }
     }
 
@@ -305,12 +365,7 @@ struct YTGraphStaticDrawHelper {
         if (yFrom == yTo) {
             display::drawPixel(x, widgetCursor.y + yFrom);
         } else {
-            // display::drawVLine(x, widgetCursor.y + yFrom, yTo - yFrom);
-            int y1 = widgetCursor.y + yFrom;
-            int y2 = y1 + yTo - yFrom + 1;
-            for (int y = y1; y < y2; y++) {
-                display::drawPixel(x, y);
-            }
+            display::drawPixelsVSpan(x, widgetCursor.y + yFrom, widgetCursor.y + yTo);
         }
     }
 
@@ -353,17 +408,23 @@ struct YTGraphStaticDrawHelper {
             const Style* style = ytDataGetStyle(widgetCursor, widget->data, m_valueIndex);
             dataColor16 = display::getColor16FromIndex(style->color);
 
-            getYValue(position > 0 ? position - 1 : 0, yPrevMin, yPrevMax);
+            getValues(position > 0 ? position - 1 : 0, 1);
+            getYValue(fMinValues[0], fMaxValues[0], yPrevMin, yPrevMax);
+
+            for (x = startX; x < endX; ) {
+                uint32_t count = MIN((uint32_t)(endX - x), YT_GRAPH_VALUES_BATCH_SIZE);
+                getValues(position, count);
 
-            for (x = startX; x < endX; x++, position++) {
-                getYValue(position, yMin, yMax);
-                drawValue();
-                yPrevMin = yMin;
-                yPrevMax = yMax;
+                for (uint32_t i = 0; i < count; i++, x++, position++) {
+                    getYValue(fMinValues[i], fMaxValues[i], yMin, yMax);
+                    drawValue();
+                    yPrevMin = yMin;
+                    yPrevMax = yMax;
 
-                if (yMin != INT_MIN) {
-                    //xLabels[m_valueIndex] = x;
-                    yLabels[m_valueIndex] = widgetCursor.y + yMin;
+                    if (yMin != INT_MIN) {
+                        //xLabels[m_valueIndex] = x;
+                        yLabels[m_valueIndex] = widgetCursor.y + yMin;
+                    }
                 }
             }
         }
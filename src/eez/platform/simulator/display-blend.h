@@ -0,0 +1,80 @@
+/*
+ * eez-framework
+ *
+ * MIT License
+ * Copyright 2024 Envox d.o.o.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace eez {
+namespace gui {
+namespace display {
+
+// a - b * c, where b * c is rounded to float before the subtraction. Without the barrier
+// the compiler may fuse it into FMA, depending on the target and flags (-mfma with
+// -ffp-contract=fast, AArch64 by default). The vector kernels (display-kernels.h) never
+// fuse either, so they match it exactly.
+// Only the simulator kernels use this, blendColor (gui/display.cpp) used on the devices
+// is left to the compiler.
+static inline float blendMulSub(float a, float b, float c) {
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE_MATH__)))
+    float bc = b * c;
+    __asm__("" : "+x"(bc));
+#elif defined(__GNUC__) && defined(__aarch64__)
+    float bc = b * c;
+    __asm__("" : "+w"(bc));
+#elif defined(__GNUC__) && defined(__arm__) && defined(__ARM_FP)
+    float bc = b * c;
+    __asm__("" : "+t"(bc));
+#else
+    volatile float bc = b * c;
+#endif
+    return a - bc;
+}
+
+static inline float blendClamp(float x) {
+    if (x < 0.0f) {
+        return 0.0f;
+    }
+    if (x > 255.0f) {
+        return 255.0f;
+    }
+    return x;
+}
+
+// Same as blendColor, but without FMA. Used for the pixels of the row not handled by
+// the vector kernels and by the pixel exact test of the kernels.
+static inline uint32_t blendColorScalar(uint32_t fgColor, uint32_t bgColor) {
+    uint8_t *fg = (uint8_t *)&fgColor;
+    uint8_t *bg = (uint8_t *)&bgColor;
+
+    float alphaMult = fg[3] * bg[3] / 255.0f;
+    float alphaOut = fg[3] + bg[3] - alphaMult;
+
+    float r = blendMulSub((float)(fg[0] * fg[3] + bg[0] * bg[3]), bg[0], alphaMult) / alphaOut;
+    float g = blendMulSub((float)(fg[1] * fg[3] + bg[1] * bg[3]), bg[1], alphaMult) / alphaOut;
+    float b = blendMulSub((float)(fg[2] * fg[3] + bg[2] * bg[3]), bg[2], alphaMult) / alphaOut;
+
+    r = blendClamp(r);
+    g = blendClamp(g);
+    b = blendClamp(b);
+
+    uint32_t result;
+    uint8_t *presult = (uint8_t *)&result;
+    presult[0] = (uint8_t)r;
+    presult[1] = (uint8_t)g;
+    presult[2] = (uint8_t)b;
+    presult[3] = (uint8_t)alphaOut;
+
+    return result;
+}
+
+} // namespace display
+} // namespace gui
+} // namespace eez
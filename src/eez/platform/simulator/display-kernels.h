@@ -0,0 +1,390 @@
+/*
+ * eez-framework
+ *
+ * MIT License
+ * Copyright 2024 Envox d.o.o.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated documentation files (the “Software”), to deal in the Software without restriction, including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <eez/platform/simulator/display-blend.h>
+
+#if EEZ_OPTION_GUI_SIMD
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define EEZ_GUI_SIMD_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define EEZ_GUI_SIMD_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+// ARMv7 NEON is left out, it has no IEEE division and the results
+// would not be bit exact with blendColor
+#include <arm_neon.h>
+#define EEZ_GUI_SIMD_NEON 1
+#elif defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define EEZ_GUI_SIMD_WASM 1
+#endif
+#endif
+
+namespace eez {
+namespace gui {
+namespace display {
+namespace kernels {
+
+// Span kernels used by the software renderer. Every kernel processes one
+// row of pixels and must give exactly the same result as the scalar code
+// (blendColorScalar, color16to32 etc.), i.e. vector path only changes speed.
+//
+// Each SIMD backend is described with a traits struct, N is number of
+// 32-bit pixels in one register. Blending repeats the float operations of
+// blendColor in the same order. Multiply-subtract is never fused into FMA,
+// neither here nor in blendColorScalar used for the rest of the row (see
+// blendMulSub in display-blend.h), so the result doesn't depend on the
+// compiler flags.
+
+#if EEZ_GUI_SIMD_AVX2
+
+struct Simd {
+    static const int N = 8;
+    typedef __m256i I;
+    typedef __m256 F;
+
+    static inline I load(const uint32_t *p) { return _mm256_loadu_si256((const __m256i *)p); }
+    static inline I loadU16(const uint16_t *p) { return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)p)); }
+    static inline I loadU8(const uint8_t *p) { return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)p)); }
+    static inline void store(uint32_t *p, I a) { _mm256_storeu_si256((__m256i *)p, a); }
+
+    static inline I splat(uint32_t a) { return _mm256_set1_epi32((int)a); }
+    static inline I and_(I a, I b) { return _mm256_and_si256(a, b); }
+    static inline I or_(I a, I b) { return _mm256_or_si256(a, b); }
+    static inline I add(I a, I b) { return _mm256_add_epi32(a, b); }
+    // both operands must be less than 256
+    static inline I mulSmall(I a, I b) { return _mm256_mullo_epi16(a, b); }
+    template<int n> static inline I shl(I a) { return _mm256_slli_epi32(a, n); }
+    template<int n> static inline I shr(I a) { return _mm256_srli_epi32(a, n); }
+
+    static inline F toFloat(I a) { return _mm256_cvtepi32_ps(a); }
+    static inline I truncate(F a) { return _mm256_cvttps_epi32(a); }
+    static inline F fsplat(float a) { return _mm256_set1_ps(a); }
+    static inline F fsub(F a, F b) { return _mm256_sub_ps(a, b); }
+    static inline F fdiv(F a, F b) { return _mm256_div_ps(a, b); }
+    // returns b if a is NaN, so NaN ends up as 0 like (uint8_t)NaN on x86
+    static inline F fmax(F a, F b) { return _mm256_max_ps(a, b); }
+    static inline F fmin(F a, F b) { return _mm256_min_ps(a, b); }
+    // a - b * c, not fused (GCC would contract these intrinsics with -ffp-contract=fast)
+    static inline F mulSub(F a, F b, F c) {
+        F bc = _mm256_mul_ps(b, c);
+#if defined(__GNUC__)
+        __asm__("" : "+x"(bc));
+#endif
+        return _mm256_sub_ps(a, bc);
+    }
+};
+
+#elif EEZ_GUI_SIMD_SSE2
+
+struct Simd {
+    static const int N = 4;
+    typedef __m128i I;
+    typedef __m128 F;
+
+    static inline I load(const uint32_t *p) { return _mm_loadu_si128((const __m128i *)p); }
+    static inline I loadU16(const uint16_t *p) { return _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)p), _mm_setzero_si128()); }
+    static inline I loadU8(const uint8_t *p) {
+        int32_t a;
+        memcpy(&a, p, 4);
+        I z = _mm_setzero_si128();
+        return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(a), z), z);
+    }
+    static inline void store(uint32_t *p, I a) { _mm_storeu_si128((__m128i *)p, a); }
+
+    static inline I splat(uint32_t a) { return _mm_set1_epi32((int)a); }
+    static inline I and_(I a, I b) { return _mm_and_si128(a, b); }
+    static inline I or_(I a, I b) { return _mm_or_si128(a, b); }
+    static inline I add(I a, I b) { return _mm_add_epi32(a, b); }
+    // both operands must be less than 256
+    static inline I mulSmall(I a, I b) { return _mm_mullo_epi16(a, b); }
+    template<int n> static inline I shl(I a) { return _mm_slli_epi32(a, n); }
+    template<int n> static inline I shr(I a) { return _mm_srli_epi32(a, n); }
+
+    static inline F toFloat(I a) { return _mm_cvtepi32_ps(a); }
+    static inline I truncate(F a) { return _mm_cvttps_epi32(a); }
+    static inline F fsplat(float a) { return _mm_set1_ps(a); }
+    static inline F fsub(F a, F b) { return _mm_sub_ps(a, b); }
+    static inline F fdiv(F a, F b) { return _mm_div_ps(a, b); }
+    // returns b if a is NaN, so NaN ends up as 0 like (uint8_t)NaN on x86
+    static inline F fmax(F a, F b) { return _mm_max_ps(a, b); }
+    static inline F fmin(F a, F b) { return _mm_min_ps(a, b); }
+    // a - b * c, not fused (GCC would contract these intrinsics with -ffp-contract=fast)
+    static inline F mulSub(F a, F b, F c) {
+        F bc = _mm_mul_ps(b, c);
+#if defined(__GNUC__)
+        __asm__("" : "+x"(bc));
+#endif
+        return _mm_sub_ps(a, bc);
+    }
+};
+
+#elif EEZ_GUI_SIMD_NEON
+
+struct Simd {
+    static const int N = 4;
+    typedef uint32x4_t I;
+    typedef float32x4_t F;
+
+    static inline I load(const uint32_t *p) { return vld1q_u32(p); }
+    static inline I loadU16(const uint16_t *p) { return vmovl_u16(vld1_u16(p)); }
+    static inline I loadU8(const uint8_t *p) {
+        uint32_t a;
+        memcpy(&a, p, 4);
+        return vmovl_u16(vget_low_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(a)))));
+    }
+    static inline void store(uint32_t *p, I a) { vst1q_u32(p, a); }
+
+    static inline I splat(uint32_t a) { return vdupq_n_u32(a); }
+    static inline I and_(I a, I b) { return vandq_u32(a, b); }
+    static inline I or_(I a, I b) { return vorrq_u32(a, b); }
+    static inline I add(I a, I b) { return vaddq_u32(a, b); }
+    static inline I mulSmall(I a, I b) { return vmulq_u32(a, b); }
+    template<int n> static inline I shl(I a) { return vshlq_n_u32(a, n); }
+    template<int n> static inline I shr(I a) { return vshrq_n_u32(a, n); }
+
+    static inline F toFloat(I a) { return vcvtq_f32_u32(a); }
+    // NaN converts to 0
+    static inline I truncate(F a) { return vreinterpretq_u32_s32(vcvtq_s32_f32(a)); }
+    static inline F fsplat(float a) { return vdupq_n_f32(a); }
+    static inline F fsub(F a, F b) { return vsubq_f32(a, b); }
+    static inline F fdiv(F a, F b) { return vdivq_f32(a, b); }
+    static inline F fmax(F a, F b) { return vmaxq_f32(a, b); }
+    static inline F fmin(F a, F b) { return vminq_f32(a, b); }
+    // a - b * c, not fused
+    static inline F mulSub(F a, F b, F c) {
+        F bc = vmulq_f32(b, c);
+#if defined(__GNUC__)
+        __asm__("" : "+w"(bc));
+#endif
+        return vsubq_f32(a, bc);
+    }
+};
+
+#elif EEZ_GUI_SIMD_WASM
+
+struct Simd {
+    static const int N = 4;
+    typedef v128_t I;
+    typedef v128_t F;
+
+    static inline I load(const uint32_t *p) { return wasm_v128_load(p); }
+    static inline I loadU16(const uint16_t *p) { return wasm_u32x4_load16x4(p); }
+    static inline I loadU8(const uint8_t *p) { return wasm_i32x4_make(p[0], p[1], p[2], p[3]); }
+    static inline void store(uint32_t *p, I a) { wasm_v128_store(p, a); }
+
+    static inline I splat(uint32_t a) { return wasm_i32x4_splat((int32_t)a); }
+    static inline I and_(I a, I b) { return wasm_v128_and(a, b); }
+    static inline I or_(I a, I b) { return wasm_v128_or(a, b); }
+    static inline I add(I a, I b) { return wasm_i32x4_add(a, b); }
+    static inline I mulSmall(I a, I b) { return wasm_i32x4_mul(a, b); }
+    template<int n> static inline I shl(I a) { return wasm_i32x4_shl(a, n); }
+    template<int n> static inline I shr(I a) { return wasm_u32x4_shr(a, n); }
+
+    static inline F toFloat(I a) { return wasm_f32x4_convert_i32x4(a); }
+    // NaN converts to 0
+    static inline I truncate(F a) { return wasm_i32x4_trunc_sat_f32x4(a); }
+    static inline F fsplat(float a) { return wasm_f32x4_splat(a); }
+    static inline F fsub(F a, F b) { return wasm_f32x4_sub(a, b); }
+    static inline F fdiv(F a, F b) { return wasm_f32x4_div(a, b); }
+    static inline F fmax(F a, F b) { return wasm_f32x4_max(a, b); }
+    static inline F fmin(F a, F b) { return wasm_f32x4_min(a, b); }
+    // a - b * c, WebAssembly SIMD128 has no FMA
+    static inline F mulSub(F a, F b, F c) { return wasm_f32x4_sub(a, wasm_f32x4_mul(b, c)); }
+};
+
+#endif
+
+#if defined(EEZ_GUI_SIMD_AVX2) || defined(EEZ_GUI_SIMD_SSE2) || defined(EEZ_GUI_SIMD_NEON) || defined(EEZ_GUI_SIMD_WASM)
+#define EEZ_GUI_SIMD 1
+#else
+#define EEZ_GUI_SIMD 0
+#endif
+
+#if EEZ_GUI_SIMD
+
+// (x + 1 + (x >> 8)) >> 8 == x / 255 for every x = a * b where a, b < 256
+static inline Simd::I div255(Simd::I x) {
+    return Simd::shr<8>(Simd::add(Simd::add(x, Simd::splat(1)), Simd::shr<8>(x)));
+}
+
+template<int shift>
+static inline Simd::I blendChannel(Simd::I fg, Simd::I bg, Simd::I fa, Simd::I ba, Simd::F alphaMult, Simd::F alphaOut) {
+    Simd::I mask = Simd::splat(0xFF);
+    Simd::I fc = Simd::and_(Simd::shr<shift>(fg), mask);
+    Simd::I bc = Simd::and_(Simd::shr<shift>(bg), mask);
+    Simd::F c = Simd::fdiv(
+        Simd::mulSub(Simd::toFloat(Simd::add(Simd::mulSmall(fc, fa), Simd::mulSmall(bc, ba))), Simd::toFloat(bc), alphaMult),
+        alphaOut
+    );
+    c = Simd::fmin(Simd::fmax(c, Simd::fsplat(0.0f)), Simd::fsplat(255.0f));
+    return Simd::shl<shift>(Simd::and_(Simd::truncate(c), mask));
+}
+
+// vector version of blendColor
+static inline Simd::I blend(Simd::I fg, Simd::I bg) {
+    Simd::I fa = Simd::shr<24>(fg);
+    Simd::I ba = Simd::shr<24>(bg);
+
+    Simd::F alphaMult = Simd::fdiv(Simd::toFloat(Simd::mulSmall(fa, ba)), Simd::fsplat(255.0f));
+    Simd::F alphaOut = Simd::fsub(Simd::toFloat(Simd::add(fa, ba)), alphaMult);
+
+    Simd::I result = Simd::shl<24>(Simd::and_(Simd::truncate(alphaOut), Simd::splat(0xFF)));
+    result = Simd::or_(result, blendChannel<0>(fg, bg, fa, ba, alphaMult, alphaOut));
+    result = Simd::or_(result, blendChannel<8>(fg, bg, fa, ba, alphaMult, alphaOut));
+    result = Simd::or_(result, blendChannel<16>(fg, bg, fa, ba, alphaMult, alphaOut));
+    return result;
+}
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+static inline void fillSpan(uint32_t *dst, int n, uint32_t color) {
+    int i = 0;
+#if EEZ_GUI_SIMD
+    Simd::I c = Simd::splat(color);
+    for (; i + Simd::N <= n; i += Simd::N) {
+        Simd::store(dst + i, c);
+    }
+#endif
+    for (; i < n; i++) {
+        dst[i] = color;
+    }
+}
+
+static inline void copySpan(uint32_t *dst, const uint32_t *src, int n) {
+    if (n > 0) {
+        memmove(dst, src, n * sizeof(uint32_t));
+    }
+}
+
+// dst = blendColorScalar(color, dst)
+static inline void blendColorSpan(uint32_t *dst, int n, uint32_t color) {
+    int i = 0;
+#if EEZ_GUI_SIMD
+    Simd::I c = Simd::splat(color);
+    for (; i + Simd::N <= n; i += Simd::N) {
+        Simd::store(dst + i, blend(c, Simd::load(dst + i)));
+    }
+#endif
+    for (; i < n; i++) {
+        dst[i] = blendColorScalar(color, dst[i]);
+    }
+}
+
+// src alpha is replaced with opacity (also in the source buffer) and then
+// src is blended over dst
+static inline void blendSpanWithOpacity(uint32_t *dst, uint32_t *src, int n, uint8_t opacity) {
+    uint32_t alpha = (uint32_t)opacity << 24;
+    int i = 0;
+#if EEZ_GUI_SIMD
+    Simd::I rgbMask = Simd::splat(0x00FFFFFF);
+    Simd::I a = Simd::splat(alpha);
+    for (; i + Simd::N <= n; i += Simd::N) {
+        Simd::I fg = Simd::or_(Simd::and_(Simd::load(src + i), rgbMask), a);
+        Simd::store(src + i, fg);
+        Simd::store(dst + i, blend(fg, Simd::load(dst + i)));
+    }
+#endif
+    for (; i < n; i++) {
+        src[i] = (src[i] & 0x00FFFFFF) | alpha;
+        dst[i] = blendColorScalar(src[i], dst[i]);
+    }
+}
+
+// src alpha is multiplied with opacity and src is blended over dst
+static inline void blendBitmapSpan(uint32_t *dst, const uint32_t *src, int n, uint8_t opacity) {
+    int i = 0;
+#if EEZ_GUI_SIMD
+    Simd::I rgbMask = Simd::splat(0x00FFFFFF);
+    Simd::I o = Simd::splat(opacity);
+    for (; i + Simd::N <= n; i += Simd::N) {
+        Simd::I s = Simd::load(src + i);
+        Simd::I a = div255(Simd::mulSmall(Simd::shr<24>(s), o));
+        Simd::I fg = Simd::or_(Simd::and_(s, rgbMask), Simd::shl<24>(a));
+        Simd::store(dst + i, blend(fg, Simd::load(dst + i)));
+    }
+#endif
+    for (; i < n; i++) {
+        uint32_t a = (src[i] >> 24) * opacity / 255;
+        dst[i] = blendColorScalar((src[i] & 0x00FFFFFF) | (a << 24), dst[i]);
+    }
+}
+
+// glyph coverage multiplied with opacity is used as alpha of rgb color
+static inline void blendGlyphSpan(uint32_t *dst, const uint8_t *coverage, int n, uint32_t rgb, uint8_t opacity) {
+    int i = 0;
+#if EEZ_GUI_SIMD
+    Simd::I c = Simd::splat(rgb);
+    Simd::I o = Simd::splat(opacity);
+    for (; i + Simd::N <= n; i += Simd::N) {
+        Simd::I a = div255(Simd::mulSmall(Simd::loadU8(coverage + i), o));
+        Simd::store(dst + i, blend(Simd::or_(c, Simd::shl<24>(a)), Simd::load(dst + i)));
+    }
+#endif
+    for (; i < n; i++) {
+        uint32_t a = coverage[i] * opacity / 255;
+        dst[i] = blendColorScalar(rgb | (a << 24), dst[i]);
+    }
+}
+
+// same as color16to32(RGB_TO_COLOR(r, g, b)), i.e. round trip through RGB565
+static inline void quantizeSpan(uint32_t *dst, const uint32_t *src, int n) {
+    int i = 0;
+#if EEZ_GUI_SIMD
+    Simd::I mask = Simd::splat(0x00F8FCF8);
+    Simd::I alpha = Simd::splat(0xFF000000);
+    for (; i + Simd::N <= n; i += Simd::N) {
+        Simd::store(dst + i, Simd::or_(Simd::and_(Simd::load(src + i), mask), alpha));
+    }
+#endif
+    for (; i < n; i++) {
+        dst[i] = (src[i] & 0x00F8FCF8) | 0xFF000000;
+    }
+}
+
+// same as color16to32(color)
+static inline void expand565Span(uint32_t *dst, const uint16_t *src, int n) {
+    int i = 0;
+#if EEZ_GUI_SIMD
+    Simd::I mask = Simd::splat(0xFF);
+    Simd::I alpha = Simd::splat(0xFF000000);
+    for (; i + Simd::N <= n; i += Simd::N) {
+        Simd::I c = Simd::loadU16(src + i);
+        Simd::I r = Simd::shl<3>(Simd::shr<11>(c));
+        Simd::I g = Simd::shl<8>(Simd::and_(Simd::shl<2>(Simd::shr<5>(c)), mask));
+        Simd::I b = Simd::shl<16>(Simd::and_(Simd::shl<3>(c), mask));
+        Simd::store(dst + i, Simd::or_(Simd::or_(r, g), Simd::or_(b, alpha)));
+    }
+#endif
+    for (; i < n; i++) {
+        uint32_t c = src[i];
+        dst[i] = ((c >> 11) << 3) | ((((c >> 5) << 2) & 0xFF) << 8) | (((c << 3) & 0xFF) << 16) | 0xFF000000;
+    }
+}
+
+// RGB888 to RGBA8888 with alpha 255
+static inline void expand888Span(uint32_t *dst, const uint8_t *src, int n) {
+    for (int i = 0; i < n; i++, src += 3) {
+        dst[i] = src[0] | (src[1] << 8) | (src[2] << 16) | 0xFF000000;
+    }
+}
+
+} // namespace kernels
+} // namespace display
+} // namespace gui
+} // namespace eez
@@ -24,6 +24,14 @@
 #include <SDL_image.h>
 #endif
 
+#if EEZ_OPTION_GUI_RENDER_THREADS > 0 && !defined(__EMSCRIPTEN__)
+#define EEZ_GUI_RENDER_WORKERS 1
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
 #include <eez/core/debug.h>
 #include <eez/core/memory.h>
 #include <eez/core/util.h>
@@ -39,6 +47,8 @@
 
 #include <eez/gui/display-private.h>
 
+#include <eez/platform/simulator/display-kernels.h>
+
 namespace eez {
 namespace gui {
 namespace display {
@@ -48,10 +58,120 @@ namespace display {
 #if !defined(__EMSCRIPTEN__)
 static SDL_Window *g_mainWindow;
 static SDL_Renderer *g_renderer;
+static SDL_Texture *g_texture;
 #endif
 
 ////////////////////////////////////////////////////////////////////////////////
 
+#if EEZ_GUI_RENDER_WORKERS
+
+// Large pixel operations are split into bands of rows, rendered by the GUI thread
+// together with EEZ_OPTION_GUI_RENDER_THREADS workers. Every row is computed
+// the same way as in the single threaded path, so the output is identical.
+namespace workers {
+
+static const int MIN_PARALLEL_PIXELS = 128 * 1024;
+
+// always the same, so a late worker can't mistake a band index of the previous job for the current one
+static const int NUM_BANDS = 4 * (EEZ_OPTION_GUI_RENDER_THREADS + 1);
+
+typedef void (*BandFunc)(void *param, int y1, int y2);
+
+// never destroyed, workers are still waiting on them at exit
+static std::mutex &g_mutex = *new std::mutex;
+static std::condition_variable &g_startCondition = *new std::condition_variable;
+static std::condition_variable &g_doneCondition = *new std::condition_variable;
+static bool g_workersStarted;
+static uint32_t g_jobId;
+static int g_numBandsDone;
+
+static BandFunc g_bandFunc;
+static void *g_bandParam;
+static int g_y1;
+static int g_numRows;
+static std::atomic<int> g_nextBand(NUM_BANDS);
+
+static void runBands() {
+    for (;;) {
+        int band = g_nextBand.fetch_add(1);
+        if (band >= NUM_BANDS) {
+            break;
+        }
+
+        int y1 = g_y1 + g_numRows * band / NUM_BANDS;
+        int y2 = g_y1 + g_numRows * (band + 1) / NUM_BANDS - 1;
+        if (y1 <= y2) {
+            g_bandFunc(g_bandParam, y1, y2);
+        }
+
+        std::lock_guard<std::mutex> lock(g_mutex);
+        if (++g_numBandsDone == NUM_BANDS) {
+            g_doneCondition.notify_one();
+        }
+    }
+}
+
+static void workerThread() {
+    uint32_t jobId = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(g_mutex);
+            g_startCondition.wait(lock, [&] { return g_jobId != jobId; });
+            jobId = g_jobId;
+        }
+        runBands();
+    }
+}
+
+static void parallelFor(int y1, int y2, int width, BandFunc bandFunc, void *bandParam) {
+    if (width * (y2 - y1 + 1) < MIN_PARALLEL_PIXELS) {
+        bandFunc(bandParam, y1, y2);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+
+        if (!g_workersStarted) {
+            for (int i = 0; i < EEZ_OPTION_GUI_RENDER_THREADS; i++) {
+                std::thread(workerThread).detach();
+            }
+            g_workersStarted = true;
+        }
+
+        g_bandFunc = bandFunc;
+        g_bandParam = bandParam;
+        g_y1 = y1;
+        g_numRows = y2 - y1 + 1;
+        g_numBandsDone = 0;
+        g_nextBand.store(0);
+        g_jobId++;
+    }
+    g_startCondition.notify_all();
+
+    runBands();
+
+    std::unique_lock<std::mutex> lock(g_mutex);
+    g_doneCondition.wait(lock, [] { return g_numBandsDone == NUM_BANDS; });
+}
+
+} // namespace workers
+
+#endif
+
+// Calls func(y1, y2) for the bands of rows between y1 and y2, bands can be rendered in parallel
+template <typename Func>
+static inline void forEachRows(int y1, int y2, int width, const Func &func) {
+#if EEZ_GUI_RENDER_WORKERS
+    workers::parallelFor(y1, y2, width, [](void *param, int y1, int y2) { (*(const Func *)param)(y1, y2); }, (void *)&func);
+#else
+    EEZ_UNUSED(width);
+    func(y1, y2);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 // heuristics to find resource file
 std::string getFullPath(std::string category, std::string path) {
     std::string fullPath = category + "/" + path;
@@ -125,24 +245,31 @@ void syncBuffer() {
 		return;
     }
 
-    SDL_Surface *rgbSurface = SDL_CreateRGBSurfaceFrom(
-        (uint32_t *)g_syncedBuffer, DISPLAY_WIDTH, DISPLAY_HEIGHT, 32, 4 * DISPLAY_WIDTH, 0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000);
-    if (rgbSurface != NULL) {
-        SDL_Texture *texture = SDL_CreateTextureFromSurface(g_renderer, rgbSurface);
-        if (texture != NULL) {
-            SDL_Rect srcRect = { 0, 0, (int)DISPLAY_WIDTH, (int)DISPLAY_HEIGHT };
-            SDL_Rect dstRect = { 0, 0, (int)DISPLAY_WIDTH, (int)DISPLAY_HEIGHT };
-
-            SDL_RenderCopyEx(g_renderer, texture, &srcRect, &dstRect, 0.0, NULL, SDL_FLIP_NONE);
-
-            SDL_DestroyTexture(texture);
+    if (!g_texture) {
+        // persistent texture, only the changed areas are uploaded later
+        g_texture = SDL_CreateTexture(g_renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+        if (g_texture != NULL) {
+            SDL_SetTextureBlendMode(g_texture, SDL_BLENDMODE_BLEND);
+            g_syncedDamage.clear();
+            g_syncedDamage.add(0, 0, DISPLAY_WIDTH - 1, DISPLAY_HEIGHT - 1);
         } else {
-            printf("Unable to create texture from image buffer! SDL Error: %s\n", SDL_GetError());
+            printf("Unable to create texture! SDL Error: %s\n", SDL_GetError());
         }
-        SDL_FreeSurface(rgbSurface);
-    } else {
-        printf("Unable to render text surface! SDL Error: %s\n", SDL_GetError());
     }
+
+    if (g_texture != NULL) {
+        for (int i = 0; i < g_syncedDamage.numRects; i++) {
+            auto &rect = g_syncedDamage.rects[i];
+            SDL_Rect updateRect = { rect.x1, rect.y1, rect.x2 - rect.x1 + 1, rect.y2 - rect.y1 + 1 };
+            SDL_UpdateTexture(g_texture, &updateRect, (uint32_t *)g_syncedBuffer + rect.y1 * DISPLAY_WIDTH + rect.x1, 4 * DISPLAY_WIDTH);
+        }
+        g_syncedDamage.clear();
+
+        SDL_Rect srcRect = { 0, 0, (int)DISPLAY_WIDTH, (int)DISPLAY_HEIGHT };
+        SDL_Rect dstRect = { 0, 0, (int)DISPLAY_WIDTH, (int)DISPLAY_HEIGHT };
+        SDL_RenderCopyEx(g_renderer, g_texture, &srcRect, &dstRect, 0.0, NULL, SDL_FLIP_NONE);
+    }
+
     SDL_RenderPresent(g_renderer);
 
     sendMessageToGuiThread(GUI_QUEUE_MESSAGE_TYPE_DISPLAY_VSYNC, 0, 0);
@@ -183,13 +310,16 @@ void getPixel(int x, int y, uint8_t *r, uint8_t *g, uint8_t *b) {
 ////////////////////////////////////////////////////////////////////////////////
 
 void startPixelsDraw() {
+    clearPixelsDamage();
 }
 
 void drawPixel(int x, int y) {
     *(g_renderBuffer + y * DISPLAY_WIDTH + x) = color16to32(g_fc);
+    addPixelDamage(x, y);
 }
 
 void drawPixel(int x, int y, uint8_t opacity) {
+    addPixelDamage(x, y);
     auto dest = g_renderBuffer + y * DISPLAY_WIDTH + x;
     auto destUint8 = (uint8_t *)dest;
     *dest = blendColor(
@@ -197,8 +327,18 @@ void drawPixel(int x, int y, uint8_t opacity) {
         color16to32(RGB_TO_COLOR(destUint8[0], destUint8[1], destUint8[2]), 255 - opacity));
 }
 
+void drawPixelsVSpan(int x, int y1, int y2) {
+    uint32_t color32 = color16to32(g_fc);
+    uint32_t *dst = g_renderBuffer + y1 * DISPLAY_WIDTH + x;
+    for (uint32_t *dstEnd = dst + (y2 - y1 + 1) * DISPLAY_WIDTH; dst < dstEnd; dst += DISPLAY_WIDTH) {
+        *dst = color32;
+    }
+    addPixelDamage(x, y1);
+    addPixelDamage(x, y2);
+}
+
 void endPixelsDraw() {
-    setDirty();
+    addPixelsDamage();
 }
 
 void fillRect(int x1, int y1, int x2, int y2) {
@@ -213,36 +353,32 @@ void fillRect(int x1, int y1, int x2, int y2) {
     if (height <= 0) {
         return;
     }
-    int nl = DISPLAY_WIDTH - width;
-    if (g_opacity == 255) {
-        for (uint32_t *dstEnd = dst + height * DISPLAY_WIDTH; dst != dstEnd; dst += nl) {
-            for (uint32_t *lineEnd = dst + width; dst != lineEnd; dst++) {
-                *dst = color32;
+    bool opaque = g_opacity == 255;
+    forEachRows(0, height - 1, width, [&](int r1, int r2) {
+        uint32_t *dstRow = dst + r1 * DISPLAY_WIDTH;
+        for (uint32_t *dstEnd = dst + (r2 + 1) * DISPLAY_WIDTH; dstRow != dstEnd; dstRow += DISPLAY_WIDTH) {
+            if (opaque) {
+                kernels::fillSpan(dstRow, width, color32);
+            } else {
+                kernels::blendColorSpan(dstRow, width, color32);
             }
         }
-    } else {
-        for (uint32_t *dstEnd = dst + height * DISPLAY_WIDTH; dst != dstEnd; dst += nl) {
-            for (uint32_t *lineEnd = dst + width; dst != lineEnd; dst++) {
-                *dst = blendColor(color32, *dst);
-            }
-        }
-    }
+    });
 
-    setDirty();
+    addDamage(x1, y1, x2, y2);
 }
 
 void fillRect(void *dstBuffer, int x1, int y1, int x2, int y2) {
     uint32_t color32 = color16to32(g_fc);
-    uint32_t *dst = (uint32_t *)dstBuffer + y1 * DISPLAY_WIDTH + x1;
-    int nl = DISPLAY_WIDTH - (x2 - x1 + 1);
-    for (int y = y1; y <= y2; y++) {
-        for (int x = x1; x <= x2; x++) {
-            *dst++ = color32;
+    int width = x2 - x1 + 1;
+    forEachRows(y1, y2, width, [&](int r1, int r2) {
+        uint32_t *dst = (uint32_t *)dstBuffer + r1 * DISPLAY_WIDTH + x1;
+        for (int y = r1; y <= r2; y++, dst += DISPLAY_WIDTH) {
+            kernels::fillSpan(dst, width, color32);
         }
-        dst += nl;
-    }
+    });
 
-    setDirty();
+    addDamage(x1, y1, x2, y2);
 }
 
 void bitBlt(int x1, int y1, int x2, int y2, int dstx, int dsty) {
@@ -250,32 +386,39 @@ void bitBlt(int x1, int y1, int x2, int y2, int dstx, int dsty) {
 
     uint32_t *src = g_renderBuffer + y1 * DISPLAY_WIDTH + x1;
     uint32_t *dst = g_renderBuffer + dsty * DISPLAY_WIDTH + dstx;
-    int nl = DISPLAY_WIDTH - width;
 
-    for (int y = y1; y <= y2; y++, src += nl, dst += nl) {
-        for (uint32_t *lineEnd = dst + width; dst != lineEnd; dst++, src++) {
-            uint8_t *src8 = (uint8_t *)src;
-            *dst = color16to32(RGB_TO_COLOR(src8[0], src8[1], src8[2]));
+    if (dsty == y1 && dstx > x1 && dstx <= x2) {
+        // overlapping span moved to the right, keep the old pixel by pixel behavior
+        int nl = DISPLAY_WIDTH - width;
+        for (int y = y1; y <= y2; y++, src += nl, dst += nl) {
+            for (uint32_t *lineEnd = dst + width; dst != lineEnd; dst++, src++) {
+                uint8_t *src8 = (uint8_t *)src;
+                *dst = color16to32(RGB_TO_COLOR(src8[0], src8[1], src8[2]));
+            }
+        }
+    } else {
+        for (int y = y1; y <= y2; y++, src += DISPLAY_WIDTH, dst += DISPLAY_WIDTH) {
+            kernels::quantizeSpan(dst, src, width);
         }
     }
 
-    setDirty();
+    addDamage(dstx, dsty, dstx + width - 1, dsty + y2 - y1);
 }
 
 void bitBlt(void *src, int x1, int y1, int x2, int y2) {
     bitBlt(src, g_renderBuffer, x1, y1, x2, y2);
-    setDirty();
 }
 
 void bitBlt(void *src, void *dst, int x1, int y1, int x2, int y2) {
-    for (int y = y1; y <= y2; ++y) {
-        for (int x = x1; x <= x2; ++x) {
-            int i = y * DISPLAY_WIDTH + x;
-            ((uint32_t *)dst)[i] = ((uint32_t *)src)[i];
+    int width = x2 - x1 + 1;
+    forEachRows(y1, y2, width, [&](int r1, int r2) {
+        for (int y = r1; y <= r2; ++y) {
+            int i = y * DISPLAY_WIDTH + x1;
+            kernels::copySpan((uint32_t *)dst + i, (uint32_t *)src + i, width);
         }
-    }
+    });
 
-    setDirty();
+    addDamage(x1, y1, x2, y2);
 }
 
 void bitBlt(void *src, void *dst, int sx, int sy, int sw, int sh, int dx, int dy, uint8_t opacity) {
@@ -283,68 +426,57 @@ void bitBlt(void *src, void *dst, int sx, int sy, int sw, int sh, int dx, int dy
         dst = g_renderBuffer;
     }
 
-    if (opacity == 255) {
-        for (int y = 0; y < sh; ++y) {
-            for (int x = 0; x < sw; ++x) {
-                ((uint32_t *)dst)[(dy + y) * DISPLAY_WIDTH + dx + x] = ((uint32_t *)src)[(sy + y) * DISPLAY_WIDTH + sx + x];
+    auto blitRows = [&](int r1, int r2) {
+        for (int y = r1; y <= r2; ++y) {
+            if (opacity == 255) {
+                kernels::copySpan((uint32_t *)dst + (dy + y) * DISPLAY_WIDTH + dx, (uint32_t *)src + (sy + y) * DISPLAY_WIDTH + sx, sw);
+            } else {
+                kernels::blendSpanWithOpacity((uint32_t *)dst + (dy + y) * DISPLAY_WIDTH + dx, (uint32_t *)src + (sy + y) * DISPLAY_WIDTH + sx, sw, opacity);
             }
         }
+    };
+
+    if (src == dst) {
+        // rows can overlap, keep the order
+        blitRows(0, sh - 1);
     } else {
-        for (int y = 0; y < sh; ++y) {
-            for (int x = 0; x < sw; ++x) {
-                uint8_t *p = (uint8_t *)&((uint32_t *)src)[(sy + y) * DISPLAY_WIDTH + sx + x];
-                p[3] = opacity;
-                ((uint32_t *)dst)[(dy + y) * DISPLAY_WIDTH + dx + x] = blendColor(
-                    ((uint32_t *)src)[(sy + y) * DISPLAY_WIDTH + sx + x],
-                    ((uint32_t *)dst)[(dy + y) * DISPLAY_WIDTH + dx + x]
-                );
-            }
-        }
+        forEachRows(0, sh - 1, sw, blitRows);
     }
 }
 
 void drawBitmap(Image *image, int x, int y) {
     uint32_t *dst = g_renderBuffer + y * DISPLAY_WIDTH + x;
-    int nlDst = DISPLAY_WIDTH - image->width;
 
-    if (image->bpp == 32) {
-        uint32_t *src = (uint32_t *)image->pixels;
-        int nlSrc = image->lineOffset;
+    auto opacity = g_opacity;
 
-        uint32_t pixel;
-        uint8_t *pixelAlpha = ((uint8_t *)&pixel) + 3;
+    forEachRows(0, image->height - 1, image->width, [&](int r1, int r2) {
+        uint32_t *dstRow = dst + r1 * DISPLAY_WIDTH;
 
-        for (uint32_t *srcEnd = src + (image->width + nlSrc) * image->height; src != srcEnd; src += nlSrc, dst += nlDst) {
-            for (uint32_t *lineEnd = dst + image->width; dst != lineEnd; src++, dst++) {
-                pixel = *src;
-                *pixelAlpha = *pixelAlpha * g_opacity / 255;
-                *dst = blendColor(pixel, *dst);
+        if (image->bpp == 32) {
+            int srcStride = image->width + image->lineOffset;
+            uint32_t *src = (uint32_t *)image->pixels + r1 * srcStride;
+
+            for (uint32_t *srcEnd = src + srcStride * (r2 - r1 + 1); src != srcEnd; src += srcStride, dstRow += DISPLAY_WIDTH) {
+                kernels::blendBitmapSpan(dstRow, src, image->width, opacity);
             }
-        }
-    } else if (image->bpp == 24) {
-        uint8_t *src = (uint8_t *)image->pixels;
-        int nlSrc = 3 * image->lineOffset;
-
-        for (uint8_t *srcEnd = src + 3 * (image->width + nlSrc) * image->height; src != srcEnd; src += nlSrc, dst += nlDst) {
-            for (uint32_t *lineEnd = dst + image->width; dst != lineEnd; src += 3, dst++) {
-                ((uint8_t *)dst)[0] = ((uint8_t *)src)[0];
-                ((uint8_t *)dst)[1] = ((uint8_t *)src)[1];
-                ((uint8_t *)dst)[2] = ((uint8_t *)src)[2];
-                ((uint8_t *)dst)[3] = 255;
+        } else if (image->bpp == 24) {
+            int srcStride = 3 * (image->width + image->lineOffset);
+            uint8_t *src = (uint8_t *)image->pixels + r1 * srcStride;
+
+            for (uint8_t *srcEnd = src + srcStride * (r2 - r1 + 1); src != srcEnd; src += srcStride, dstRow += DISPLAY_WIDTH) {
+                kernels::expand888Span(dstRow, src, image->width);
             }
-        }
-    } else {
-        uint16_t *src = (uint16_t *)image->pixels;
-        int nlSrc = image->lineOffset;
+        } else {
+            int srcStride = image->width + image->lineOffset;
+            uint16_t *src = (uint16_t *)image->pixels + r1 * srcStride;
 
-        for (uint16_t *srcEnd = src + (image->width + nlSrc) * image->height; src != srcEnd; src += nlSrc, dst += nlDst) {
-            for (uint32_t *lineEnd = dst + image->width; dst != lineEnd; src++, dst++) {
-                *dst = color16to32(*src);
+            for (uint16_t *srcEnd = src + srcStride * (r2 - r1 + 1); src != srcEnd; src += srcStride, dstRow += DISPLAY_WIDTH) {
+                kernels::expand565Span(dstRow, src, image->width);
             }
         }
-    }
+    });
 
-    setDirty();
+    addDamage(x, y, x + image->width - 1, y + image->height - 1);
 }
 
 void drawStrInit() {
@@ -354,24 +486,14 @@ void drawGlyph(const uint8_t *src, uint32_t srcLineOffset, int x_glyph, int y_gl
     // glyph->pixels + offset + iStartByte, glyph->width - width, x_glyph, y_glyph, width,height
     // const gui::GlyphData &glyph, int x_glyph, int y_glyph, int width, int height, int offset, int iStartByte
 
-    uint32_t pixel;
-    ((uint8_t *)&pixel)[0] = COLOR_TO_R(g_fc);
-    ((uint8_t *)&pixel)[1] = COLOR_TO_G(g_fc);
-    ((uint8_t *)&pixel)[2] = COLOR_TO_B(g_fc);
-    uint8_t *pixelAlpha = ((uint8_t *)&pixel) + 3;
+    uint32_t rgb = color16to32(g_fc, 0);
 
     uint32_t *dst = g_renderBuffer + y_glyph * DISPLAY_WIDTH + x_glyph;
-    int nlDst = DISPLAY_WIDTH - width;
 
     for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            *pixelAlpha = *src * g_opacity / 255;
-            *dst = blendColor(pixel, *dst);
-            src++;
-            dst++;
-        }
-        src += srcLineOffset;
-        dst += nlDst;
+        kernels::blendGlyphSpan(dst, src, width, rgb, g_opacity);
+        src += width + srcLineOffset;
+        dst += DISPLAY_WIDTH;
     }
 }
 
@@ -145,7 +145,7 @@ void fillRect(uint16_t *dst, int x, int y, int width, int height, uint16_t color
 
 void fillRect(void *dst, int x1, int y1, int x2, int y2) {
     fillRect((uint16_t *)dst, x1, y1, x2 - x1 + 1, y2 - y1 + 1, g_fc);
-    setDirty();
+    addDamage(x1, y1, x2, y2);
 }
 
 void bitBlt(void *src, int srcBpp, uint32_t srcLineOffset, uint16_t *dst, int x, int y, int width, int height) {
@@ -206,7 +206,6 @@ void bitBlt(void *src, int srcBpp, uint32_t srcLineOffset, uint16_t *dst, int x,
 
 void bitBlt(void *src, int x1, int y1, int x2, int y2) {
     bitBlt(src, g_renderBuffer, x1, y1, x2, y2);
-    setDirty();
 }
 
 void bitBlt(uint16_t *src, uint16_t *dst, int x, int y, int width, int height) {
@@ -254,7 +253,7 @@ static void bitBltRGB888(uint16_t *src, uint8_t *dst, int x, int y, int width, i
 
 void bitBlt(void *src, void *dst, int x1, int y1, int x2, int y2) {
     bitBlt((uint16_t *)src, (uint16_t *)dst, x1, y1, x2 - x1 + 1, y2 - y1 + 1);
-    setDirty();
+    addDamage(x1, y1, x2, y2);
 }
 
 void bitBlt(uint16_t *src, uint16_t *dst, int x, int y, int width, int height, int dstx, int dsty) {
@@ -336,13 +335,16 @@ void getPixel(int x, int y, uint8_t *r, uint8_t *g, uint8_t *b) {
 
 void startPixelsDraw() {
     DMA2D_WAIT;
+    clearPixelsDamage();
 }
 
 void drawPixel(int x, int y) {
     *(g_renderBuffer + y * DISPLAY_WIDTH + x) = g_fc;
+    addPixelDamage(x, y);
 }
 
 void drawPixel(int x, int y, uint8_t opacity) {
+    addPixelDamage(x, y);
     auto dest = g_renderBuffer + y * DISPLAY_WIDTH + x;
     *dest = color32to16(
         blendColor(
@@ -352,8 +354,17 @@ void drawPixel(int x, int y, uint8_t opacity) {
     );
 }
 
+void drawPixelsVSpan(int x, int y1, int y2) {
+    auto dst = g_renderBuffer + y1 * DISPLAY_WIDTH + x;
+    for (auto dstEnd = dst + (y2 - y1 + 1) * DISPLAY_WIDTH; dst < dstEnd; dst += DISPLAY_WIDTH) {
+        *dst = g_fc;
+    }
+    addPixelDamage(x, y1);
+    addPixelDamage(x, y2);
+}
+
 void endPixelsDraw() {
-    setDirty();
+    addPixelsDamage();
 }
 
 void fillRect(int x1, int y1, int x2, int y2) {
@@ -369,19 +380,19 @@ void fillRect(int x1, int y1, int x2, int y2) {
 
     fillRect(g_renderBuffer, x1, y1, width, height, g_fc);
 
-    setDirty();
+    addDamage(x1, y1, x2, y2);
 }
 
 void bitBlt(int x1, int y1, int x2, int y2, int dstx, int dsty) {
     bitBlt(g_renderBuffer, g_renderBuffer, x1, y1, x2-x1+1, y2-y1+1, dstx, dsty);
 
-    setDirty();
+    addDamage(dstx, dsty, dstx + x2 - x1, dsty + y2 - y1);
 }
 
 void drawBitmap(Image *image, int x, int y) {
     bitBlt(image->pixels, image->bpp, image->lineOffset, g_renderBuffer, x, y, image->width, image->height);
 
-    setDirty();
+    addDamage(x, y, x + image->width - 1, y + image->height - 1);
 }
 
 void drawStrInit() {